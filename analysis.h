@@ -0,0 +1,601 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#ifndef ADEF
+#define ADEF static inline
+#endif
+
+// delta x definition for integration and differentiation.
+#ifndef DELTA
+#define DELTA (long double) .000001
+#endif
+
+// the amount of steps a definite integral is summed over.
+#ifndef INTEGRATE_STEPS
+#define INTEGRATE_STEPS 100000
+#endif
+
+// the amount of intervals an interval is split into when scanning for roots.
+#ifndef ROOT_SAMPLES
+#define ROOT_SAMPLES 100000
+#endif
+
+// the default tolerance (in x) that roots are refined to.
+#ifndef ROOT_TOLERANCE
+#define ROOT_TOLERANCE (long double) 1e-12
+#endif
+
+// how close to zero |f| has to get at a minimum for the minimum to count as a root that touches the axis.
+#ifndef TOUCH_TOLERANCE
+#define TOUCH_TOLERANCE (long double) 1e-9
+#endif
+
+// the maximum amount of roots that are kept for a single search.
+#ifndef MAX_ROOTS
+#define MAX_ROOTS 256
+#endif
+
+// the amount of x values that are scanned per call to the batch evaluator.
+#ifndef SCAN_BLOCK
+#define SCAN_BLOCK 4096
+#endif
+
+// the default amount of points a function is sampled at for range statistics.
+#ifndef STATS_SAMPLES
+#define STATS_SAMPLES 1000000
+#endif
+
+// the most worker threads that are started for a single job.
+#ifndef MAX_THREADS
+#define MAX_THREADS 64
+#endif
+
+// the amount of independent accumulators each reduction keeps, so that consecutive additions don't wait on each other.
+#ifndef REDUCTION_LANES
+#define REDUCTION_LANES 4
+#endif
+
+// the function whose roots are being searched for, f - g when g is given so that roots are intersections.
+typedef struct {
+    p_data *f;
+    p_data *g;
+    long double base;
+    long evaluations;
+} a_problem;
+
+// the result of a root search.
+typedef struct {
+    long double roots[MAX_ROOTS];
+    int root_cnt;
+    long scan_evaluations;
+    long refine_evaluations;
+    double scan_seconds;
+} a_roots;
+
+// returns the time in seconds from a monotonic clock.
+ADEF double now_seconds() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// returns the derivative based on the delta x limit definition of a derivative, polynomials are differentiated exactly.
+ADEF long double derive(long double x_value, p_data *data, long double b) {
+    if(data -> polynomial)
+        return derive_polynomial(x_value, data);
+
+    return (evaluate(x_value + DELTA, data, b) - evaluate(x_value, data, b)) / DELTA;
+}
+
+// returns the definite integral based on given bounds and the delta x summation definition of an integral. the
+// summation only walks upwards, so reversed bounds are integrated the other way around and negated, which is the sign
+// that the exact path for polynomials gives as well.
+ADEF long double integrate(long double left_bound, long double right_bound, p_data *function, long double base) {
+    if(left_bound > right_bound)
+        return -integrate(right_bound, left_bound, function, base);
+
+    double start = phase_begin();
+
+    // polynomials have an exact antiderivative.
+    if(function -> polynomial) {
+        long double area = antiderive_polynomial(right_bound, function) - antiderive_polynomial(left_bound, function);
+        phase_end(PHASE_integrate, start);
+        return area;
+    }
+
+    long double x_value = left_bound;
+    long double def_int = 0;
+    long evaluations = 0;
+
+    /*
+     * ACCURACY LIMITATION
+     * -------------------
+     *  the accuracy of this calculation is limited by the accuracy of floating point numbers in c.
+     *  I have attempted to mitigate this error by modulating the size of the steps taken by the
+     *  integration function based on the width of the bounds, but really this is only to maximize
+     *  speed rather than accuracy
+     */
+    long double steps = (right_bound - left_bound) / INTEGRATE_STEPS;
+    progress_total(INTEGRATE_STEPS);
+    while(x_value < right_bound) {
+        def_int += evaluate(x_value, function, base) * steps;
+        x_value += steps;
+
+        // the summation is split into blocks only to check whether it was canceled.
+        if(++evaluations % SCAN_BLOCK == 0 && progress_advance(SCAN_BLOCK))
+            break;
+    }
+    progress_advance(evaluations % SCAN_BLOCK);
+
+    if(instrumenting())
+        instrument_add(calc_instrument.integrate_evaluations, evaluations);
+    phase_end(PHASE_integrate, start);
+    return def_int;
+}
+
+// evaluates f - g at a single x value.
+ADEF long double problem_value(long double x, a_problem *problem) {
+    problem -> evaluations++;
+    long double output = evaluate(x, problem -> f, problem -> base);
+    if(problem -> g != NULL)
+        output -= evaluate(x, problem -> g, problem -> base);
+    return output;
+}
+
+// whether or not the exact derivative of f - g is known.
+ADEF bool problem_has_derivative(a_problem *problem) {
+    return problem -> f -> polynomial && (problem -> g == NULL || problem -> g -> polynomial);
+}
+
+// evaluates the exact derivative of f - g, only valid when both are polynomials.
+ADEF long double problem_derivative(long double x, a_problem *problem) {
+    problem -> evaluations++;
+    long double output = derive_polynomial(x, problem -> f);
+    if(problem -> g != NULL)
+        output -= derive_polynomial(x, problem -> g);
+    return output;
+}
+
+// brent's method: finds a root of fn between a and b, which must bracket a sign change.
+ADEF long double brent(long double (*fn)(long double, a_problem *), a_problem *problem, long double a, long double b, long double fa, long double fb, long double tolerance) {
+    long double c = b, fc = fb, d = b - a, e = d;
+
+    for(int i = 0 ; i < 200 ; i++) {
+        // keeps the root between b and c.
+        if((fb > 0 && fc > 0) || (fb < 0 && fc < 0)) {
+            c = a; fc = fa;
+            d = e = b - a;
+        }
+        if(fabsl(fc) < fabsl(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+
+        long double tol = 2 * LDBL_EPSILON * fabsl(b) + tolerance / 2;
+        long double m = (c - b) / 2;
+        if(fabsl(m) <= tol || fb == 0)
+            return b;
+
+        // attempts inverse quadratic interpolation (or the secant method), falling back on bisection.
+        if(fabsl(e) >= tol && fabsl(fa) > fabsl(fb)) {
+            long double p, q, r, s = fb / fa;
+            if(a == c) {
+                p = 2 * m * s;
+                q = 1 - s;
+            } else {
+                q = fa / fc;
+                r = fb / fc;
+                p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+                q = (q - 1) * (r - 1) * (s - 1);
+            }
+            if(p > 0) q = -q;
+            else p = -p;
+
+            if(2 * p < fminl(3 * m * q - fabsl(tol * q), fabsl(e * q))) {
+                e = d;
+                d = p / q;
+            } else {
+                d = m;
+                e = m;
+            }
+        } else {
+            d = m;
+            e = m;
+        }
+
+        a = b;
+        fa = fb;
+        b += fabsl(d) > tol ? d : (m > 0 ? tol : -tol);
+        fb = fn(b, problem);
+    }
+    return b;
+}
+
+// newton's method kept inside a bracket, used when the exact derivative is known. any step that leaves the
+// bracket or doesn't shrink fast enough is replaced by bisection.
+ADEF long double safe_newton(a_problem *problem, long double a, long double b, long double fa, long double tolerance) {
+    long double low = a, high = b;
+    if(fa > 0) {
+        low = b;
+        high = a;
+    }
+
+    long double x = (a + b) / 2;
+    long double step = fabsl(b - a), last_step = step;
+    long double fx = problem_value(x, problem);
+    long double dfx = problem_derivative(x, problem);
+
+    for(int i = 0 ; i < 200 ; i++) {
+        if((((x - high) * dfx - fx) * ((x - low) * dfx - fx) > 0) || (fabsl(2 * fx) > fabsl(last_step * dfx))) {
+            last_step = step;
+            step = (high - low) / 2;
+            x = low + step;
+        } else {
+            last_step = step;
+            step = fx / dfx;
+            x -= step;
+        }
+
+        if(fabsl(step) < tolerance)
+            return x;
+
+        fx = problem_value(x, problem);
+        dfx = problem_derivative(x, problem);
+        if(fx == 0)
+            return x;
+        if(fx < 0) low = x;
+        else high = x;
+    }
+    return x;
+}
+
+// golden section search for the minimum of |f - g| between a and b.
+ADEF long double minimize_magnitude(a_problem *problem, long double a, long double b, long double tolerance) {
+    long double ratio = (sqrtl(5) - 1) / 2;
+    long double c = b - ratio * (b - a), d = a + ratio * (b - a);
+    long double fc = fabsl(problem_value(c, problem)), fd = fabsl(problem_value(d, problem));
+
+    while(fabsl(b - a) > tolerance) {
+        if(fc < fd) {
+            b = d; d = c; fd = fc;
+            c = b - ratio * (b - a);
+            fc = fabsl(problem_value(c, problem));
+        } else {
+            a = c; c = d; fc = fd;
+            d = a + ratio * (b - a);
+            fd = fabsl(problem_value(d, problem));
+        }
+    }
+    return (a + b) / 2;
+}
+
+// adds a root to the result unless it was already found from a neighbouring bracket.
+ADEF void add_root(a_roots *result, long double root, long double tolerance) {
+    for(int i = 0 ; i < result -> root_cnt ; i++)
+        if(fabsl(result -> roots[i] - root) <= tolerance * 10)
+            return;
+
+    if(result -> root_cnt < MAX_ROOTS)
+        result -> roots[result -> root_cnt++] = root;
+}
+
+// refines a bracket with a sign change into a root.
+ADEF long double refine_root(a_problem *problem, long double a, long double b, long double fa, long double fb, long double tolerance) {
+    if(problem_has_derivative(problem))
+        return safe_newton(problem, a, b, fa, tolerance);
+    return brent(&problem_value, problem, a, b, fa, fb, tolerance);
+}
+
+// refines a local minimum of |f - g| between a and b, and returns whether or not it touches zero.
+ADEF bool refine_touch(a_problem *problem, long double a, long double b, long double tolerance, long double *root) {
+    // with the exact derivative, the minimum is the root of the derivative.
+    if(problem_has_derivative(problem)) {
+        long double da = problem_derivative(a, problem), db = problem_derivative(b, problem);
+        if((da < 0) != (db < 0))
+            *root = brent(&problem_derivative, problem, a, b, da, db, tolerance);
+        else
+            *root = minimize_magnitude(problem, a, b, tolerance);
+    } else *root = minimize_magnitude(problem, a, b, tolerance);
+
+    return fabsl(problem_value(*root, problem)) <= TOUCH_TOLERANCE;
+}
+
+// finds every root of f - g (or f when g is NULL) between the bounds. the interval is first scanned with the batch
+// evaluator to bracket sign changes and minima of |f - g|, and then each bracket is refined to the tolerance.
+ADEF a_roots find_roots(p_data *f, p_data *g, long double left_bound, long double right_bound, int samples, long double tolerance, long double base) {
+    a_roots result;
+    memset(&result, 0, sizeof(a_roots));
+    a_problem problem = { f, g, base, 0 };
+
+    long double *xvalues = (long double *) malloc(SCAN_BLOCK * sizeof(long double));
+    long double *yvalues = (long double *) malloc(SCAN_BLOCK * sizeof(long double));
+    long double *gvalues = g != NULL ? (long double *) malloc(SCAN_BLOCK * sizeof(long double)) : NULL;
+    long double step = (right_bound - left_bound) / samples;
+
+    // the last two samples are carried over from block to block.
+    long double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    int seen = 0;
+
+    double start = now_seconds();
+    progress_total(samples + 1);
+    for(int block = 0 ; block <= samples && !canceled() ; block += SCAN_BLOCK) {
+        int length = samples + 1 - block < SCAN_BLOCK ? samples + 1 - block : SCAN_BLOCK;
+        for(int i = 0 ; i < length ; i++)
+            xvalues[i] = left_bound + (block + i) * step;
+
+        evaluate_batch(f, xvalues, yvalues, length, base);
+        if(g != NULL) {
+            evaluate_batch(g, xvalues, gvalues, length, base);
+            for(int i = 0 ; i < length ; i++)
+                yvalues[i] -= gvalues[i];
+        }
+        result.scan_evaluations += length;
+
+        for(int i = 0 ; i < length ; i++) {
+            long double x2 = xvalues[i], y2 = yvalues[i];
+
+            if(y2 == 0) {
+                add_root(&result, x2, tolerance);
+            } else if(seen >= 1 && ((y1 < 0 && y2 > 0) || (y1 > 0 && y2 < 0))) {
+                double refine_start = now_seconds();
+                add_root(&result, refine_root(&problem, x1, x2, y1, y2, tolerance), tolerance);
+                start += now_seconds() - refine_start;
+            } else if(seen >= 2 && fabsl(y1) < fabsl(y0) && fabsl(y1) <= fabsl(y2) && (y0 < 0) == (y1 < 0) && (y1 < 0) == (y2 < 0)) {
+                double refine_start = now_seconds();
+                long double root;
+                if(refine_touch(&problem, x0, x2, tolerance, &root))
+                    add_root(&result, root, tolerance);
+                start += now_seconds() - refine_start;
+            }
+
+            x0 = x1; y0 = y1;
+            x1 = x2; y1 = y2;
+            seen++;
+        }
+        progress_advance(length);
+    }
+    result.scan_seconds = now_seconds() - start;
+    result.refine_evaluations = problem.evaluations;
+
+    free(xvalues);
+    free(yvalues);
+    free(gvalues);
+
+    // roots from touching minima can be found after later sign changes, so the result is sorted.
+    for(int i = 1 ; i < result.root_cnt ; i++)
+        for(int j = i ; j > 0 && result.roots[j-1] > result.roots[j] ; j--) {
+            long double swap = result.roots[j];
+            result.roots[j] = result.roots[j-1];
+            result.roots[j-1] = swap;
+        }
+
+    return result;
+}
+
+// summary statistics of a function sampled over an interval. non-finite samples are counted but not reduced.
+typedef struct {
+    long double min, max, argmin, argmax;
+    long double mean, rms;
+    long samples, nonfinite;
+    int threads;
+    double seconds;
+} a_stats;
+
+// a compensated (neumaier) sum, the compensation holds the low order bits lost by the running sum.
+typedef struct {
+    long double sum;
+    long double compensation;
+} a_sum;
+
+// one thread's share of a range reduction.
+typedef struct {
+    p_data *function;
+    long double left_bound, step, base;
+    long first, last;
+
+    long double min, max;
+    long min_index, max_index;
+    a_sum sum, squares;
+    long finite;
+
+    // the progress of the computation that the reduction is part of.
+    p_progress *progress;
+
+    // an error that the thread ran into, kept for the thread that joins it.
+    bool failed;
+    char error[MAX_LENGTH];
+} a_partial;
+
+// adds a value to a compensated sum.
+ADEF void sum_add(a_sum *sum, long double value) {
+    long double total = sum -> sum + value;
+    if(fabsl(sum -> sum) >= fabsl(value))
+        sum -> compensation += (sum -> sum - total) + value;
+    else
+        sum -> compensation += (value - total) + sum -> sum;
+    sum -> sum = total;
+}
+
+// returns the value of a compensated sum.
+ADEF long double sum_value(a_sum *sum) {
+    return sum -> sum + sum -> compensation;
+}
+
+// returns the amount of worker threads to use, based on the amount of processors.
+ADEF int worker_count() {
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if(processors < 1)
+        return 1;
+    return processors > MAX_THREADS ? MAX_THREADS : (int) processors;
+}
+
+// reduces one thread's share of the samples, a block at a time.
+ADEF void *reduce_range(void *argument) {
+    a_partial *partial = (a_partial *) argument;
+    progress = partial -> progress;
+    long double *volatile xvalues = (long double *) malloc(SCAN_BLOCK * sizeof(long double));
+    long double *volatile yvalues = (long double *) malloc(SCAN_BLOCK * sizeof(long double));
+
+    // an error stops this share and is raised again once every worker was joined, so that it reaches the handler of
+    // the thread that asked for the reduction instead of ending the process.
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        partial -> failed = true;
+        snprintf(partial -> error, MAX_LENGTH, "%s", error_message);
+        free(xvalues);
+        free(yvalues);
+        return NULL;
+    }
+
+    // every lane keeps its own minimum, maximum and sums, and the lanes are only combined at the end.
+    long double min[REDUCTION_LANES], max[REDUCTION_LANES];
+    long min_index[REDUCTION_LANES], max_index[REDUCTION_LANES], finite[REDUCTION_LANES];
+    a_sum sum[REDUCTION_LANES], squares[REDUCTION_LANES];
+    for(int lane = 0 ; lane < REDUCTION_LANES ; lane++) {
+        min[lane] = INFINITY;
+        max[lane] = -INFINITY;
+        min_index[lane] = max_index[lane] = -1;
+        finite[lane] = 0;
+        sum[lane] = squares[lane] = (a_sum) { 0, 0 };
+    }
+
+    for(long block = partial -> first ; block < partial -> last ; block += SCAN_BLOCK) {
+        int length = partial -> last - block < SCAN_BLOCK ? partial -> last - block : SCAN_BLOCK;
+        for(int i = 0 ; i < length ; i++)
+            xvalues[i] = partial -> left_bound + (block + i) * partial -> step;
+
+        evaluate_batch(partial -> function, xvalues, yvalues, length, partial -> base);
+
+        for(int i = 0 ; i < length ; i++) {
+            int lane = i % REDUCTION_LANES;
+            long double y = yvalues[i];
+            if(!isfinite(y))
+                continue;
+
+            if(y < min[lane]) { min[lane] = y; min_index[lane] = block + i; }
+            if(y > max[lane]) { max[lane] = y; max_index[lane] = block + i; }
+            sum_add(&sum[lane], y);
+            sum_add(&squares[lane], y * y);
+            finite[lane]++;
+        }
+
+        if(progress_advance(length))
+            break;
+    }
+
+    partial -> min = INFINITY;
+    partial -> max = -INFINITY;
+    partial -> min_index = partial -> max_index = -1;
+    partial -> sum = partial -> squares = (a_sum) { 0, 0 };
+    partial -> finite = 0;
+    for(int lane = 0 ; lane < REDUCTION_LANES ; lane++) {
+        if(min_index[lane] >= 0 && (min[lane] < partial -> min || (min[lane] == partial -> min && min_index[lane] < partial -> min_index))) {
+            partial -> min = min[lane];
+            partial -> min_index = min_index[lane];
+        }
+        if(max_index[lane] >= 0 && (max[lane] > partial -> max || (max[lane] == partial -> max && max_index[lane] < partial -> max_index))) {
+            partial -> max = max[lane];
+            partial -> max_index = max_index[lane];
+        }
+        sum_add(&partial -> sum, sum[lane].sum);
+        sum_add(&partial -> sum, sum[lane].compensation);
+        sum_add(&partial -> squares, squares[lane].sum);
+        sum_add(&partial -> squares, squares[lane].compensation);
+        partial -> finite += finite[lane];
+    }
+
+    error_handler = previous;
+    free(xvalues);
+    free(yvalues);
+    return NULL;
+}
+
+// samples a function at n evenly spaced points between the bounds (inclusive) and reduces the samples to their
+// minimum, maximum, mean and root mean square in a single pass. the samples are split between worker threads. when
+// none of the samples are finite, the minimum, maximum and their x values are nan.
+ADEF a_stats range_stats(p_data *function, long double left_bound, long double right_bound, long samples, int threads, long double base) {
+    a_stats stats;
+    memset(&stats, 0, sizeof(a_stats));
+    if(samples < 1)
+        return stats;
+
+    // a malformed function is evaluated once first, so that it reports its error before any thread is started.
+    if(!function -> valid)
+        evaluate(left_bound, function, base);
+
+    if(threads < 1)
+        threads = worker_count();
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    // small ranges aren't worth a thread per processor.
+    if(samples / SCAN_BLOCK < threads)
+        threads = samples / SCAN_BLOCK > 0 ? samples / SCAN_BLOCK : 1;
+
+    a_partial partials[MAX_THREADS];
+    pthread_t workers[MAX_THREADS];
+    bool started[MAX_THREADS];
+    long double step = samples > 1 ? (right_bound - left_bound) / (samples - 1) : 0;
+
+    double start = now_seconds();
+    progress_total(samples);
+    for(int i = 0 ; i < threads ; i++) {
+        partials[i] = (a_partial) { function, left_bound, step, base, samples * i / threads, samples * (i + 1) / threads };
+        partials[i].progress = progress;
+
+        // a share that can't get a thread of its own is reduced by the calling thread.
+        started[i] = pthread_create(&workers[i], NULL, &reduce_range, &partials[i]) == 0;
+        if(!started[i])
+            reduce_range(&partials[i]);
+    }
+
+    // every worker is joined before an error is raised, since they all use the partials on this stack.
+    for(int i = 0 ; i < threads ; i++)
+        if(started[i])
+            pthread_join(workers[i], NULL);
+    for(int i = 0 ; i < threads ; i++)
+        if(partials[i].failed)
+            throw_error(partials[i].error);
+
+    stats.min = INFINITY;
+    stats.max = -INFINITY;
+    long min_index = -1, max_index = -1, finite = 0;
+    a_sum sum = { 0, 0 }, squares = { 0, 0 };
+
+    // partials are combined in order, so ties resolve to the leftmost sample.
+    for(int i = 0 ; i < threads ; i++) {
+        a_partial *partial = &partials[i];
+
+        if(partial -> min_index >= 0 && partial -> min < stats.min) {
+            stats.min = partial -> min;
+            min_index = partial -> min_index;
+        }
+        if(partial -> max_index >= 0 && partial -> max > stats.max) {
+            stats.max = partial -> max;
+            max_index = partial -> max_index;
+        }
+        sum_add(&sum, sum_value(&partial -> sum));
+        sum_add(&squares, sum_value(&partial -> squares));
+        finite += partial -> finite;
+    }
+    stats.seconds = now_seconds() - start;
+
+    stats.samples = samples;
+    stats.threads = threads;
+    stats.nonfinite = samples - finite;
+    stats.min = finite > 0 ? stats.min : NAN;
+    stats.max = finite > 0 ? stats.max : NAN;
+    stats.argmin = finite > 0 ? left_bound + min_index * step : NAN;
+    stats.argmax = finite > 0 ? left_bound + max_index * step : NAN;
+    stats.mean = finite > 0 ? sum_value(&sum) / finite : NAN;
+    stats.rms = finite > 0 ? sqrtl(sum_value(&squares) / finite) : NAN;
+    return stats;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <setjmp.h>
+#include <pthread.h>
+
+#ifndef BDEF
+#define BDEF static inline
+#endif
+
+// the amount of lines that are read, evaluated and written together in batch mode.
+#ifndef BATCH_LINES
+#define BATCH_LINES 4096
+#endif
+
+// the length of a single result line in batch mode.
+#ifndef RESULT_LENGTH
+#define RESULT_LENGTH 96
+#endif
+
+// one worker's share of a chunk of lines.
+typedef struct {
+    char **lines;
+    bool *too_long;
+    char *results;
+    int first, last;
+    long first_line;
+    long double base;
+    long errors;
+} b_worker;
+
+// compiles and evaluates a single "expression" or "expression, x" line into its result line. errors in the line
+// are written as the result instead of ending the program.
+BDEF bool evaluate_line(char *line, char *result, long line_number, long double base) {
+    jmp_buf handler;
+    p_data *volatile expression = NULL;
+
+    line[strcspn(line, "\r\n")] = '\0';
+    if(strspn(line, " \t") == strlen(line)) {
+        result[0] = '\0';
+        return true;
+    }
+
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = NULL;
+        destroy_data(expression);
+        snprintf(result, RESULT_LENGTH, "ERROR line %li: %.64s", line_number, error_message);
+        return false;
+    }
+
+    // an optional x value follows the last comma that isn't inside of parentheses.
+    long double x_value = 0;
+    char *comma = NULL;
+    for(int i = 0, depth = 0 ; line[i] != '\0' ; i++) {
+        if(isin(line[i], "([{")) depth++;
+        else if(isin(line[i], ")]}")) depth--;
+        else if(line[i] == ',' && depth == 0) comma = line + i;
+    }
+    if(comma != NULL) {
+        char *end;
+        *comma = '\0';
+        x_value = strtold(comma + 1, &end);
+        if(end == comma + 1 || strspn(end, " \t") != strlen(end))
+            throw_error("invalid x value");
+    }
+
+    expression = calloc(1, sizeof(p_data));
+    expression -> input = eat_whitespace(line, strlen(line));
+    if(strlen(expression -> input) == 0)
+        throw_error("missing expression");
+
+    compile(expression);
+    snprintf(result, RESULT_LENGTH, "%.15Lg", evaluate(x_value, expression, base));
+
+    error_handler = NULL;
+    destroy_data(expression);
+    return true;
+}
+
+// evaluates a worker's share of the chunk.
+BDEF void *evaluate_lines(void *argument) {
+    b_worker *worker = (b_worker *) argument;
+    for(int i = worker -> first ; i < worker -> last ; i++)
+        if(worker -> too_long[i]) {
+            snprintf(worker -> results + i * RESULT_LENGTH, RESULT_LENGTH, "ERROR line %li: expression too long", worker -> first_line + i);
+            worker -> errors++;
+        } else if(!evaluate_line(worker -> lines[i], worker -> results + i * RESULT_LENGTH, worker -> first_line + i, worker -> base))
+            worker -> errors++;
+    return NULL;
+}
+
+// reads expressions from the input until it ends and writes one result line per input line, in input order.
+// lines are read in chunks, and every chunk is split between the worker threads before it is written out.
+BDEF int run_batch(FILE *input, FILE *output, int threads, long double base) {
+    if(threads < 1)
+        threads = 1;
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+
+    char **lines = (char **) calloc(BATCH_LINES, sizeof(char *));
+    for(int i = 0 ; i < BATCH_LINES ; i++)
+        lines[i] = (char *) malloc(MAX_LENGTH);
+    bool *too_long = (bool *) calloc(BATCH_LINES, sizeof(bool));
+    char *results = (char *) malloc(BATCH_LINES * RESULT_LENGTH);
+
+    b_worker workers[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    long line_count = 0, errors = 0;
+
+    // results are written through a large buffer instead of a write per line.
+    setvbuf(output, NULL, _IOFBF, 1 << 16);
+
+    double start = now_seconds();
+    while(true) {
+        int count = 0;
+        while(count < BATCH_LINES && fgets(lines[count], MAX_LENGTH, input) != NULL) {
+            // the rest of a line that doesn't fit is skipped, so that it doesn't turn into extra lines.
+            too_long[count] = strchr(lines[count], '\n') == NULL && !feof(input);
+            if(too_long[count]) {
+                int c;
+                while((c = fgetc(input)) != '\n' && c != EOF) continue;
+            }
+            count++;
+        }
+        if(count == 0)
+            break;
+
+        for(int i = 0 ; i < threads ; i++) {
+            workers[i] = (b_worker) { lines, too_long, results, count * i / threads, count * (i + 1) / threads, line_count + 1, base, 0 };
+            pthread_create(&ids[i], NULL, &evaluate_lines, &workers[i]);
+        }
+        for(int i = 0 ; i < threads ; i++) {
+            pthread_join(ids[i], NULL);
+            errors += workers[i].errors;
+        }
+
+        for(int i = 0 ; i < count ; i++) {
+            fputs(results + i * RESULT_LENGTH, output);
+            fputc('\n', output);
+        }
+        line_count += count;
+    }
+    fflush(output);
+    double seconds = now_seconds() - start;
+
+    fprintf(stderr, "%li expressions (%li errors) on %i threads in %.3fs (%.0f expressions/s)\n", line_count, errors, threads, seconds,
+        seconds > 0 ? line_count / seconds : 0);
+
+    for(int i = 0 ; i < BATCH_LINES ; i++)
+        free(lines[i]);
+    free(lines);
+    free(too_long);
+    free(results);
+    return errors > 0;
+}
@@ -0,0 +1,1287 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include "calc.h"
+#include "instrument.h"
+#include "define.h"
+#include "parser.h"
+#include "graph.h"
+#include "analysis.h"
+#include "grid.h"
+#include "curve.h"
+#include "views.h"
+#include "ftable.h"
+#include "profile.h"
+#include "snapshot.h"
+#include "table.h"
+
+// the expression that the library and process benchmarks evaluate.
+#ifndef BENCH_EXPRESSION
+#define BENCH_EXPRESSION "sin(x)*x^2+3"
+#endif
+
+// how many times each in process benchmark runs.
+#ifndef BENCH_CALLS
+#define BENCH_CALLS 1000000
+#endif
+
+// how many times the calculator is started for the fork/exec benchmark.
+#ifndef BENCH_PROCESSES
+#define BENCH_PROCESSES 200
+#endif
+
+// how many functions the function table benchmark stores.
+#ifndef BENCH_FUNCTIONS
+#define BENCH_FUNCTIONS 10000
+#endif
+
+// how many expressions of each length the compile benchmark compiles.
+#ifndef BENCH_CORPUS
+#define BENCH_CORPUS 64
+#endif
+
+// the width and height of the grid that the grid benchmark evaluates.
+#ifndef BENCH_GRID
+#define BENCH_GRID 4096
+#endif
+
+// the function of x and y that the grid benchmark evaluates.
+#ifndef BENCH_GRID_EXPRESSION
+#define BENCH_GRID_EXPRESSION "sin(x)*cos(y)+x*y/4"
+#endif
+
+// how many commands the soak test sends to one calculator, and how many bytes its resident set size can grow by
+// once it has warmed up.
+#ifndef BENCH_SOAK
+#define BENCH_SOAK 1000000
+#endif
+
+#ifndef BENCH_SOAK_GROWTH
+#define BENCH_SOAK_GROWTH (1 << 20)
+#endif
+
+// how much slower than the baseline a benchmark can get before it counts as a regression.
+#ifndef BENCH_TOLERANCE
+#define BENCH_TOLERANCE 0.25
+#endif
+
+// how many times every benchmark runs, the fastest run is the one reported so that noise from the rest of the
+// machine doesn't look like a regression.
+#ifndef BENCH_REPEATS
+#define BENCH_REPEATS 5
+#endif
+
+// the most results that one run records.
+#ifndef MAX_RESULTS
+#define MAX_RESULTS 128
+#endif
+
+// a benchmark's result, per operation. an operation is whatever the benchmark times: a call, a compile, a frame.
+typedef struct {
+    char name[64];
+    char *section;
+    double ns;
+    double evaluations_per_second;
+    double allocations;
+} bench_result;
+
+static bench_result results[MAX_RESULTS];
+static int result_count = 0;
+static char *section = "";
+
+// the amounts of work, which --quick lowers.
+static long calls = BENCH_CALLS;
+static int processes = BENCH_PROCESSES, function_count = BENCH_FUNCTIONS, repeats = BENCH_REPEATS, grid_size = BENCH_GRID;
+static long soak_commands = BENCH_SOAK;
+
+// the resident set size of the soak test's calculator once it warmed up and at its largest after that.
+static long soak_warm = -1, soak_largest = -1;
+
+// set when a benchmark computed something it shouldn't have, which makes the run fail.
+static int failures = 0;
+
+// calls to malloc, calloc and realloc. calc_bench is linked with -Wl,--wrap for all three (see the Makefile), so
+// every allocation that the library and the headers make is counted on its way to the real allocator.
+static long allocations = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    allocations++;
+    return __real_realloc(pointer, size);
+}
+
+extern char **environ;
+
+// returns the result with a name, or NULL if there isn't one yet.
+bench_result *find_result(char *name) {
+    for(int i = 0 ; i < result_count ; i++)
+        if(strcmp(results[i].name, name) == 0)
+            return &results[i];
+    return NULL;
+}
+
+// records a result, keeping the fastest of the repeats. evaluations is the total amount of function evaluations
+// that the operations did.
+void record(char *name, double seconds, long operations, long evaluations, long allocated) {
+    if(operations <= 0)
+        return;
+
+    bench_result *result = find_result(name);
+    if(result == NULL) {
+        if(result_count >= MAX_RESULTS)
+            return;
+        result = &results[result_count++];
+        snprintf(result -> name, sizeof(result -> name), "%s", name);
+        result -> section = section;
+    } else if(result -> ns <= seconds / operations * 1e9)
+        return;
+
+    result -> ns = seconds / operations * 1e9;
+    result -> evaluations_per_second = evaluations > 0 && seconds > 0 ? evaluations / seconds : 0;
+    result -> allocations = (double) allocated / operations;
+}
+
+// prints the results under the section that they were recorded in.
+void print_results() {
+    for(int i = 0 ; i < result_count ; i++) {
+        bench_result *result = &results[i];
+        if(i == 0 || strcmp(result -> section, results[i - 1].section) != 0)
+            printf("%s%s:\n", i == 0 ? "" : "\n", result -> section);
+
+        printf("%-32s %14.1f ns/op", result -> name, result -> ns);
+        if(result -> evaluations_per_second > 0) printf(" %14.0f evals/s", result -> evaluations_per_second);
+        else printf(" %22s", "");
+        printf(" %10.2f allocs/op\n", result -> allocations);
+    }
+}
+
+// reports a benchmark that computed the wrong thing.
+void check(bool passed, char *name, char *what) {
+    if(passed)
+        return;
+
+    printf("ERROR: %s: %s\n", name, what);
+    failures++;
+}
+
+// returns whether two values agree to a relative tolerance, values that aren't numbers agree with each other.
+bool agrees(long double a, long double b, long double tolerance) {
+    if(isnan(a) || isnan(b))
+        return isnan(a) && isnan(b);
+    if(isinf(a) || isinf(b))
+        return a == b;
+    return fabsl(a - b) <= tolerance * fmaxl(1, fmaxl(fabsl(a), fabsl(b)));
+}
+
+// evaluates an expression by starting the calculator in batch mode and reading its answer, the way a service
+// without the library has to.
+int evaluate_process(char *calculator, char *line, char *answer, int size) {
+    int to_child[2], from_child[2];
+    if(pipe(to_child) != 0 || pipe(from_child) != 0)
+        return 1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, to_child[0], 0);
+    posix_spawn_file_actions_adddup2(&actions, from_child[1], 1);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", 1, 0);
+    posix_spawn_file_actions_addclose(&actions, to_child[1]);
+    posix_spawn_file_actions_addclose(&actions, from_child[0]);
+
+    char *arguments[] = { calculator, "--batch", "-j", "1", NULL };
+    pid_t child;
+    int failed = posix_spawn(&child, calculator, &actions, NULL, arguments, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(to_child[0]);
+    close(from_child[1]);
+
+    if(!failed && write(to_child[1], line, strlen(line)) != (ssize_t) strlen(line))
+        failed = 1;
+    close(to_child[1]);
+
+    int length = 0;
+    ssize_t got;
+    while(!failed && length < size - 1 && (got = read(from_child[0], answer + length, size - 1 - length)) > 0)
+        length += got;
+    answer[length] = '\0';
+    close(from_child[0]);
+
+    if(!failed)
+        waitpid(child, NULL, 0);
+    return failed;
+}
+
+// times a fixed loop that doesn't use any of the calculator's code. a baseline from a faster or slower machine (or
+// the same machine under a different load) is scaled by how this loop's time changed before it is compared.
+void bench_calibration() {
+    long double value = 1;
+    double start = now_seconds();
+    for(long i = 0 ; i < calls ; i++)
+        value = sqrtl(value * 1.000001L + i);
+    record("calibration", now_seconds() - start, calls, 0, 0);
+
+    volatile long double sink = value;
+    (void) sink;
+}
+
+// compares calling the library with compiling on every call and with starting the calculator for every evaluation.
+void bench_library(char *calculator) {
+    calc_context *context = calc_context_new();
+    calc_expr *expression;
+    long double value = 0, sum = 0;
+
+    if(calc_compile(context, BENCH_EXPRESSION, &expression) != CALC_OK) {
+        check(false, "calc_compile", (char *) calc_error(context));
+        calc_context_free(context);
+        return;
+    }
+
+    // evaluating an expression that was compiled once.
+    long before = allocations;
+    double start = now_seconds();
+    for(long i = 0 ; i < calls ; i++) {
+        calc_eval(context, expression, i * 1e-6L, &value);
+        sum += value;
+    }
+    record("calc_eval", now_seconds() - start, calls, calls, allocations - before);
+
+    // the same values a batch at a time.
+    long double xvalues[1024], values[1024];
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls ; i += 1024) {
+        for(int j = 0 ; j < 1024 ; j++)
+            xvalues[j] = (i + j) * 1e-6L;
+        calc_eval_batch(context, expression, xvalues, values, 1024);
+        sum += values[0];
+    }
+    record("calc_eval_batch", now_seconds() - start, calls, calls, allocations - before);
+
+    // compiling, evaluating and freeing on every call, which is the closest in process match for a new process.
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls / 10 ; i++) {
+        calc_expr *compiled;
+        calc_compile(context, BENCH_EXPRESSION, &compiled);
+        calc_eval(context, compiled, i * 1e-6L, &value);
+        calc_free(compiled);
+        sum += value;
+    }
+    record("calc_compile + eval + free", now_seconds() - start, calls / 10, calls / 10, allocations - before);
+
+    // starting the calculator for every evaluation.
+    char answer[128];
+    int started = 0;
+    start = now_seconds();
+    for(int i = 0 ; i < processes ; i++) {
+        if(evaluate_process(calculator, BENCH_EXPRESSION ", 0.5\n", answer, sizeof(answer)) != 0) {
+            printf("ERROR: could not run \"%s\".\n", calculator);
+            break;
+        }
+        started++;
+    }
+    if(started > 0)
+        record("fork/exec --batch", now_seconds() - start, started, started, 0);
+
+    calc_eval(context, expression, 0.5, &value);
+    if(started > 0)
+        check(agrees(value, strtold(answer, NULL), 1e-9), "fork/exec --batch", "the calculator's answer differs from the library's");
+
+    // a malformed expression is a syntax error when it's compiled, not an evaluation error later on.
+    calc_expr *malformed = NULL;
+    check(calc_compile(context, "x+", &malformed) == CALC_ERROR_SYNTAX && malformed == NULL, "calc_compile", "x+ compiled without a syntax error");
+
+    // the sum keeps the loops from being optimized away.
+    volatile long double sink = sum;
+    (void) sink;
+
+    calc_free(expression);
+    calc_context_free(context);
+}
+
+// writes an expression of about the given length made of a mix of terms into out.
+void make_expression(char *out, int length, int seed) {
+    static char *terms[] = { "sin(x)", "cos(2x)", "x^3", "log(x^2+1)", "(x+1)/(x-2)", "tan(x/3)", "3.14159x", "sec(x)^2", "pi*x", "e^x",
+        "2^x", "csc(x+1)", "(x-1)*(x+4)", "cot(x)^2", "7x^2" };
+    static char operators[] = "+-*+";
+    int count = sizeof(terms) / sizeof(terms[0]);
+
+    // the first term is the first one from the seed on that fits, so that even short expressions are whole.
+    int first = seed % count;
+    while((int) strlen(terms[first]) > length)
+        first = (first + 1) % count;
+    strcpy(out, terms[first]);
+    for(int i = 1 ; ; i++) {
+        char *term = terms[(seed * 7 + i * 11) % count];
+        int used = strlen(out);
+        if(used + 1 + (int) strlen(term) > length)
+            break;
+        out[used] = operators[(seed + i) % 4];
+        strcpy(out + used + 1, term);
+    }
+}
+
+// compiles a corpus of short to huge expressions.
+void bench_compile() {
+    static struct { char *name; int length; } sizes[] = {
+        { "compile short (~8)", 8 }, { "compile medium (~40)", 40 }, { "compile long (~120)", 120 }, { "compile huge (~250)", MAX_LENGTH - 6 }
+    };
+    char (*corpus)[MAX_LENGTH] = malloc(BENCH_CORPUS * sizeof(*corpus));
+
+    for(int s = 0 ; s < (int) (sizeof(sizes) / sizeof(sizes[0])) ; s++) {
+        for(int i = 0 ; i < BENCH_CORPUS ; i++) {
+            make_expression(corpus[i], sizes[s].length, i);
+            p_data *data = compile_function(corpus[i]);
+            check(data != NULL, sizes[s].name, "an expression in the corpus doesn't compile");
+            destroy_data(data);
+        }
+
+        long rounds = calls / 100 / BENCH_CORPUS + 1, compiled = 0;
+        long before = allocations;
+        double start = now_seconds();
+        for(long r = 0 ; r < rounds ; r++)
+            for(int i = 0 ; i < BENCH_CORPUS ; i++, compiled++)
+                destroy_data(compile_function(corpus[i]));
+        record(sizes[s].name, now_seconds() - start, compiled, 0, allocations - before);
+    }
+    free(corpus);
+
+    // the groupings that changed when comparisons and if() were added, with the value each expression has now and the
+    // one it had before (which is what a function saved back then was drawn as), and some that stayed the same.
+    static struct { char *expression; long double x, value, before; } groupings[] = {
+        { "3-2x+1", 1, 2, 0 }, { "x-1-1", 5, 3, 5 }, { "8/2/2", 0, 2, 8 }, { "8/2*2", 0, 8, 2 }, { "x/2x", 4, 8, 0.5 },
+        { "2*-3", 0, -6, -3 }, { "2^-1", 0, 0.5, 0 }, { "sinx+1", 2, 1.909297426825682L, 0.141120008059867L },
+        { "sinx^2", 2, -0.756802495307928L, -0.756802495307928L }, { "-x^2", 3, -9, -9 }, { "2^3^2", 0, 512, 512 }
+    };
+    for(int i = 0 ; i < (int) (sizeof(groupings) / sizeof(groupings[0])) ; i++) {
+        char what[128];
+        p_data *data = compile_function(groupings[i].expression);
+        long double value = data != NULL ? evaluate(groupings[i].x, data, 10) : NAN;
+        snprintf(what, sizeof(what), "%s at %Lg is %Lg, not %Lg (it was %Lg before comparisons)", groupings[i].expression, groupings[i].x, value,
+            groupings[i].value, groupings[i].before);
+        check(agrees(value, groupings[i].value, 1e-12), "grouping", what);
+        destroy_data(data);
+    }
+}
+
+// the opcode mixes that the evaluation benchmarks run.
+static struct { char *name; char *expression; } mixes[] = {
+    { "polynomial", "x^3-2x^2+x-1" },
+    { "arithmetic", "(x+1)/(x+2)*3-x/7" },
+    { "power", "x^2.5+2^x" },
+    { "trig", "sin(x)+cos(x)*tan(x)" },
+    { "reciprocal trig", "csc(x)+sec(x)-cot(x)" },
+    { "log", "log(x^2+1)+log(x+3)" },
+    { "mixed", BENCH_EXPRESSION }
+};
+
+#define MIX_COUNT (int) (sizeof(mixes) / sizeof(mixes[0]))
+
+// evaluates every opcode mix one x value at a time and a block at a time.
+void bench_evaluate() {
+    long double xvalues[1024], values[1024];
+    for(int j = 0 ; j < 1024 ; j++)
+        xvalues[j] = 0.5 + j * 1e-3L;
+
+    for(int m = 0 ; m < MIX_COUNT ; m++) {
+        char name[64];
+        p_data *data = compile_function(mixes[m].expression);
+        if(data == NULL) {
+            check(false, mixes[m].name, "the expression doesn't compile");
+            continue;
+        }
+
+        long double sum = 0;
+        long before = allocations;
+        double start = now_seconds();
+        for(long i = 0 ; i < calls ; i++)
+            sum += evaluate(xvalues[i & 1023], data, 10);
+        snprintf(name, sizeof(name), "evaluate %s", mixes[m].name);
+        record(name, now_seconds() - start, calls, calls, allocations - before);
+
+        before = allocations;
+        start = now_seconds();
+        for(long i = 0 ; i < calls ; i += 1024) {
+            evaluate_batch(data, xvalues, values, 1024, 10);
+            sum += values[i & 1023];
+        }
+        snprintf(name, sizeof(name), "evaluate_batch %s", mixes[m].name);
+        record(name, now_seconds() - start, calls, calls, allocations - before);
+
+        bool same = true;
+        for(int j = 0 ; j < 1024 ; j++)
+            same &= agrees(values[j], evaluate(xvalues[j], data, 10), 1e-12);
+        check(same, name, "the batch evaluator disagrees with evaluate()");
+
+        volatile long double sink = sum;
+        (void) sink;
+        destroy_data(data);
+    }
+}
+
+// piecewise functions written with abs, min, max and if, and the same functions written as formulas the way they had
+// to be before, with |u| as (u^2)^0.5.
+static struct { char *name; char *conditional; char *formula; } piecewise[] = {
+    { "abs", "abs(x)", "(x^2)^0.5" },
+    { "clip", "min(max(x,-0.5),0.5)", "((x-0.5+((x+0.5)^2)^0.5)/2+0.5-(((x-0.5+((x+0.5)^2)^0.5)/2-0.5)^2)^0.5)/2" },
+    { "tiered", "if(x<0,2x,1.5x)", "1.75x-0.25x*x/(x^2)^0.5" }
+};
+
+#define PIECEWISE_COUNT (int) (sizeof(piecewise) / sizeof(piecewise[0]))
+
+// evaluates every piecewise function and its formula one x value at a time and a block at a time, over values on
+// both sides of where the pieces meet, so that every block takes both branches.
+void bench_conditionals() {
+    long double xvalues[1024], values[1024];
+    for(int j = 0 ; j < 1024 ; j++)
+        xvalues[j] = -1.0003 + j * 1.953e-3L;
+
+    for(int p = 0 ; p < PIECEWISE_COUNT ; p++) {
+        p_data *conditional = compile_function(piecewise[p].conditional), *formula = compile_function(piecewise[p].formula);
+        if(conditional == NULL || formula == NULL) {
+            check(false, piecewise[p].name, "the expressions don't compile");
+            destroy_data(conditional);
+            destroy_data(formula);
+            continue;
+        }
+
+        p_data *programs[2] = { conditional, formula };
+        char *kinds[2] = { "", " formula" };
+        for(int k = 0 ; k < 2 ; k++) {
+            char name[64];
+            long double sum = 0;
+            long before = allocations;
+            double start = now_seconds();
+            for(long i = 0 ; i < calls ; i++)
+                sum += evaluate(xvalues[i & 1023], programs[k], 10);
+            snprintf(name, sizeof(name), "evaluate %s%s", piecewise[p].name, kinds[k]);
+            record(name, now_seconds() - start, calls, calls, allocations - before);
+
+            before = allocations;
+            start = now_seconds();
+            for(long i = 0 ; i < calls ; i += 1024) {
+                evaluate_batch(programs[k], xvalues, values, 1024, 10);
+                sum += values[i & 1023];
+            }
+            snprintf(name, sizeof(name), "evaluate_batch %s%s", piecewise[p].name, kinds[k]);
+            record(name, now_seconds() - start, calls, calls, allocations - before);
+
+            bool same = true, formula_agrees = true;
+            for(int j = 0 ; j < 1024 ; j++) {
+                same &= agrees(values[j], evaluate(xvalues[j], programs[k], 10), 1e-12);
+                formula_agrees &= agrees(evaluate(xvalues[j], conditional, 10), evaluate(xvalues[j], formula, 10), 1e-9);
+            }
+            check(same, name, "the batch evaluator disagrees with evaluate()");
+            check(formula_agrees, name, "the piecewise function and its formula disagree");
+
+            volatile long double sink = sum;
+            (void) sink;
+        }
+        destroy_data(conditional);
+        destroy_data(formula);
+    }
+}
+
+// renders full frames: every opcode mix as lines, and one function shaded over the whole plane.
+void bench_render() {
+    p_data *functions[MIX_COUNT];
+    int count = 0;
+    for(int m = 0 ; m < MIX_COUNT ; m++)
+        if((functions[count] = compile_function(mixes[m].expression)) != NULL)
+            count++;
+
+    long double x_steps = 20 / WINDOW_WIDTH, y_steps = 20 / WINDOW_HEIGHT;
+    pixel **display = quantify_plane(x_steps, y_steps, -10, 10);
+
+    long frames = calls / 10000 + 1;
+    long before = allocations;
+    double start = now_seconds();
+    for(long f = 0 ; f < frames ; f++) {
+        draw_plane(display, x_steps, y_steps);
+        draw_line(display, functions, x_steps, y_steps, &evaluate, count);
+    }
+    record("render frame (draw_line)", now_seconds() - start, frames, frames * count * (long) WINDOW_WIDTH, allocations - before);
+
+    // a progressive render takes the evaluations of draw_line() in all, its first frame only an eighth of them, and its
+    // last frame is the same as draw_line()'s.
+    pixel **progressive = quantify_plane(x_steps, y_steps, -10, 10);
+    double first = 0, final = 0;
+    long evaluations = 0;
+    before = allocations;
+    for(long f = 0 ; f < frames ; f++) {
+        g_progressive result = draw_progressive(progressive, functions, x_steps, y_steps, &evaluate, count, NULL, NULL);
+        first += result.first;
+        final += result.final;
+        evaluations += result.evaluations;
+    }
+    record("first frame (draw_progressive)", first, frames, frames * count * (long) (WINDOW_WIDTH / PROGRESSIVE_STRIDE), allocations - before);
+    record("render frame (draw_progressive)", final, frames, evaluations, allocations - before);
+    check(evaluations == frames * count * (long) WINDOW_WIDTH, "render frame (draw_progressive)", "takes other evaluations than draw_line()");
+
+    bool same = true;
+    for(int y = 0 ; y < WINDOW_HEIGHT ; y++)
+        for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+            same &= progressive[y][x].display == display[y][x].display;
+    check(same, "render frame (draw_progressive)", "the last frame differs from draw_line()");
+    clear_display(progressive);
+
+    // the plane is drawn before shading, so a frame looks the way /integrate shows it.
+    frames = calls / 100000 + 1;
+    before = allocations;
+    start = now_seconds();
+    for(long f = 0 ; f < frames ; f++) {
+        draw_plane(display, x_steps, y_steps);
+        shade_graph(display, functions, x_steps, y_steps, MIX_COUNT - 1, -5, 5);
+    }
+    record("render frame (shade_graph)", now_seconds() - start, frames, frames * (long) (WINDOW_WIDTH * WINDOW_HEIGHT), allocations - before);
+
+    int marked = 0;
+    for(int y = 0 ; y < WINDOW_HEIGHT ; y++)
+        for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+            marked += display[y][x].display == '#';
+    check(marked > 0, "render frame (shade_graph)", "nothing was shaded");
+
+    // curves are sampled until every step is a cell long, the evaluations are those of both components.
+    p_data *circle[2] = { compile_function("8cos(x)"), compile_function("8sin(3x)") }, *rose = compile_function("9cos(4x)");
+    c_curve curves[2] = { { circle[0], circle[1], false, 0, 2 * M_PI }, { rose, NULL, true, 0, 2 * M_PI } };
+    char *curve_names[2] = { "render frame (draw_curve)", "render frame (polar curve)" };
+    for(int c = 0 ; c < 2 ; c++) {
+        long evaluations = 0;
+        frames = calls / 100000 + 1;
+        before = allocations;
+        start = now_seconds();
+        for(long f = 0 ; f < frames ; f++) {
+            draw_plane(display, x_steps, y_steps);
+            evaluations += draw_curve(display, &curves[c], x_steps, y_steps).evaluations;
+        }
+        record(curve_names[c], now_seconds() - start, frames, evaluations, allocations - before);
+
+        // the curves go around the window, so they draw far more cells than a few scattered samples would.
+        marked = 0;
+        for(int y = 0 ; y < WINDOW_HEIGHT ; y++)
+            for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+                marked += display[y][x].display != ' ' && !close_to(display[y][x].x, 0, x_steps / 2.1) && !close_to(display[y][x].y, 0, y_steps / 2.1);
+        check(marked > CURVE_SAMPLES, curve_names[c], "the curve wasn't drawn a cell at a time");
+    }
+    destroy_data(circle[0]);
+    destroy_data(circle[1]);
+    destroy_data(rose);
+
+    // the three views of /analyze from one sample per column, which takes far fewer evaluations than drawing them
+    // separately, and integrates to the same area.
+    p_data *sine = compile_function("sin(x)");
+    long double area = 0;
+    evaluations = 0;
+    frames = calls / 10000 + 1;
+    before = allocations;
+    start = now_seconds();
+    for(long f = 0 ; f < frames ; f++) {
+        v_analysis analysis = draw_views(display, sine, x_steps, y_steps, 0, M_PI);
+        area = analysis.area;
+        evaluations += analysis.evaluations;
+    }
+    record("analyze frame (draw_views)", now_seconds() - start, frames, evaluations, allocations - before);
+    check(agrees(area, 2, 1e-4), "analyze frame (draw_views)", "the area under sin(x) over [0, pi] isn't 2");
+    check(evaluations / frames * 100 < separate_evaluations(sine), "analyze frame (draw_views)", "takes as many evaluations as drawing the views separately");
+    destroy_data(sine);
+
+    clear_display(display);
+    for(int i = 0 ; i < count ; i++)
+        destroy_data(functions[i]);
+}
+
+// evaluates a function of x and y over a grid: a point at a time the way a frame would without grids, a row at a
+// time on one thread, and a row at a time on every thread. then an implicit curve frame, which samples its own grid.
+void bench_grid() {
+    p_data *function = compile_function(BENCH_GRID_EXPRESSION);
+    z_grid *grid = grid_new(grid_size, grid_size, -10, 10, 10, -10);
+    long points = (long) grid_size * grid_size;
+
+    long before = allocations;
+    double start = now_seconds();
+    double sink = 0;
+    for(int row = 0 ; row < grid_size ; row++) {
+        long double y = grid_y(grid, row);
+        for(int column = 0 ; column < grid_size ; column++)
+            sink += (double) evaluate_xy(grid_x(grid, column), y, function, base);
+    }
+    record("grid: point by point", now_seconds() - start, 1, points, allocations - before);
+
+    before = allocations;
+    double seconds = evaluate_grid(function, grid, 1, base);
+    record("grid: by rows, one thread", seconds, 1, points, allocations - before);
+
+    before = allocations;
+    seconds = evaluate_grid(function, grid, 0, base);
+    record("grid: by rows, every thread", seconds, 1, points, allocations - before);
+
+    // the threaded grid has to be the same as evaluating its points one at a time.
+    bool agrees = true;
+    double total = 0;
+    for(int row = 0 ; row < grid_size ; row++)
+        for(int column = 0 ; column < grid_size ; column++) {
+            double value = grid -> values[(size_t) row * grid_size + column];
+            total += value;
+            if(row % 97 == 0 && column % 89 == 0)
+                agrees = agrees && value == (double) evaluate_xy(grid_x(grid, column), grid_y(grid, row), function, base);
+        }
+    check(agrees, "grid: by rows, every thread", "disagrees with evaluating a point at a time");
+    check(fabs(total - sink) <= 1e-6 * (fabs(sink) + 1), "grid: by rows, every thread", "sums to something else than a point at a time");
+
+    long double x_steps = 20 / WINDOW_WIDTH, y_steps = 20 / WINDOW_HEIGHT;
+    pixel **display = quantify_plane(x_steps, y_steps, -10, 10);
+    long frames = calls / 10000 + 1;
+    before = allocations;
+    start = now_seconds();
+    for(long f = 0 ; f < frames ; f++) {
+        draw_plane(display, x_steps, y_steps);
+        draw_implicit(display, function, x_steps, y_steps, 1, base);
+    }
+    record("implicit frame (marching squares)", now_seconds() - start, frames, frames * (long) ((WINDOW_WIDTH + 1) * (WINDOW_HEIGHT + 1)), allocations - before);
+
+    clear_display(display);
+    grid_free(grid);
+    destroy_data(function);
+}
+
+// integrates and differentiates a polynomial, which has exact paths, and a function that has to be sampled.
+void bench_analysis() {
+    p_data *polynomial = compile_function("x^3-2x^2+x-1"), *sampled = compile_function(BENCH_EXPRESSION), *sine = compile_function("sin(x)");
+    if(polynomial == NULL || sampled == NULL || sine == NULL) {
+        check(false, "integrate", "the expressions don't compile");
+        destroy_data(polynomial);
+        destroy_data(sampled);
+        destroy_data(sine);
+        return;
+    }
+
+    // integrate() takes about 100000 samples whatever the bounds are.
+    long double sum = 0;
+    long integrals = calls / 100000 + 1;
+    long before = allocations;
+    double start = now_seconds();
+    for(long i = 0 ; i < integrals ; i++)
+        sum += integrate(0, 10 + i * 1e-3L, sampled, 10);
+    record("integrate (sampled)", now_seconds() - start, integrals, integrals * 100000, allocations - before);
+
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls ; i++)
+        sum += integrate(0, 10 + (i & 1023) * 1e-3L, polynomial, 10);
+    record("integrate (polynomial)", now_seconds() - start, calls, 0, allocations - before);
+
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls ; i++)
+        sum += derive(0.5 + (i & 1023) * 1e-3L, sampled, 10);
+    record("derive (sampled)", now_seconds() - start, calls, 2 * calls, allocations - before);
+
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls ; i++)
+        sum += derive(0.5 + (i & 1023) * 1e-3L, polynomial, 10);
+    record("derive (polynomial)", now_seconds() - start, calls, 0, allocations - before);
+
+    check(agrees(integrate(0, M_PI, sine, 10), 2, 1e-3), "integrate (sampled)", "the integral of sin(x) over [0, pi] isn't 2");
+    check(agrees(derive(0, sine, 10), 1, 1e-4), "derive (sampled)", "the derivative of sin(x) at 0 isn't 1");
+
+    // reversed bounds give the negated integral on both paths.
+    check(agrees(integrate(M_PI, 0, sine, 10), -2, 1e-3), "integrate (sampled)", "the integral of sin(x) from pi to 0 isn't -2");
+    check(agrees(integrate(2, 0, polynomial, 10), -integrate(0, 2, polynomial, 10), 1e-12), "integrate (polynomial)", "reversed bounds don't negate the integral");
+
+    // the exact paths have to agree with sampling the same program.
+    p_data program = *polynomial;
+    program.polynomial = false;
+    check(agrees(integrate(0, 2, polynomial, 10), integrate(0, 2, &program, 10), 1e-3), "integrate (polynomial)", "the exact integral disagrees with sampling");
+    check(agrees(derive(2, polynomial, 10), derive(2, &program, 10), 1e-4), "derive (polynomial)", "the exact derivative disagrees with sampling");
+
+    // a power of a factor isn't expanded, which would lose a repeated root's neighbourhood to cancellation.
+    p_data *repeated = compile_function("(x-1)^10");
+    check(repeated != NULL && !repeated -> polynomial && agrees(evaluate(1.001L, repeated, 10), 1e-30L, 1e-9), "evaluate near a repeated root",
+        "(x-1)^10 at 1.001 isn't 1e-30");
+    check(repeated != NULL && agrees(evaluate(1 + 1e-6L, repeated, 10), 1e-60L, 1e-6), "evaluate near a repeated root", "(x-1)^10 at 1+1e-6 isn't 1e-60");
+    destroy_data(repeated);
+
+    volatile long double sink = sum;
+    (void) sink;
+    destroy_data(polynomial);
+    destroy_data(sampled);
+    destroy_data(sine);
+}
+
+// what the instrumentation costs: off, the way every other benchmark runs, and on. "make overhead" compares all of the
+// benchmarks with a build that has no instrumentation at all.
+void bench_instrumentation() {
+    p_data *function = compile_function(BENCH_EXPRESSION);
+    char expression[MAX_LENGTH];
+    make_expression(expression, 40, 0);
+    if(function == NULL) {
+        check(false, "instrumentation", "the expression doesn't compile");
+        return;
+    }
+
+    for(int on = 0 ; on < 2 ; on++) {
+        if(instrument_enable(on) != on)
+            break;
+        instrument_reset();
+
+        char name[64];
+        long double sum = 0;
+        long before = allocations;
+        double start = now_seconds();
+        for(long i = 0 ; i < calls ; i++)
+            sum += evaluate(0.5 + (i & 1023) * 1e-3L, function, 10);
+        snprintf(name, sizeof(name), "evaluate, instrumentation %s", on ? "on" : "off");
+        record(name, now_seconds() - start, calls, calls, allocations - before);
+        check(calc_instrument.evaluations == (on ? calls : 0), name, "the evaluations weren't counted");
+
+        long compiles = calls / 100 + 1;
+        before = allocations;
+        start = now_seconds();
+        for(long i = 0 ; i < compiles ; i++)
+            destroy_data(compile_function(expression));
+        snprintf(name, sizeof(name), "compile, instrumentation %s", on ? "on" : "off");
+        record(name, now_seconds() - start, compiles, 0, allocations - before);
+        check(calc_instrument.timers[PHASE_tokenize].calls == (on ? compiles : 0), name, "the compiles weren't timed");
+
+        volatile long double sink = sum;
+        (void) sink;
+    }
+
+    instrument_enable(false);
+    instrument_reset();
+    destroy_data(function);
+}
+
+// profiles an expression with a part that's repeated, a constant part and an if, timing every instruction on its own.
+// the profile has to count the branches as the scalar evaluator runs them, and find what could be shared or folded.
+void bench_profile() {
+    p_data *data = compile_expression("sin(x)^2+sin(x)^2*(2^3+1)+if(x<0,x,log(x))", true);
+    if(data == NULL) {
+        check(false, "profile", "the expression doesn't compile");
+        return;
+    }
+
+    long samples = calls / 10 + 1;
+    long before = allocations;
+    double start = now_seconds();
+    r_profile profile = profile_expression(data, -10, 10, samples);
+    record("profile (every instruction timed)", now_seconds() - start, 1, samples, allocations - before);
+
+    bool shared = false, folded = false, branches = false;
+    for(int i = 0 ; i < profile.count ; i++) {
+        r_node *node = &profile.nodes[i];
+        shared |= node -> same >= 0;
+        folded |= node -> constant && node -> child_count > 0;
+        if(data -> program[i].op == '?')
+            branches = profile.nodes[node -> children[1]].calls + profile.nodes[node -> children[2]].calls == samples;
+    }
+    check(profile.root >= 0 && profile.nodes[profile.root].calls == samples, "profile (every instruction timed)", "the expression wasn't run at every point");
+    check(branches, "profile (every instruction timed)", "the branches of the if don't add up to every point");
+    check(shared, "profile (every instruction timed)", "the repeated sin(x)^2 wasn't found");
+    check(folded, "profile (every instruction timed)", "the constant 2^3+1 wasn't found");
+    profile_free(&profile);
+    destroy_data(data);
+}
+
+// tabulates an expression as csv and as binary into /dev/null.
+void bench_table() {
+    p_data *function = compile_function(BENCH_EXPRESSION);
+    char *names[] = { BENCH_EXPRESSION };
+    FILE *output = fopen("/dev/null", "w");
+    if(function == NULL || output == NULL) {
+        check(false, "tabulate", "the table can't be written");
+        destroy_data(function);
+        if(output != NULL) fclose(output);
+        return;
+    }
+
+    static struct { char *name; t_format format; } formats[] = { { "tabulate csv", FORMAT_csv }, { "tabulate binary", FORMAT_binary } };
+    for(int f = 0 ; f < 2 ; f++) {
+        long before = allocations;
+        t_result result = write_table(&function, names, 1, 0, (calls - 1) * 1e-3L, 1e-3L, output, formats[f].format, 10);
+        record(formats[f].name, result.seconds, result.points, result.points, allocations - before);
+        check(result.points == calls, formats[f].name, "the wrong amount of points was written");
+    }
+
+    fclose(output);
+    destroy_data(function);
+
+    // csv values have to read back as the doubles that were written, from subnormals to the largest double.
+    double edges[] = { 0.1, 1.0 / 3, 2.0 / 3, 1e23, 9007199254740993.0, DBL_MIN, DBL_MAX, DBL_TRUE_MIN, -5e-324, 123456789012345678.0 };
+    uint64_t state = 88172645463325252ULL;
+    int wrong = 0;
+    for(long i = 0 ; i < calls / 10 + 10 ; i++) {
+        double value;
+        if(i < 10) value = edges[i];
+        else {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            memcpy(&value, &state, sizeof(value));
+            if(!isfinite(value))
+                continue;
+        }
+
+        char text[32];
+        text[format_double(text, value)] = '\0';
+        wrong += strtod(text, NULL) != value;
+    }
+    check(wrong == 0, "tabulate csv", "a value doesn't read back as the double it was written from");
+}
+
+// loads a large function table from a save file and from a snapshot, looks functions up by name and index, and
+// draws all of them.
+void bench_function_table() {
+    char text_name[] = "/tmp/calc_bench_XXXXXX", snapshot_name[64];
+    int descriptor = mkstemp(text_name);
+    FILE *file = fdopen(descriptor, "w+");
+    for(int i = 0 ; i < function_count ; i++)
+        if(i % 2 == 0) fprintf(file, "g%i = %i*x^2+%i*x-%i\n", i, i % 7 + 1, i % 13, i % 5);
+        else fprintf(file, "g%i = sin(%i*x)+cos(x)^2-log(x^2+%i)\n", i, i % 7 + 1, i % 13 + 1);
+    fflush(file);
+    rewind(file);
+    snprintf(snapshot_name, sizeof(snapshot_name), "%s.snapshot", text_name);
+
+    f_table *table = ftable_new();
+    long before = allocations;
+    double start = now_seconds();
+    int loaded = ftable_read(table, file);
+    record("table: load and compile text", now_seconds() - start, 1, 0, allocations - before);
+    fclose(file);
+
+    // a cold start from the snapshot checks that it is up to date with the text and maps it instead of compiling.
+    long double window[4] = { -10, 10, -10, 10 }, snapshot_base = 10;
+    write_snapshot(snapshot_name, table, window, 10, hash_sources(text_name, "/dev/null"));
+    f_table *mapped = ftable_new();
+    before = allocations;
+    start = now_seconds();
+    int failed = read_snapshot(snapshot_name, mapped, window, &snapshot_base, hash_sources(text_name, "/dev/null"));
+    record("table: load snapshot", now_seconds() - start, 1, 0, allocations - before);
+    check(loaded == function_count && !failed && mapped -> live == table -> live, "table: load snapshot", "the snapshot doesn't hold every function");
+    remove(text_name);
+    remove(snapshot_name);
+
+    // the keys are made up front, so that only the lookups are timed.
+    char (*names)[16] = malloc(1024 * sizeof(*names)), (*indices)[16] = malloc(1024 * sizeof(*indices));
+    for(int i = 0 ; i < 1024 ; i++) {
+        snprintf(names[i], 16, "g%i", (i * 7919) % function_count);
+        snprintf(indices[i], 16, "%i", (i * 7919) % function_count + 1);
+    }
+
+    long found = 0;
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls ; i++)
+        found += ftable_find(table, names[i & 1023]) >= 0;
+    record("table: lookup by name", now_seconds() - start, calls, 0, allocations - before);
+
+    before = allocations;
+    start = now_seconds();
+    for(long i = 0 ; i < calls ; i++)
+        found += ftable_find(table, indices[i & 1023]) >= 0;
+    record("table: lookup by index", now_seconds() - start, calls, 0, allocations - before);
+    check(found == 2 * calls, "table: lookup by name", "a lookup didn't find its function");
+
+    long double x_steps = 20 / WINDOW_WIDTH, y_steps = 20 / WINDOW_HEIGHT;
+    pixel **display = quantify_plane(x_steps, y_steps, -10, 10);
+    p_data **selected = malloc((table -> size + 1) * sizeof(p_data *));
+    before = allocations;
+    start = now_seconds();
+    draw_plane(display, x_steps, y_steps);
+    int count = ftable_select(table, NULL, 0, selected, NULL);
+    draw_line(display, selected, x_steps, y_steps, &evaluate, count);
+    record("table: render every function", now_seconds() - start, 1, count * (long) WINDOW_WIDTH, allocations - before);
+
+    before = allocations;
+    start = now_seconds();
+    draw_plane(display, x_steps, y_steps);
+    count = ftable_select(mapped, NULL, 0, selected, NULL);
+    draw_line(display, selected, x_steps, y_steps, &evaluate, count);
+    record("table: render from the snapshot", now_seconds() - start, 1, count * (long) WINDOW_WIDTH, allocations - before);
+
+    start = now_seconds();
+    ftable_free(table);
+    record("table: free", now_seconds() - start, 1, 0, 0);
+    ftable_free(mapped);
+
+    clear_display(display);
+    free(selected);
+    free(names);
+    free(indices);
+}
+
+// evaluates an expression that calls definitions against the same expression pasted out by hand, and redefines a
+// variable that every tenth function of a function table uses.
+void bench_definitions() {
+    char message[MAX_LENGTH];
+    d_previous previous;
+    definition_set(&calc_definitions, "a", NULL, "3.2", &previous, message, sizeof(message));
+    definition_set(&calc_definitions, "g", "u", "u^2+sin(u)", &previous, message, sizeof(message));
+
+    p_data *inlined = compile_function("g(x)*a+g(2x)"), *pasted = compile_function("(x^2+sin(x))*3.2+((2x)^2+sin(2x))");
+    if(inlined == NULL || pasted == NULL) {
+        check(false, "definitions", "the expressions don't compile");
+        return;
+    }
+    check(inlined -> program_len == pasted -> program_len, "evaluate inlined definitions", "calling definitions costs instructions that pasting them doesn't");
+    check(agrees(evaluate(0.7, inlined, 10), evaluate(0.7, pasted, 10), 1e-12), "evaluate inlined definitions", "calling definitions gives a different value");
+
+    p_data *programs[2] = { inlined, pasted };
+    char *names[2] = { "evaluate inlined definitions", "evaluate pasted definitions" };
+    for(int p = 0 ; p < 2 ; p++) {
+        long double sum = 0;
+        long before = allocations;
+        double start = now_seconds();
+        for(long i = 0 ; i < calls ; i++)
+            sum += evaluate(0.5 + (i & 1023) * 1e-3L, programs[p], 10);
+        record(names[p], now_seconds() - start, calls, calls, allocations - before);
+
+        volatile long double sink = sum;
+        (void) sink;
+    }
+    destroy_data(inlined);
+    destroy_data(pasted);
+
+    f_table *table = ftable_new();
+    int dependents = 0;
+    for(int i = 0 ; i < function_count ; i++) {
+        char text[64];
+        snprintf(text, sizeof(text), i % 10 == 0 ? "a*x^2+%i" : "x^2+%i", i);
+        ftable_set(table, NULL, compile_function(text));
+        dependents += i % 10 == 0;
+    }
+
+    bool *affected = calloc(calc_definitions.count, sizeof(bool));
+    definitions_affected(&calc_definitions, definition_find(&calc_definitions, "a"), affected);
+    long before = allocations;
+    double start = now_seconds();
+    f_reload result = ftable_recompile(table, &calc_definitions, affected);
+    record("redefine a variable under the table", now_seconds() - start, 1, 0, allocations - before);
+    check(result.compiled == dependents && result.kept == function_count - dependents, "redefine a variable under the table",
+        "the functions that don't use the variable were compiled again, or the ones that do weren't");
+
+    free(affected);
+    ftable_free(table);
+
+    // a definition that comes before the one it uses (as it can in a definitions file) still depends on it.
+    definition_set(&calc_definitions, "h", NULL, "k*2", &previous, message, sizeof(message));
+    definition_set(&calc_definitions, "k", NULL, "a+1", &previous, message, sizeof(message));
+    affected = calloc(calc_definitions.count, sizeof(bool));
+    definitions_affected(&calc_definitions, definition_find(&calc_definitions, "a"), affected);
+    check(affected[definition_find(&calc_definitions, "h")], "definitions", "a definition doesn't depend on one that was defined after it");
+    free(affected);
+
+    // a name that a longer token starts with isn't substituted into it, but one that runs into x still is.
+    definition_set(&calc_definitions, "xa", NULL, "5", &previous, message, sizeof(message));
+    p_data *prefixed = compile_function("xabs(x)"), *juxtaposed = compile_function("2ax");
+    check(prefixed != NULL && agrees(evaluate(-2, prefixed, 10), -4, 1e-12), "definitions", "a definition was substituted into the start of a longer token");
+    check(juxtaposed != NULL && agrees(evaluate(2, juxtaposed, 10), 12.8, 1e-12), "definitions", "a definition followed by x isn't substituted");
+    if(prefixed != NULL) destroy_data(prefixed);
+    if(juxtaposed != NULL) destroy_data(juxtaposed);
+    definition_remove(&calc_definitions, definition_find(&calc_definitions, "xa"));
+
+    definition_remove(&calc_definitions, definition_find(&calc_definitions, "h"));
+    definition_remove(&calc_definitions, definition_find(&calc_definitions, "k"));
+    definition_remove(&calc_definitions, definition_find(&calc_definitions, "g"));
+    definition_remove(&calc_definitions, definition_find(&calc_definitions, "a"));
+}
+
+// writes the soak test's i-th command. the mix goes through everything in the calculator that allocates: good and
+// bad expressions, the function table, variables and functions, graphs, grids and jobs. names cycle through a few
+// of each, so a calculator that frees what it should holds the same amount of everything from one cycle to the next.
+void soak_command(char *out, int size, long i) {
+    static char *bad[] = { "2+*(", "sin(", "if(1,2)", "min(1,2,3)", "1,2", ")(", "3$x", "q(x)" };
+    long name = i / 10 % 8;
+    int k = (int) (i % 7);
+
+    if(i % 1000 == 999) snprintf(out, size, "/heatmap x*y+%i\n", k);
+    else if(i % 1000 == 499) snprintf(out, size, "/implicit x^2+y^2-%i\n", k + 1);
+    else if(i % 100 == 50) snprintf(out, size, "/graph sin(x)*%i\n", k);
+    else if(i % 5000 == 4000) snprintf(out, size, "/fclear\n");
+    else switch(i % 10) {
+        case 0: snprintf(out, size, "sin(x)*%i+x^2/%i\n", k, k + 1); break;
+        case 1: snprintf(out, size, "/fadd w%li = x^%i+%li\n", name, k, i); break;
+        case 2: snprintf(out, size, "/fremove w%li\n", (name + 3) % 8); break;
+        case 3: snprintf(out, size, "a%li = %li\n", name, i); break;
+        case 4: snprintf(out, size, "h%li(u) = u*a%li+%i\n", name, name, k); break;
+        case 5: snprintf(out, size, "h%li(x)+if(x<%i,a%li,min(x,%i))\n", name, k, name, k); break;
+        case 6: snprintf(out, size, "/undef %c%li\n", i / 10 % 2 ? 'h' : 'a', (name + 5) % 8); break;
+        case 7: snprintf(out, size, "%s\n", bad[i / 10 % 8]); break;
+        case 8: snprintf(out, size, "/xval %i\n", k); break;
+        case 9: snprintf(out, size, "/mem\n"); break;
+    }
+}
+
+// removes the soak test's directory along with whatever the calculator saved in it.
+void remove_directory(char *directory) {
+    DIR *listing = opendir(directory);
+    if(listing == NULL)
+        return;
+
+    char path[PATH_MAX];
+    for(struct dirent *entry ; (entry = readdir(listing)) != NULL ; ) {
+        if(strcmp(entry -> d_name, ".") == 0 || strcmp(entry -> d_name, "..") == 0)
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", directory, entry -> d_name);
+        unlink(path);
+    }
+    closedir(listing);
+    rmdir(directory);
+}
+
+// reads the soak test calculator's output until it ends, counting the /mem reports in it so that the test can
+// tell how far along the calculator is.
+void *read_soak_output(void *argument) {
+    int *reports = (int *) argument;
+    FILE *output = fdopen(reports[1], "r");
+    char line[MAX_LENGTH];
+    while(fgets(line, sizeof(line), output) != NULL)
+        if(strncmp(line, "resident set size:", 18) == 0)
+            __atomic_add_fetch(&reports[0], 1, __ATOMIC_RELEASE);
+    fclose(output);
+    return NULL;
+}
+
+// pipes a long session of mixed commands into one calculator, in a directory of its own so that its save files
+// aren't touched, and samples its resident set size as it goes. once the first fifth of the session has warmed it
+// up it shouldn't grow anymore, since everything a command allocates is freed by the time the command is done.
+void bench_soak(char *calculator) {
+    char directory[] = "/tmp/calc_soak.XXXXXX", path[PATH_MAX], command[MAX_LENGTH];
+    int to_child[2], from_child[2];
+    if(realpath(calculator, path) == NULL || mkdtemp(directory) == NULL || pipe(to_child) != 0 || pipe(from_child) != 0) {
+        printf("ERROR: could not run \"%s\".\n", calculator);
+        return;
+    }
+
+    // the calculator graphs in the window it finds in its directory.
+    snprintf(command, sizeof(command), "%s/window_data.csv", directory);
+    FILE *window = fopen(command, "w");
+    if(window != NULL) {
+        fprintf(window, "-10, 10, -10, 10");
+        fclose(window);
+    }
+
+    pid_t child = fork();
+    if(child == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(to_child[0], 0);
+        dup2(from_child[1], 1);
+        dup2(null, 2);
+        close(to_child[0]);
+        close(to_child[1]);
+        close(from_child[0]);
+        close(from_child[1]);
+        if(chdir(directory) == 0)
+            execl(path, path, (char *) NULL);
+        _exit(127);
+    }
+    close(to_child[0]);
+    close(from_child[1]);
+
+    // the output is read on a thread of its own, so that neither side waits on the other with a full pipe.
+    int reports[2] = { 0, from_child[0] };
+    pthread_t reader;
+    pthread_create(&reader, NULL, &read_soak_output, reports);
+
+    // a calculator that died shouldn't take the benchmarks down with it, that's reported below.
+    signal(SIGPIPE, SIG_IGN);
+    FILE *commands = fdopen(to_child[1], "w");
+    long sent = 0, requested = 0, samples = 50, warmup = samples / 5;
+    double start = now_seconds();
+    for(long sample = 0 ; sample < samples && child > 0 ; sample++) {
+        long last = soak_commands * (sample + 1) / samples;
+        for( ; sent < last ; sent++) {
+            soak_command(command, sizeof(command), sent);
+            requested += strcmp(command, "/mem\n") == 0;
+            if(fputs(command, commands) == EOF)
+                break;
+        }
+
+        // the calculator is sampled once it has caught up with every command so far.
+        requested++;
+        if(fputs("/mem\n", commands) == EOF || fflush(commands) == EOF)
+            break;
+        while(__atomic_load_n(&reports[0], __ATOMIC_ACQUIRE) < requested && waitpid(child, NULL, WNOHANG) == 0)
+            usleep(100);
+
+        long resident = resident_bytes(child);
+        if(sample == warmup - 1)
+            soak_warm = resident;
+        else if(sample >= warmup && resident > soak_largest)
+            soak_largest = resident;
+    }
+    fputs("/quit\n", commands);
+    fclose(commands);
+
+    int status = 0;
+    if(child > 0)
+        waitpid(child, &status, 0);
+    pthread_join(reader, NULL);
+    record("soak, mixed commands", now_seconds() - start, sent, 0, 0);
+    remove_directory(directory);
+
+    check(child > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 && sent == soak_commands, "soak, mixed commands", "the calculator didn't make it through the session");
+    check(soak_warm > 0 && soak_largest - soak_warm <= BENCH_SOAK_GROWTH, "soak, mixed commands", "the calculator's resident set size kept growing");
+}
+
+// writes the results as json, one benchmark per line so that read_baseline() can read them back.
+int write_results(char *file_name) {
+    FILE *file = fopen(file_name, "w");
+    if(file == NULL)
+        return 1;
+
+    fprintf(file, "{\n  \"calls\": %li,\n  \"benchmarks\": [\n", calls);
+    for(int i = 0 ; i < result_count ; i++)
+        fprintf(file, "    { \"name\": \"%s\", \"ns_per_op\": %.3f, \"evaluations_per_second\": %.0f, \"allocations_per_op\": %.3f }%s\n",
+            results[i].name, results[i].ns, results[i].evaluations_per_second, results[i].allocations, i + 1 < result_count ? "," : "");
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) != 0;
+}
+
+// compares the results with a baseline written by write_results(), returns the amount of regressions.
+int compare_baseline(char *file_name) {
+    FILE *file = fopen(file_name, "r");
+    if(file == NULL) {
+        printf("\nno baseline in %s, \"make baseline\" saves one.\n", file_name);
+        return 0;
+    }
+
+    bench_result *baseline = malloc(MAX_RESULTS * sizeof(bench_result));
+    int baseline_count = 0;
+    char line[256];
+    while(baseline_count < MAX_RESULTS && fgets(line, sizeof(line), file) != NULL) {
+        bench_result *old = &baseline[baseline_count];
+        if(sscanf(line, " { \"name\": \"%63[^\"]\", \"ns_per_op\": %lf, \"evaluations_per_second\": %lf, \"allocations_per_op\": %lf",
+            old -> name, &old -> ns, &old -> evaluations_per_second, &old -> allocations) == 4)
+            baseline_count++;
+    }
+    fclose(file);
+
+    // the baseline's times are scaled by how much faster or slower the calibration loop got.
+    double speed = 1;
+    bench_result *calibration = find_result("calibration");
+    for(int i = 0 ; i < baseline_count ; i++)
+        if(calibration != NULL && strcmp(baseline[i].name, "calibration") == 0 && baseline[i].ns > 0)
+            speed = calibration -> ns / baseline[i].ns;
+
+    printf("\ncompared with %s, scaled by %.2f for the machine's speed (a regression is more than %.0f%% slower, or more allocations):\n",
+        file_name, speed, BENCH_TOLERANCE * 100);
+    int regressions = 0;
+    for(int i = 0 ; i < baseline_count ; i++) {
+        bench_result *old = &baseline[i], *new = find_result(old -> name);
+        if(new == NULL || strcmp(old -> name, "calibration") == 0)
+            continue;
+
+        double expected = old -> ns * speed;
+        bool slower = new -> ns > expected * (1 + BENCH_TOLERANCE), allocating = new -> allocations > old -> allocations + 0.005;
+        printf("%-32s %14.1f -> %14.1f ns/op %+8.1f%% %s\n", old -> name, expected, new -> ns, (new -> ns / expected - 1) * 100,
+            slower ? "REGRESSION" : allocating ? "REGRESSION (allocations)" : "");
+        regressions += slower || allocating;
+    }
+    free(baseline);
+    printf("%i regression%s.\n", regressions, regressions == 1 ? "" : "s");
+    return regressions;
+}
+
+int main(int argc, char **argv) {
+    char *calculator = "./calculator", *json = NULL, *baseline = NULL;
+    bool soak_only = false;
+    for(int i = 1 ; i < argc ; i++) {
+        if(strcmp(argv[i], "--quick") == 0) {
+            calls /= 100;
+            processes = 10;
+            function_count /= 10;
+            repeats = 1;
+            grid_size /= 8;
+            soak_commands /= 100;
+        }
+        else if(strcmp(argv[i], "--soak") == 0) soak_only = true;
+        else if(strcmp(argv[i], "--json") == 0 && i + 1 < argc) json = argv[++i];
+        else if(strcmp(argv[i], "--compare") == 0 && i + 1 < argc) baseline = argv[++i];
+        else if(argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [--quick] [--soak] [--json results.json] [--compare baseline.json] [calculator]\n", argv[0]);
+            return 1;
+        }
+        else calculator = argv[i];
+    }
+
+    char library[64], table[64], grid[64];
+    snprintf(library, sizeof(library), "library (%s)", BENCH_EXPRESSION);
+    snprintf(table, sizeof(table), "function table with %i functions", function_count);
+    snprintf(grid, sizeof(grid), "%ix%i grid (%s)", grid_size, grid_size, BENCH_GRID_EXPRESSION);
+    // the soak test runs once, it measures whether memory stays flat rather than how fast anything is.
+    char soak[64];
+    snprintf(soak, sizeof(soak), "soak (%li commands)", soak_commands);
+    for(int r = 0 ; r < repeats && !soak_only ; r++) {
+        section = "calibration";
+        bench_calibration();
+        section = library;
+        bench_library(calculator);
+        section = "compiling";
+        bench_compile();
+        section = "evaluating";
+        bench_evaluate();
+        section = "conditionals";
+        bench_conditionals();
+        section = "rendering";
+        bench_render();
+        section = grid;
+        bench_grid();
+        section = "integrating and differentiating";
+        bench_analysis();
+        section = "tabulating";
+        bench_table();
+        section = "instrumentation";
+        bench_instrumentation();
+        section = "profiling";
+        bench_profile();
+        section = table;
+        bench_function_table();
+        section = "definitions";
+        bench_definitions();
+    }
+    section = soak;
+    bench_soak(calculator);
+    print_results();
+
+    if(soak_warm > 0 && soak_largest > 0)
+        printf("\nthe soak test's resident set size was %.2f MB once it warmed up and at most %.2f MB after that.\n", soak_warm / 1e6, soak_largest / 1e6);
+
+    bench_result *evaluation = find_result("calc_eval"), *compiling = find_result("calc_compile + eval + free"), *process = find_result("fork/exec --batch");
+    if(evaluation != NULL && compiling != NULL && process != NULL)
+        printf("\nin process evaluation is %.0fx faster than a process per evaluation (%.0fx with compiling).\n",
+            process -> ns / evaluation -> ns, process -> ns / compiling -> ns);
+
+    if(json != NULL && write_results(json) != 0) {
+        fprintf(stderr, "ERROR: could not write %s.\n", json);
+        failures++;
+    }
+
+    int regressions = baseline != NULL ? compare_baseline(baseline) : 0;
+    if(failures > 0)
+        printf("\n%i benchmark%s computed the wrong result.\n", failures, failures == 1 ? "" : "s");
+    return failures > 0 || regressions > 0;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "calc.h"
+#include "instrument.h"
+#include "define.h"
+#include "parser.h"
+#include "analysis.h"
+
+struct calc_context {
+    long double base;
+    char message[MAX_LENGTH];
+};
+
+struct calc_expr {
+    p_data *data;
+};
+
+// records the outcome of a call in its context and returns the status.
+static calc_status finish(calc_context *context, calc_status status, const char *message) {
+    if(context != NULL)
+        snprintf(context -> message, MAX_LENGTH, "%s", status == CALC_OK ? "" : message);
+    return status;
+}
+
+calc_context *calc_context_new(void) {
+    calc_context *context = calloc(1, sizeof(calc_context));
+    if(context != NULL)
+        context -> base = 10;
+    return context;
+}
+
+void calc_context_free(calc_context *context) {
+    free(context);
+}
+
+void calc_set_base(calc_context *context, long double base) {
+    if(context != NULL)
+        context -> base = base;
+}
+
+long double calc_get_base(const calc_context *context) {
+    return context != NULL ? context -> base : 10;
+}
+
+const char *calc_error(const calc_context *context) {
+    return context != NULL ? context -> message : "missing context";
+}
+
+const char *calc_status_name(calc_status status) {
+    switch(status) {
+        case CALC_OK:               return "ok";
+        case CALC_ERROR_SYNTAX:     return "syntax error";
+        case CALC_ERROR_EVALUATION: return "evaluation error";
+        case CALC_ERROR_ARGUMENT:   return "invalid argument";
+        case CALC_ERROR_MEMORY:     return "out of memory";
+    }
+    return "unknown status";
+}
+
+calc_status calc_compile(calc_context *context, const char *text, calc_expr **expression) {
+    if(context == NULL || text == NULL || expression == NULL)
+        return finish(context, CALC_ERROR_ARGUMENT, "missing argument");
+    *expression = NULL;
+    if(strlen(text) >= MAX_LENGTH)
+        return finish(context, CALC_ERROR_ARGUMENT, "expression too long");
+
+    calc_expr *compiled = calloc(1, sizeof(calc_expr));
+    p_data *volatile data = calloc(1, sizeof(p_data));
+    if(compiled == NULL || data == NULL) {
+        free(compiled);
+        free(data);
+        return finish(context, CALC_ERROR_MEMORY, "out of memory");
+    }
+
+    // the parser reports errors through throw_error(), which jumps back here instead of ending the process.
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        destroy_data(data);
+        free(compiled);
+        return finish(context, CALC_ERROR_SYNTAX, error_message);
+    }
+
+    data -> input = eat_whitespace((char *) text, strlen(text));
+    if(strlen(data -> input) == 0)
+        throw_error("missing expression");
+    compile(data);
+
+    error_handler = previous;
+    compiled -> data = data;
+    *expression = compiled;
+    return finish(context, CALC_OK, NULL);
+}
+
+calc_status calc_eval(calc_context *context, const calc_expr *expression, long double x, long double *value) {
+    if(context == NULL || expression == NULL || value == NULL)
+        return finish(context, CALC_ERROR_ARGUMENT, "missing argument");
+
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        return finish(context, CALC_ERROR_EVALUATION, error_message);
+    }
+
+    *value = evaluate(x, expression -> data, context -> base);
+
+    error_handler = previous;
+    return finish(context, CALC_OK, NULL);
+}
+
+calc_status calc_eval_batch(calc_context *context, const calc_expr *expression, const long double *xvalues, long double *values, size_t count) {
+    if(context == NULL || expression == NULL || (count > 0 && (xvalues == NULL || values == NULL)))
+        return finish(context, CALC_ERROR_ARGUMENT, "missing argument");
+
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        return finish(context, CALC_ERROR_EVALUATION, error_message);
+    }
+
+    // the batch evaluator takes an int count, so very large batches are handed over in pieces.
+    for(size_t done = 0 ; done < count ; done += BATCH_SIZE * 4096) {
+        size_t length = count - done < BATCH_SIZE * 4096 ? count - done : BATCH_SIZE * 4096;
+        evaluate_batch(expression -> data, xvalues + done, values + done, (int) length, context -> base);
+    }
+
+    error_handler = previous;
+    return finish(context, CALC_OK, NULL);
+}
+
+calc_status calc_integrate(calc_context *context, const calc_expr *expression, long double a, long double b, long double *value) {
+    if(context == NULL || expression == NULL || value == NULL)
+        return finish(context, CALC_ERROR_ARGUMENT, "missing argument");
+    if(!isfinite(a) || !isfinite(b))
+        return finish(context, CALC_ERROR_ARGUMENT, "bounds must be finite");
+
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        return finish(context, CALC_ERROR_EVALUATION, error_message);
+    }
+
+    *value = integrate(a, b, expression -> data, context -> base);
+
+    error_handler = previous;
+    return finish(context, CALC_OK, NULL);
+}
+
+int calc_is_polynomial(const calc_expr *expression) {
+    return expression != NULL && expression -> data -> polynomial;
+}
+
+void calc_free(calc_expr *expression) {
+    if(expression == NULL)
+        return;
+
+    destroy_data(expression -> data);
+    free(expression);
+}
@@ -0,0 +1,68 @@
+#ifndef CALC_H
+#define CALC_H
+
+#include <stddef.h>
+
+// the calculator's expression engine as a library. expressions are compiled once into a handle and can then be
+// evaluated any number of times. nothing in the library prints or ends the process: every call returns a status,
+// and the context it was given holds a message describing the last error.
+//
+// a context belongs to one thread at a time, but a compiled expression is never changed by evaluating it, so it
+// can be shared between threads that each have their own context.
+//
+// two things aren't part of any context and are shared by every context in the process: the table of variables and
+// functions that expressions can use by name ("a = 3.2", see define.h), which calc_compile() inlines, and the
+// instrumentation counters and timers (see instrument.h). the library never changes the definitions itself, but an
+// expression compiles differently once something else in the process has defined a name it uses.
+
+// the status of a library call.
+typedef enum {
+    CALC_OK = 0,
+    CALC_ERROR_SYNTAX,      // the expression could not be compiled.
+    CALC_ERROR_EVALUATION,  // the expression could not be evaluated.
+    CALC_ERROR_ARGUMENT,    // a missing handle or an invalid argument.
+    CALC_ERROR_MEMORY       // an allocation failed.
+} calc_status;
+
+// the settings that evaluation depends on, and the last error.
+typedef struct calc_context calc_context;
+
+// a compiled expression.
+typedef struct calc_expr calc_expr;
+
+// creates a context with the default settings (log() base 10), or returns NULL if it can't be allocated.
+calc_context *calc_context_new(void);
+
+// frees a context. expressions compiled with it stay valid.
+void calc_context_free(calc_context *context);
+
+// the base that log() uses in evaluations with this context.
+void calc_set_base(calc_context *context, long double base);
+long double calc_get_base(const calc_context *context);
+
+// a description of the last error in this context, or "" if the last call succeeded.
+const char *calc_error(const calc_context *context);
+
+// a short description of a status.
+const char *calc_status_name(calc_status status);
+
+// compiles an expression in x (eg. "sin(x)^2+3x") into a handle that is freed with calc_free(). malformed expressions
+// (eg. "x+") are CALC_ERROR_SYNTAX.
+calc_status calc_compile(calc_context *context, const char *text, calc_expr **expression);
+
+// evaluates an expression at x.
+calc_status calc_eval(calc_context *context, const calc_expr *expression, long double x, long double *value);
+
+// evaluates an expression at count x values, which is much faster than evaluating them one at a time.
+calc_status calc_eval_batch(calc_context *context, const calc_expr *expression, const long double *xvalues, long double *values, size_t count);
+
+// the definite integral of an expression from a to b.
+calc_status calc_integrate(calc_context *context, const calc_expr *expression, long double a, long double b, long double *value);
+
+// whether an expression was recognized as a polynomial, which is evaluated and integrated exactly.
+int calc_is_polynomial(const calc_expr *expression);
+
+// frees a compiled expression, NULL is ignored.
+void calc_free(calc_expr *expression);
+
+#endif
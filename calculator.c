@@ -2,22 +2,35 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <poll.h>
+#include <unistd.h>
+#include "calc.h"
+#include "instrument.h"
+#include "define.h"
 #include "parser.h"
 #include "graph.h"
+#include "analysis.h"
+#include "grid.h"
+#include "curve.h"
+#include "views.h"
+#include "ftable.h"
+#include "profile.h"
+#include "snapshot.h"
+#include "watch.h"
+#include "batch.h"
+#include "table.h"
+#include "mapped.h"
+#include "server.h"
+#include "jobs.h"
 
 // max input length throughout the calculator's runtime.
 #ifndef MAX_INPUT_LENGTH
 #define MAX_INPUT_LENGTH 256
 #endif
 
-// the maximum amount of functions that can be stored at once.
-#ifndef MAX_FUNCTIONS
-#define MAX_FUNCTIONS 10
-#endif
-
-// delta x definition for integration and differentiation.
-#ifndef DELTA
-#define DELTA (long double) .000001
+// the maximum amount of whitespace separated arguments a command can take.
+#ifndef MAX_ARGUMENTS
+#define MAX_ARGUMENTS 8
 #endif
 
 // state machine for the main calculator loop.
@@ -27,38 +40,126 @@ typedef enum {
     STATE_help,
     STATE_base,
     STATE_derive,
+    STATE_heatmap,
+    STATE_implicit,
+    STATE_param,
+    STATE_polar,
     STATE_x,
     STATE_integrate,
+    STATE_analyze,
+    STATE_profile,
     STATE_window,
     STATE_clear,
     STATE_ftable,
     STATE_add,
     STATE_remove,
+    STATE_roots,
+    STATE_intersect,
+    STATE_range,
+    STATE_table,
+    STATE_stats,
+    STATE_memory,
+    STATE_progressive,
+    STATE_jobs,
+    STATE_cancel,
+    STATE_definitions,
+    STATE_undefine,
     STATE_quit,
     STATE_error
 } state;
 
 state calculator_state;
 
-// reads the functions save file and loads it into the given array.
-int load_functions(p_data **functions) {
-    FILE *functions_file = fopen("functions.txt", "r");
-    int i = 0, j = 0;
-    char c;
-    while((c = fgetc(functions_file)) != EOF) {
-        if(c == '\n') {
-            functions[i] -> input = eat_whitespace(functions[i] -> input, j);
-            compile(functions[i]);
-            i++;
-            j = 0;
-        } else {
-            functions[i] -> input[j] = c;
-            j++;
+// whitespace separated arguments of the current command, for commands that take more than one argument.
+char *arguments[MAX_ARGUMENTS];
+int argument_count;
+
+// reads the functions save file into the function table.
+int load_functions(f_table *functions) {
+    FILE *functions_file = fopen(FUNCTIONS_FILE, "r");
+    if(functions_file == NULL)
+        return 0;
+
+    int count = ftable_read(functions, functions_file);
+    fclose(functions_file);
+    return count;
+}
+
+// reads the definitions save file, returns the amount of definitions that were read.
+int load_definitions() {
+    FILE *definitions_file = fopen(DEFINITIONS_FILE, "r");
+    if(definitions_file == NULL)
+        return 0;
+
+    char line[MAX_LENGTH], message[MAX_LENGTH], *name, *parameter, *body;
+    int count = 0, line_number = 0;
+    while(fgets(line, sizeof(line), definitions_file) != NULL) {
+        line_number++;
+        if(strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        d_previous previous;
+        if(!split_function_definition(line, &name, &parameter, &body) || !valid_definition_name(name)) {
+            fprintf(stderr, "ERROR: line %i of the definitions file isn't a definition.\n", line_number);
+            continue;
+        }
+
+        char *compact = eat_whitespace(body, strlen(body));
+        if(definition_set(&calc_definitions, name, parameter, compact, &previous, message, sizeof(message)) < 0)
+            fprintf(stderr, "ERROR: line %i of the definitions file: %s\n", line_number, message);
+        else {
+            definition_forget(&previous);
+            count++;
+        }
+        free(compact);
+    }
+    fclose(definitions_file);
+
+    // definitions can use ones that come later in the file, so they're only checked once they're all read, by
+    // compiling a use of each. the ones that don't compile are reported and removed, users before what they use.
+    for(bool removed = true ; removed ; ) {
+        removed = false;
+        for(int i = 0 ; i < calc_definitions.count ; i++) {
+            d_definition *definition = &calc_definitions.entries[i];
+            if(definition -> body == NULL)
+                continue;
+
+            char use[MAX_NAME + 8], name[MAX_NAME + 1];
+            snprintf(use, sizeof(use), definition -> parameter[0] != '\0' ? "%s(x)" : "%s", definition -> name);
+            snprintf(name, sizeof(name), "%s", definition -> name);
+            p_data *compiled = compile_function(use);
+            if(compiled == NULL && definition_remove(&calc_definitions, i)) {
+                fprintf(stderr, "ERROR: the definition of %s: %s\n", name, error_message);
+                removed = true;
+                count--;
+            }
+            destroy_data(compiled);
         }
     }
+    return count;
+}
 
-    fclose(functions_file);
-    return i;
+// saves the definitions to the definitions file, replacing it all at once. the file is only made once there is
+// something to save.
+int save_definitions() {
+    if(calc_definitions.live == 0 && access(DEFINITIONS_FILE, F_OK) != 0)
+        return 0;
+
+    char temporary[MAX_INPUT_LENGTH];
+    FILE *definitions_file = begin_save(DEFINITIONS_FILE, temporary, sizeof(temporary));
+    if(definitions_file == NULL)
+        return 1;
+
+    for(int i = 0 ; i < calc_definitions.count ; i++)
+        if(calc_definitions.entries[i].body != NULL)
+            write_definition(&calc_definitions.entries[i], definitions_file);
+    return finish_save(definitions_file, temporary, DEFINITIONS_FILE);
+}
+
+// the hash of everything the snapshot is made from. the definitions are part of it, since they are inlined into
+// the compiled functions.
+uint64_t source_hash() {
+    return hash_file(hash_sources(FUNCTIONS_FILE, WINDOW_FILE), DEFINITIONS_FILE);
 }
 
 // prints the help text from the help file.
@@ -76,90 +177,153 @@ void print_help() {
 
 // reads the window data from the save file and returns it as an array of values.
 long double *load_window_data() {
-    FILE *window_file;
-    char *window_data = malloc(1 * MAX_INPUT_LENGTH * 4);
-    char *string_data;
-    long double *output = malloc(sizeof(long double));
-
-     window_file = fopen("window_data.csv", "r");
-
-    fgets(window_data, (MAX_INPUT_LENGTH*4) + 3, window_file);
+    long double *output = calloc(4, sizeof(long double));
 
-
-    int i = 0;
     // window data is contained in the form of a csv, with the values in order of (xmin, xmax, ymin, ymax)
-    string_data = strtok(window_data, ",");
-    while(string_data != NULL) {
-        output[i] = atof(string_data);
-        string_data = strtok(NULL, ",");
-        i++;
-    }
-
-    free(window_data);
-    fclose(window_file);
+    read_window(WINDOW_FILE, output);
     return output;
 }
 
-// saves the current state of the function table to the functions file.
-int save_functions(p_data **functions) {
-    FILE *functions_file = fopen("functions.txt", "w");
-    char *current_function;
-    for(int i = 0 ; i < MAX_FUNCTIONS ; i++) {
-        current_function = functions[i] -> input;
+// saves the current state of the function table to the functions file, replacing it all at once.
+int save_functions(f_table *functions) {
+    char temporary[MAX_INPUT_LENGTH];
+    FILE *functions_file = begin_save(FUNCTIONS_FILE, temporary, sizeof(temporary));
+    if(functions_file == NULL)
+        return 1;
 
-        if(strlen(current_function) > 0)
-            fprintf(functions_file, "%s\n", current_function);
-    }
-    char c = fgetc(functions_file);
-    if(c == EOF)
-        fprintf(functions_file, "\n");
-    fclose(functions_file);
+    ftable_write(functions, functions_file);
+    if(finish_save(functions_file, temporary, FUNCTIONS_FILE) != 0)
+        return 1;
+
+    for(int i = ftable_next(functions, -1) ; i >= 0 ; i = ftable_next(functions, i))
+        functions -> entries[i].unsaved = false;
     return 0;
 }
 
-// saves the current state of the window borders to the window data file
+// saves the current state of the window borders to the window data file, replacing it all at once.
 int save_window_data(long double xmin, long double xmax, long double ymin, long double ymax) {
-    FILE *window_file = fopen("window_data.csv", "w");
+    char temporary[MAX_INPUT_LENGTH];
+    FILE *window_file = begin_save(WINDOW_FILE, temporary, sizeof(temporary));
+    if(window_file == NULL)
+        return 1;
+
     fprintf(window_file, "%Lf, %Lf, %Lf, %Lf", xmin, xmax, ymin, ymax);
-    fclose(window_file);
-    return 0;
+    return finish_save(window_file, temporary, WINDOW_FILE);
 }
 
-// returns the derivative based on the delta x limit definition of a derivative.
-long double derive(long double x_value, p_data *data, long double b) {
-    return (evaluate(x_value + DELTA, data, base) - evaluate(x_value, data, b)) / DELTA;
+// prints a single function of the function table, marking it if it is evaluated as a polynomial.
+void print_function(f_table *functions, int slot) {
+    f_entry *entry = &functions -> entries[slot];
+    printf("y[%i] %s  %s = %s", slot+1, slot+1 < 10? " " : "", entry -> name, entry -> data -> input);
+    if(entry -> data -> polynomial)
+        printf("\t\t[polynomial, degree %i]", entry -> data -> degree);
+    printf("\n");
 }
 
-// returns the definite integral based on given bounds and the delta x summation definition of an integral.
-long double integrate(long double left_bound, long double right_bound, p_data *function) {
-    long double x_value = left_bound;
-    long double def_int = 0;
-
-    /*
-     * ACCURACY LIMITATION
-     * -------------------
-     *  the accuracy of this calculation is limited by the accuracy of floating point numbers in c.
-     *  I have attempted to mitigate this error by modulating the size of the steps taken by the
-     *  integration function based on the width of the bounds, but really this is only to maximize
-     *  speed rather than accuracy
-     */
-    long double steps = (right_bound - left_bound) * .00001;
-    while(x_value < right_bound) {
-        def_int += evaluate(x_value, function, base) * steps;
-        x_value += steps;
-    }
+// prints a formatted function table.
+void print_functions(f_table *functions) {
+    for(int i = ftable_next(functions, -1) ; i >= 0 ; i = ftable_next(functions, i))
+        print_function(functions, i);
+    if(functions -> live == 0)
+        printf("(empty)\n");
 
-    return def_int;
+    printf("\n");
 }
 
-// prints a formatted function table.
-void print_functions(p_data **functions) {
-    for(int i = 0 ; i < 10 ; i++)
-        printf("y[%i] %s=  %s\n", i+1, i+1 < 10? " " : "", functions[i] -> input? functions[i] -> input : "");
+// prints a definition, along with its value if it's a constant.
+void print_definition(d_definition *definition, p_data *compiled) {
+    if(definition -> parameter[0] != '\0')
+        printf("%s(%s) = %s", definition -> name, definition -> parameter, definition -> body);
+    else printf("%s = %s", definition -> name, definition -> body);
 
+    if(compiled != NULL && compiled -> program_len == 1 && compiled -> program[0].op == 'n')
+        printf("\t\t[constant, %Lf]", compiled -> program[0].value);
     printf("\n");
 }
 
+// prints every definition.
+void print_definitions() {
+    for(int i = 0 ; i < calc_definitions.count ; i++) {
+        d_definition *definition = &calc_definitions.entries[i];
+        if(definition -> body == NULL)
+            continue;
+
+        // variables are compiled to show whether they are constants.
+        p_data *compiled = definition -> parameter[0] == '\0' ? compile_function(definition -> name) : NULL;
+        print_definition(definition, compiled);
+        destroy_data(compiled);
+    }
+    if(calc_definitions.live == 0)
+        printf("(none)\n");
+}
+
+// defines a variable ("name = expression") or a function ("name(parameter) = expression"), and compiles the
+// functions in the function table that depend on it again, through the definitions that use it. returns false if
+// the input isn't a definition.
+bool define(f_table *functions, char *input, bool busy) {
+    char text[MAX_INPUT_LENGTH], message[MAX_LENGTH], *name, *parameter, *body;
+    snprintf(text, sizeof(text), "%s", input);
+    if(!split_function_definition(text, &name, &parameter, &body))
+        return false;
+
+    if(busy) {
+        printf("ERROR: definitions can't change while a job is running, wait for it to finish or \"/cancel\" it first.\n");
+        return true;
+    } else if(!valid_definition_name(name)) {
+        printf("ERROR: names start with a letter and only have letters, digits and '_', and can't be x, y, e, p or start with a built in function.\n");
+        return true;
+    } else if(parameter != NULL && !valid_definition_name(parameter) && strcmp(parameter, "x") != 0) {
+        printf("ERROR: \"%s\" can't be a parameter.\n", parameter);
+        return true;
+    } else if(strspn(body, " \t") == strlen(body)) {
+        printf("ERROR: missing expression\n");
+        return true;
+    }
+
+    d_previous previous;
+    char *compact = eat_whitespace(body, strlen(body));
+    int slot = definition_set(&calc_definitions, name, parameter, compact, &previous, message, sizeof(message));
+    free(compact);
+    if(slot < 0) {
+        printf("ERROR: %s\n", message);
+        return true;
+    }
+
+    // the definition is checked by compiling a use of it, and is undone if that fails.
+    char use[MAX_NAME + 8];
+    snprintf(use, sizeof(use), parameter != NULL ? "%s(x)" : "%s", name);
+    p_data *compiled = compile_function(use);
+    if(compiled == NULL) {
+        printf("ERROR: %s\n", error_message);
+        definition_restore(&calc_definitions, &previous);
+        return true;
+    }
+    definition_forget(&previous);
+    print_definition(&calc_definitions.entries[slot], compiled);
+    destroy_data(compiled);
+
+    bool *affected = calloc(calc_definitions.count, sizeof(bool));
+    definitions_affected(&calc_definitions, slot, affected);
+    f_reload result = ftable_recompile(functions, &calc_definitions, affected);
+    free(affected);
+
+    if(result.compiled > 0 || result.failed > 0)
+        printf("%i functions recompiled, %i kept", result.compiled, result.kept);
+    if(result.failed > 0)
+        printf(", %i failed and kept their previous version", result.failed);
+    if(result.compiled > 0 || result.failed > 0)
+        printf("\n");
+    return true;
+}
+
+// gathers the functions named by the command's arguments (or every function, without arguments) for drawing. the
+// count is -1 if one of the arguments isn't a function in the function table.
+p_data **select_functions(f_table *functions, int key_count, char **keys, int *count) {
+    p_data **selected = malloc((functions -> size + key_count + 1) * sizeof(p_data *));
+    *count = ftable_select(functions, keys, key_count, selected, NULL);
+    return selected;
+}
+
 // returns the index of the first space in a string.
 int spaceix(char *input) {
     int i = 0;
@@ -168,32 +332,93 @@ int spaceix(char *input) {
     return i;
 }
 
-// breaks command up into detected command line argument and command.
+// breaks command up into detected command line argument and command, both without whitespace. the argument is NULL
+// when there isn't one. they're freed with free_command().
 char **parse_command(char *input) {
     char **output = calloc(2, sizeof(char *));
-    output[0] = input;
-    output[1] = calloc(MAX_INPUT_LENGTH, 1);
 
     if(spaceix(input) == strlen(input)) {
         output[0] = eat_whitespace(input, strlen(input));
-        output[1] = NULL;
         return output;
     }
 
     input[spaceix(input)] = '\0';
+    output[0] = eat_whitespace(input, strlen(input));
     output[1] = eat_whitespace(&input[spaceix(input)+1], strlen(&input[spaceix(input)+1]));
     return output;
 }
 
+// frees a command broken up by parse_command().
+void free_command(char **command) {
+    free(command[0]);
+    free(command[1]);
+    free(command);
+}
+
+// splits the arguments of a command on whitespace into the arguments array.
+int split_arguments(char *input) {
+    static char buffer[MAX_INPUT_LENGTH];
+    strncpy(buffer, input, MAX_INPUT_LENGTH - 1);
+
+    // the first token is the command itself.
+    argument_count = 0;
+    char *token = strtok(buffer, " \t\n");
+    while(token != NULL && (token = strtok(NULL, " \t\n")) != NULL && argument_count < MAX_ARGUMENTS)
+        arguments[argument_count++] = token;
+
+    return argument_count;
+}
+
+// prints the roots found by a root search along with how much work it took to find them.
+void print_roots(char *label, a_roots *result, long double left_bound, long double right_bound, FILE *output) {
+    fprintf(output, "%s on [%Lf, %Lf]: %i found\n", label, left_bound, right_bound, result -> root_cnt);
+    for(int i = 0 ; i < result -> root_cnt ; i++)
+        fprintf(output, "\tx = %.12Lf\n", result -> roots[i]);
+
+    fprintf(output, "evaluations: %li scanning, %li refining (scan: %.2f million evaluations/s)\n\n", result -> scan_evaluations, result -> refine_evaluations,
+        result -> scan_seconds > 0 ? result -> scan_evaluations / result -> scan_seconds / 1e6 : 0);
+}
+
+// prints the summary statistics of a function over an interval.
+void print_range_stats(char *label, a_stats *stats, long double left_bound, long double right_bound, FILE *output) {
+    fprintf(output, "%s on [%Lf, %Lf]:\n", label, left_bound, right_bound);
+    if(stats -> nonfinite == stats -> samples)
+        fprintf(output, "\tno finite values, all %li samples were undefined.\n", stats -> samples);
+    else {
+        fprintf(output, "\tmin  = %Lf at x = %Lf\n", stats -> min, stats -> argmin);
+        fprintf(output, "\tmax  = %Lf at x = %Lf\n", stats -> max, stats -> argmax);
+        fprintf(output, "\tmean = %Lf\n", stats -> mean);
+        fprintf(output, "\trms  = %Lf\n", stats -> rms);
+    }
+    if(stats -> nonfinite > 0 && stats -> nonfinite < stats -> samples)
+        fprintf(output, "\t%li of the samples were undefined and were skipped.\n", stats -> nonfinite);
+
+    fprintf(output, "%li evaluations on %i threads in %.3fs (%.2f million evaluations/s)\n", stats -> samples, stats -> threads, stats -> seconds,
+        stats -> seconds > 0 ? stats -> samples / stats -> seconds / 1e6 : 0);
+}
+
+// prints how long a grid of a function of x and y took to evaluate.
+void print_grid_rate(long width, long height, double seconds, FILE *output) {
+    fprintf(output, "%li x %li evaluations in %.3fs (%.2f million evaluations/s)\n", width, height, seconds,
+        seconds > 0 ? width * height / seconds / 1e6 : 0);
+}
+
 // identifies the input and changes the state of the calculator.
 char *current_action_id(char *input) {
     if(input[0] == '/') {
+        split_arguments(input);
         char **commands = parse_command(input);
         if(strcmp(commands[0], "/graph"           ) == 0) calculator_state = STATE_graph;
         else if(strcmp(commands[0], "/help"       ) == 0) calculator_state = STATE_help;
         else if(strcmp(commands[0], "/base"       ) == 0) calculator_state = STATE_base;
         else if(strcmp(commands[0], "/integrate"  ) == 0) calculator_state = STATE_integrate;
+        else if(strcmp(commands[0], "/analyze"    ) == 0) calculator_state = STATE_analyze;
+        else if(strcmp(commands[0], "/profile"    ) == 0) calculator_state = STATE_profile;
         else if(strcmp(commands[0], "/graphdx"    ) == 0) calculator_state = STATE_derive;
+        else if(strcmp(commands[0], "/heatmap"    ) == 0) calculator_state = STATE_heatmap;
+        else if(strcmp(commands[0], "/implicit"   ) == 0) calculator_state = STATE_implicit;
+        else if(strcmp(commands[0], "/param"      ) == 0) calculator_state = STATE_param;
+        else if(strcmp(commands[0], "/polar"      ) == 0) calculator_state = STATE_polar;
         else if(strcmp(commands[0], "/ftable"     ) == 0) calculator_state = STATE_ftable;
         else if(strcmp(commands[0], "/xval"       ) == 0) calculator_state = STATE_x;
         else if(strcmp(commands[0], "/fadd"       ) == 0) calculator_state = STATE_add;
@@ -201,67 +426,544 @@ char *current_action_id(char *input) {
         else if(strcmp(commands[0], "/window"     ) == 0) calculator_state = STATE_window;
         else if(strcmp(commands[0], "/quit"       ) == 0) calculator_state = STATE_quit;
         else if(strcmp(commands[0], "/fclear"     ) == 0) calculator_state = STATE_clear;
+        else if(strcmp(commands[0], "/roots"      ) == 0) calculator_state = STATE_roots;
+        else if(strcmp(commands[0], "/intersect"  ) == 0) calculator_state = STATE_intersect;
+        else if(strcmp(commands[0], "/stats-range") == 0) calculator_state = STATE_range;
+        else if(strcmp(commands[0], "/table"      ) == 0) calculator_state = STATE_table;
+        else if(strcmp(commands[0], "/stats"      ) == 0) calculator_state = STATE_stats;
+        else if(strcmp(commands[0], "/mem"        ) == 0) calculator_state = STATE_memory;
+        else if(strcmp(commands[0], "/progressive") == 0) calculator_state = STATE_progressive;
+        else if(strcmp(commands[0], "/jobs"       ) == 0) calculator_state = STATE_jobs;
+        else if(strcmp(commands[0], "/cancel"     ) == 0) calculator_state = STATE_cancel;
+        else if(strcmp(commands[0], "/defs"       ) == 0) calculator_state = STATE_definitions;
+        else if(strcmp(commands[0], "/undef"      ) == 0) calculator_state = STATE_undefine;
         else calculator_state = STATE_error;
 
-        if(commands[1] != NULL) {
-            char *arg = calloc(strlen(commands[1]), 1);
-            for(int i = 0 ; i < strlen(commands[1]) ; i++)
-                arg[i] = commands[1][i];
-            return arg;
-        } else return NULL;
+        // the argument is handed over to the caller, which frees it.
+        char *arg = commands[1];
+        commands[1] = NULL;
+        free_command(commands);
+        return arg;
     } else { calculator_state = STATE_calc; return NULL;}
 }
 
-int main(void) {
+// compiles and evaluates an expression at x with the library, printing the error if there is one.
+bool calculate(calc_context *context, char *text, long double x_value, long double *value) {
+    calc_expr *compiled = NULL;
+    calc_status status = calc_compile(context, text, &compiled);
+    if(status == CALC_OK)
+        status = calc_eval(context, compiled, x_value, value);
+    calc_free(compiled);
+
+    if(status != CALC_OK)
+        printf("ERROR: %s\n", calc_error(context));
+    return status == CALC_OK;
+}
+
+// compiles a component of a curve as a function of its parameter, printing the error if it doesn't compile.
+p_data *compile_component(char *text, bool polar) {
+    char component[MAX_INPUT_LENGTH];
+    p_data *compiled = NULL;
+    if(!parameter_to_x(text, polar, component, sizeof(component)))
+        printf("ERROR: expression too long.\n");
+    else if((compiled = compile_function(component)) == NULL)
+        printf("ERROR: %s\n", error_message);
+    return compiled;
+}
+
+// a long command that runs as a job. everything it works on is gathered before it starts, so that the main loop can
+// carry on in the meantime. the commands that would change the function table wait until it's done.
+typedef struct {
+    state command;
+    f_table *functions;
+
+    // the functions it draws, the first of which is an expression of its own when there is one.
+    p_data **selected;
+    int selected_count;
+    p_data *expression;
+
+    // the function it works on (-1 for every function) and the second function of an intersection.
+    int first, second;
+    long double left_bound, right_bound, tolerance;
+    long samples;
+
+    // a display of its own, so that the window can change while it runs, and whether graphs are drawn progressively.
+    pixel **display;
+    long double x_steps, y_steps;
+    bool progressive;
+
+    // the arguments of /table.
+    char table[5][MAX_INPUT_LENGTH];
+
+    // the curve of /param and /polar, its components belong to the command.
+    c_curve curve;
+} c_job;
+
+// sets up a long command, drawing on a display of its own for the current window when it draws.
+c_job *new_command(state command, f_table *functions, bool draws, long double x_steps, long double y_steps, long double xmin, long double ymax) {
+    c_job *job = calloc(1, sizeof(c_job));
+    memory_acquire(MEMORY_commands, sizeof(c_job));
+    job -> command = command;
+    job -> functions = functions;
+    job -> first = job -> second = -1;
+    job -> x_steps = x_steps;
+    job -> y_steps = y_steps;
+    if(draws)
+        job -> display = quantify_plane(x_steps, y_steps, xmin, ymax);
+    return job;
+}
+
+// prints a frame of a progressive graph as soon as it's drawn. the coarse frames are only worth printing while
+// someone waits for them, a graph that carries on in the background only prints its last.
+void print_frame(pixel **display, int stride, void *argument) {
+    FILE *output = (FILE *) argument;
+    if(stride > 1 && !job_watched())
+        return;
+
+    if(stride > 2) fprintf(output, "every %ith column:\n", stride);
+    else fprintf(output, "every %scolumn:\n", stride == 2 ? "other " : "");
+    print_plane(display, output);
+    job_publish(output);
+}
+
+// runs a long command on the job's worker thread, printing to the job's output.
+void run_command(void *argument, FILE *output) {
+    c_job *job = (c_job *) argument;
+    long double x_steps = job -> x_steps, y_steps = job -> y_steps;
+    f_table *functions = job -> functions;
+    char label[MAX_INPUT_LENGTH * 2 + MAX_NAME + 32];
+
+    switch(job -> command) {
+        case STATE_graph:
+        case STATE_derive:
+            if(job -> progressive) {
+                g_progressive frames = draw_progressive(job -> display, job -> selected, x_steps, y_steps, job -> command == STATE_derive ? &derive : &evaluate,
+                    job -> selected_count, &print_frame, output);
+                if(!canceled())
+                    fprintf(output, "first frame after %.3fs, final frame after %.3fs (%i frames, %li evaluations)\n", frames.first, frames.final, frames.frames,
+                        frames.evaluations);
+                break;
+            }
+
+            draw_plane(job -> display, x_steps, y_steps);
+            draw_line(job -> display, job -> selected, x_steps, y_steps, job -> command == STATE_derive ? &derive : &evaluate, job -> selected_count);
+            if(!canceled())
+                print_plane(job -> display, output);
+        break;
+
+        case STATE_heatmap:;
+            int width = WINDOW_WIDTH, height = WINDOW_HEIGHT;
+            if(job -> selected_count < 1) {
+                fprintf(output, "ERROR: the function table is empty.\n");
+                break;
+            }
+
+            // a point per pixel, at the pixel's own x and y.
+            z_grid *grid = grid_new(width, height, job -> display[0][0].x, job -> display[0][width - 1].x, job -> display[0][0].y, job -> display[height - 1][0].y);
+            if(grid == NULL)
+                throw_error("out of memory");
+            double seconds = evaluate_grid(job -> selected[0], grid, 0, base);
+            if(!canceled()) {
+                print_heatmap(grid, output);
+                print_grid_rate(width, height, seconds, output);
+            }
+            grid_free(grid);
+        break;
+
+        case STATE_implicit:
+            draw_plane(job -> display, x_steps, y_steps);
+            seconds = 0;
+            for(int i = 0 ; i < job -> selected_count && !canceled() ; i++)
+                if(strlen(job -> selected[i] -> input) > 0)
+                    seconds += draw_implicit(job -> display, job -> selected[i], x_steps, y_steps, 0, base);
+            if(!canceled()) {
+                print_plane(job -> display, output);
+                print_grid_rate((WINDOW_WIDTH + 1) * job -> selected_count, WINDOW_HEIGHT + 1, seconds, output);
+            }
+        break;
+
+        case STATE_param:
+        case STATE_polar:;
+            draw_plane(job -> display, x_steps, y_steps);
+            c_result traced = draw_curve(job -> display, &job -> curve, x_steps, y_steps);
+            if(canceled())
+                break;
+
+            print_plane(job -> display, output);
+            fprintf(output, "%li samples in %i pass%s, %li evaluations in %.3fs (%.2f million samples/s)\n", traced.samples, traced.passes, traced.passes == 1 ? "" : "es", traced.evaluations,
+                traced.seconds, traced.seconds > 0 ? traced.samples / traced.seconds / 1e6 : 0);
+        break;
+
+        case STATE_integrate:
+            draw_plane(job -> display, x_steps, y_steps);
+            shade_graph(job -> display, job -> selected, x_steps, y_steps, 0, fminl(job -> left_bound, job -> right_bound), fmaxl(job -> left_bound, job -> right_bound));
+            if(canceled())
+                break;
+            print_plane(job -> display, output);
+
+            long double area = integrate(job -> left_bound, job -> right_bound, job -> selected[0], base);
+            if(!canceled())
+                fprintf(output, "area = %Lf\n", area);
+        break;
+
+        case STATE_analyze:;
+            v_analysis analysis = draw_views(job -> display, job -> selected[0], x_steps, y_steps, job -> left_bound, job -> right_bound);
+            if(canceled())
+                break;
+
+            print_views(job -> display, job -> selected[0], job -> left_bound, job -> right_bound, output);
+            fprintf(output, "area = %Lf\n", analysis.area);
+            fprintf(output, "%li evaluations in %.3fs (/graph, /graphdx and /integrate take %li)\n", analysis.evaluations, analysis.seconds,
+                separate_evaluations(job -> selected[0]));
+        break;
+
+        case STATE_roots:
+            draw_plane(job -> display, x_steps, y_steps);
+            draw_line(job -> display, job -> selected, x_steps, y_steps, &evaluate, job -> selected_count);
+
+            a_roots *roots = calloc(functions -> size + 1, sizeof(a_roots));
+            long double zeros[MAX_ROOTS] = { 0 };
+            for(int i = ftable_next(functions, -1) ; i >= 0 && !canceled() ; i = ftable_next(functions, i)) {
+                if(job -> first >= 0 && i != job -> first)
+                    continue;
+
+                roots[i] = find_roots(functions -> entries[i].data, NULL, job -> left_bound, job -> right_bound, ROOT_SAMPLES, job -> tolerance, base);
+                mark_points(job -> display, roots[i].roots, zeros, roots[i].root_cnt, x_steps, y_steps);
+            }
+
+            if(!canceled()) {
+                print_plane(job -> display, output);
+                for(int i = ftable_next(functions, -1) ; i >= 0 ; i = ftable_next(functions, i)) {
+                    if(job -> first >= 0 && i != job -> first)
+                        continue;
+
+                    snprintf(label, sizeof(label), "roots of %s = %s", functions -> entries[i].name, functions -> entries[i].data -> input);
+                    print_roots(label, &roots[i], job -> left_bound, job -> right_bound, output);
+                }
+            }
+            free(roots);
+        break;
+
+        case STATE_intersect:
+            draw_plane(job -> display, x_steps, y_steps);
+            draw_line(job -> display, job -> selected, x_steps, y_steps, &evaluate, 2);
+
+            a_roots intersections = find_roots(job -> selected[0], job -> selected[1], job -> left_bound, job -> right_bound, ROOT_SAMPLES, job -> tolerance, base);
+            if(canceled())
+                break;
+
+            long double heights[MAX_ROOTS];
+            for(int i = 0 ; i < intersections.root_cnt ; i++)
+                heights[i] = evaluate(intersections.roots[i], job -> selected[0], base);
+            mark_points(job -> display, intersections.roots, heights, intersections.root_cnt, x_steps, y_steps);
+            print_plane(job -> display, output);
+
+            snprintf(label, sizeof(label), "intersections of %s and %s", functions -> entries[job -> first].name, functions -> entries[job -> second].name);
+            print_roots(label, &intersections, job -> left_bound, job -> right_bound, output);
+            for(int i = 0 ; i < intersections.root_cnt ; i++)
+                fprintf(output, "\t(%Lf, %Lf)\n", intersections.roots[i], heights[i]);
+        break;
+
+        case STATE_range:;
+            a_stats stats = range_stats(job -> selected[0], job -> left_bound, job -> right_bound, job -> samples, 0, base);
+            if(canceled())
+                break;
+
+            snprintf(label, sizeof(label), "%s = %s", functions -> entries[job -> first].name, functions -> entries[job -> first].data -> input);
+            print_range_stats(label, &stats, job -> left_bound, job -> right_bound, output);
+        break;
+
+        case STATE_profile:;
+            r_profile profile = profile_expression(job -> expression, job -> left_bound, job -> right_bound, job -> samples);
+            if(!canceled())
+                print_profile(&profile, job -> expression, output);
+            profile_free(&profile);
+        break;
+
+        case STATE_table:
+            tabulate(job -> table[0], atof(job -> table[1]), atof(job -> table[2]), atof(job -> table[3]), job -> table[4][0] != '\0' ? job -> table[4] : NULL,
+                output, output, base);
+        break;
+
+        default:
+        break;
+    }
+}
+
+// frees what a long command ran with.
+void release_command(void *argument) {
+    c_job *job = (c_job *) argument;
+    free(job -> selected);
+    destroy_data(job -> expression);
+    destroy_data(job -> curve.x);
+    destroy_data(job -> curve.y);
+    if(job -> display != NULL)
+        clear_display(job -> display);
+    free(job);
+    memory_release(MEMORY_commands, sizeof(c_job));
+}
+
+// starts a long command as a job. piped input waits for it to finish, so that scripts get the same output in the
+// same order as before; at a terminal the prompt comes back once it has run for JOB_FOREGROUND.
+void start_command(j_job *job, char *command, c_job *work, bool interactive) {
+    if(!job_start(job, command, &run_command, &release_command, work)) {
+        printf("ERROR: could not start \"%s\".\n", command);
+        release_command(work);
+        return;
+    }
+
+    // a job canceled while it's still in the foreground is waited for, it stops at the end of its current block.
+    while(!job_wait(job, interactive ? JOB_FOREGROUND : -1, stdout) && (!interactive || job -> progress.canceled));
+    if(!job_finish(job, stdout))
+        printf("[%s] is running in the background, \"/jobs\" shows how far along it is and \"/cancel\" (or ctrl-c) stops it.\n", job -> command);
+}
+
+// whether a command has to wait for the running job: the jobs themselves, and the commands that change what a job
+// may be working on.
+bool waits_for_job(state command) {
+    switch(command) {
+        case STATE_graph: case STATE_derive: case STATE_heatmap: case STATE_implicit: case STATE_param: case STATE_polar: case STATE_integrate:
+        case STATE_analyze: case STATE_profile: case STATE_roots: case STATE_intersect:
+        case STATE_range: case STATE_table: case STATE_add: case STATE_remove: case STATE_clear: case STATE_base: case STATE_undefine:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// waits for a line of input, reloading the save files whenever another program changes them in the meantime and
+// printing the output of the job when it finishes. reloads wait until the job is done, since it may be using the
+// functions they would replace. returns which save files were reloaded, or -1 at the end of the input.
+int read_input(char *input, w_watch *watch, f_table *functions, long double *window, j_job *job) {
+    int changes = 0;
+    while(watch -> fd >= 0 || job -> active) {
+        struct pollfd polls[3] = {
+            { 0, POLLIN, 0 },
+            { job -> active ? -1 : watch -> fd, POLLIN, 0 },
+            { job -> active ? job -> wake[0] : -1, POLLIN, 0 }
+        };
+        int ready = poll(polls, 3, job -> active ? JOB_PROGRESS_INTERVAL : -1);
+        if(ready < 0)
+            continue;
+
+        // a job in the background reports how far along it is every JOB_PROGRESS_INTERVAL.
+        if(ready == 0 || polls[2].revents & POLLIN) {
+            printf("\n");
+            if(!job_finish(job, stdout))
+                print_job(job, stdout);
+            printf("$ ");
+            fflush(stdout);
+        }
+
+        int changed = polls[1].revents & POLLIN ? watch_changes(watch) : 0;
+        if(changed != 0) {
+            printf("\n");
+            reload_sources(changed, functions, window, stdout);
+            printf("$ ");
+            fflush(stdout);
+            changes |= changed;
+        }
+        if(polls[0].revents != 0)
+            break;
+    }
+
+    if(fgets(input, MAX_INPUT_LENGTH, stdin) == NULL)
+        return -1;
+    return changes;
+}
+
+int main(int argc, char **argv) {
+    // counters and timers are on from the start when CALC_STATS is set, and CALC_TRACE exports a trace of them.
+    if(!instrument_start())
+        fprintf(stderr, "ERROR: could not open the trace file \"%s\".\n", getenv(TRACE_VARIABLE));
+
+    // non-interactive batch mode: calculator --batch [-j threads] [file]
+    if(argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        int threads = worker_count();
+        FILE *batch_input = stdin;
+        for(int i = 2 ; i < argc ; i++) {
+            if(strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+                threads = atoi(argv[++i]);
+            else if((batch_input = fopen(argv[i], "r")) == NULL) {
+                fprintf(stderr, "ERROR: could not open \"%s\".\n", argv[i]);
+                return 1;
+            }
+        }
+        return run_batch(batch_input, stdout, threads, base);
+    }
+
+    // non-interactive tabulation: calculator --table expression x0 x1 step [file]
+    if(argc > 1 && strcmp(argv[1], "--table") == 0) {
+        if(argc < 6) {
+            fprintf(stderr, "usage: ./calculator --table expression<;expression...> x0 x1 step <file>\n");
+            return 1;
+        }
+        return tabulate(argv[2], atof(argv[3]), atof(argv[4]), atof(argv[5]), argc > 6 ? argv[6] : NULL, stdout, stderr, base);
+    }
+
+    // load generator for a running server: calculator --load socket [-c clients] [-n requests] [--expr expression]
+    if(argc > 2 && strcmp(argv[1], "--load") == 0) {
+        int clients = 8, requests = 10000;
+        char *load_expression = "sin(x)*x^2+3";
+        for(int i = 3 ; i + 1 < argc ; i++) {
+            if(strcmp(argv[i], "-c") == 0) clients = atoi(argv[++i]);
+            else if(strcmp(argv[i], "-n") == 0) requests = atoi(argv[++i]);
+            else if(strcmp(argv[i], "--expr") == 0) load_expression = argv[++i];
+        }
+
+        char request[MAX_LENGTH + 64];
+        snprintf(request, sizeof(request), "{\"id\":1,\"op\":\"eval\",\"expr\":\"%s\",\"x\":0.5}\n", load_expression);
+        return run_load(argv[2], clients, requests, request);
+    }
+
     // general input storage variable for the main loop.
     char *input = calloc(MAX_INPUT_LENGTH, 1);
 
     long double x_value = 0.0;
-    // general dataset for any given expression throughout the calculator's runtime.
-    p_data *expression = calloc(1, sizeof(p_data));
-
-    // initialize dataset for functions.
-    p_data **functions = calloc(MAX_FUNCTIONS, sizeof(p_data));
-    for(int i = 0 ; i < 10 ; i++) {
-        functions[i] = calloc(1, sizeof(p_data));
-        functions[i] -> input = (char *) calloc(MAX_INPUT_LENGTH, 1);
-    } int function_count = load_functions(functions);
-
-    // loads window data into four separate variables for boundaries.
-    long double *window_data = load_window_data();
+    int function_index;
+
+    // general calculations go through the library, so that a bad expression is reported instead of ending the program.
+    calc_context *context = calc_context_new();
+    long double value;
+
+    // the function table and window bounds come from the snapshot when it was made from the current save files
+    // (unless --no-snapshot is given), and are loaded and compiled from the save files otherwise.
+    f_table *functions = ftable_new();
+    long double window_data[4];
+    bool use_snapshot = true;
+    for(int i = 1 ; i < argc ; i++)
+        if(strcmp(argv[i], "--no-snapshot") == 0) use_snapshot = false;
+
+    // definitions come first, since the functions may use them.
+    load_definitions();
+
+    if(!use_snapshot || read_snapshot(SNAPSHOT_FILE, functions, window_data, &base, source_hash()) != 0) {
+        load_functions(functions);
+        long double *loaded = load_window_data();
+        memcpy(window_data, loaded, sizeof(window_data));
+        free(loaded);
+    }
+    calc_set_base(context, base);
+
+    // the save files are watched for changes from other programs from here on.
+    w_watch watch;
+    watch_start(&watch);
+
+    // non-interactive mapped evaluation: calculator --map in.f64 --out out.f64 --fn index|name|expression [-j threads]
+    if(argc > 1 && strcmp(argv[1], "--map") == 0) {
+        char *input_name = argv[2], *output_name = NULL, *function_name = NULL;
+        int threads = worker_count();
+        for(int i = 3 ; i + 1 < argc ; i++) {
+            if(strcmp(argv[i], "--out") == 0) output_name = argv[++i];
+            else if(strcmp(argv[i], "--fn") == 0) function_name = argv[++i];
+            else if(strcmp(argv[i], "-j") == 0) threads = atoi(argv[++i]);
+        }
+
+        if(argc < 3 || output_name == NULL || function_name == NULL) {
+            fprintf(stderr, "usage: ./calculator --map in.f64 --out out.f64 --fn index|name|expression <-j threads>\n");
+            return 1;
+        }
+
+        // the function is either a function in the function table (by index or name) or an expression of its own.
+        p_data *function;
+        if((function_index = ftable_find(functions, function_name)) >= 0) {
+            function = functions -> entries[function_index].data;
+        } else if(strspn(function_name, "0123456789") == strlen(function_name)) {
+            fprintf(stderr, "ERROR: function does not exist.\n");
+            return 1;
+        } else if((function = compile_function(function_name)) == NULL) {
+            fprintf(stderr, "ERROR: %s\n", error_message);
+            return 1;
+        }
+
+        m_result result;
+        if(map_file(input_name, output_name, function, threads, base, &result) != 0)
+            return 1;
+
+        fprintf(stderr, "%zu values on %i threads in %.3fs (%.2f million values/s, %.2f GB/s in, %.2f GB/s in and out)\n", result.values, result.threads,
+            result.seconds, result.seconds > 0 ? result.values / result.seconds / 1e6 : 0, result.seconds > 0 ? result.values * 8 / result.seconds / 1e9 : 0,
+            result.seconds > 0 ? result.values * 16 / result.seconds / 1e9 : 0);
+        return 0;
+    }
+
+    // window data in four separate variables for boundaries.
     long double xmin = window_data[0];
     long double xmax = window_data[1];
     long double ymin = window_data[2];
     long double ymax = window_data[3];
 
+    // evaluation server on a unix domain socket: calculator --serve socket [-j threads]
+    if(argc > 2 && strcmp(argv[1], "--serve") == 0) {
+        int threads = worker_count();
+        for(int i = 3 ; i + 1 < argc ; i++)
+            if(strcmp(argv[i], "-j") == 0) threads = atoi(argv[++i]);
+        return serve(argv[2], functions, window_data, &watch, threads);
+    }
+
     // calculates the width and height of each pixel on the (x, y) plane using the boundaries.
     long double x_steps = ((xmax-xmin) / WINDOW_WIDTH);
     long double y_steps = ((ymax-ymin) / WINDOW_HEIGHT);
 
-    // initializes the display.
-    pixel **display = quantify_plane(x_steps, y_steps, xmin, ymax);
-
-    int function_index;
-
     // general string container for any command line argument.
     char *argument = NULL;
 
+    // long commands run as jobs on a worker thread. at a terminal, the prompt comes back while they run.
+    j_job job;
+    c_job *work;
+    bool interactive = isatty(0);
+
+    // whether graphs are drawn coarse first, then finer until every column is drawn.
+    bool progressive = false;
+    if(!job_init(&job))
+        fprintf(stderr, "ERROR: could not set up jobs.\n");
+
+    // stdin is read without a buffer, so that waiting for it (and the save files and jobs) sees exactly what is left
+    // to read.
+    if(watch.fd >= 0 || interactive)
+        setvbuf(stdin, NULL, _IONBF, 0);
+
     // main program loop.
     while(true) {
 
         printf("$ ");
-        fgets(input, MAX_INPUT_LENGTH, stdin);
+        fflush(stdout);
+        int changes = read_input(input, &watch, functions, window_data, &job);
+        if(changes < 0)
+            return 0;
+
+        // a new window from the save file replaces the current one.
+        if(changes & WATCH_window) {
+            xmin = window_data[0];
+            xmax = window_data[1];
+            ymin = window_data[2];
+            ymax = window_data[3];
+            x_steps = ((xmax-xmin) / WINDOW_WIDTH);
+            y_steps = ((ymax-ymin) / WINDOW_HEIGHT);
+        }
+
+        // every command is timed as a whole as well as by its phases.
+        char command[MAX_INPUT_LENGTH];
+        double command_start = phase_begin();
+        snprintf(command, sizeof(command), "%.*s", (int) strcspn(input, "\n"), input);
+
+        // the argument belongs to the loop, and lives until the next command replaces it.
+        free(argument);
         argument = current_action_id(input);
+        if(job.active && waits_for_job(calculator_state)) {
+            printf("ERROR: \"%s\" is still running, wait for it to finish or \"/cancel\" it first.\n", job.command);
+            phase_end_named(PHASE_command, command_start, command);
+            continue;
+        }
 
         switch(calculator_state) {
             // anything that isn't a command is handled by STATE_calc.
             case STATE_calc:
-                clear_data(expression);
-                expression -> input = calloc(MAX_INPUT_LENGTH, 1);
-                strcpy(expression -> input, input);
-                expression -> input = eat_whitespace(expression -> input, strlen(input));
-                compile(expression);
-                printf("\t\t\t%Lf\n", evaluate(x_value, expression, base));
+                // "name = expression" and "name(parameter) = expression" are definitions, everything else is calculated.
+                if(define(functions, input, job.active))
+                    break;
+
+                if(calculate(context, input, x_value, &value))
+                    printf("\t\t\t%Lf\n", value);
             break;
 
             // a help command for usability and user education.
@@ -269,38 +971,66 @@ int main(void) {
                 print_help();
             break;
 
-            // graphs the current function table and outputs the graph.
+            // graphs the current function table (or its derivatives) and outputs the graph. heatmaps and implicit curves
+            // take the same arguments, as functions of x and y.
             case STATE_graph:
-                draw_plane(display, x_steps, y_steps);
-
-                if(argument != NULL) {
-                    clear_data(expression);
-                    expression -> input = argument;
-                    compile(expression);
-                    draw_line(display, &expression, x_steps, y_steps, &evaluate, 1);
-                } else draw_line(display, functions, x_steps, y_steps, &evaluate, MAX_FUNCTIONS);
-                print_plane(display);
-                calculator_state = STATE_calc;
+            case STATE_derive:
+            case STATE_heatmap:
+            case STATE_implicit:
+                work = new_command(calculator_state, functions, true, x_steps, y_steps, xmin, ymax);
+
+                // the arguments are either functions in the function table (by index or name) or an expression.
+                work -> selected = select_functions(functions, argument_count, arguments, &work -> selected_count);
+                if(work -> selected_count < 0) {
+                    if((work -> expression = compile_function(argument)) == NULL) {
+                        printf("ERROR: %s\n", error_message);
+                        release_command(work);
+                        break;
+                    }
+                    work -> selected[0] = work -> expression;
+                    work -> selected_count = 1;
+                }
+                work -> progressive = progressive;
+                start_command(&job, command, work, interactive);
+            break;
+
+            // draws a parametric curve (x(t), y(t)) or a polar curve r(θ), for a parameter from 0 to 2pi unless the
+            // bounds are given.
+            case STATE_param:
+            case STATE_polar:;
+                bool polar = calculator_state == STATE_polar;
+                int components = polar ? 1 : 2;
+                if(argument_count < components || argument_count == components + 1) {
+                    printf("ERROR: usage is %s.\n", polar ? "/polar r(θ) <θ0 θ1>" : "/param x(t) y(t) <t0 t1>");
+                    break;
+                }
+
+                long double t0 = 0, t1 = 2 * M_PI;
+                if(argument_count > components && (!calculate(context, arguments[components], x_value, &t0) || !calculate(context, arguments[components + 1], x_value, &t1)))
+                    break;
+
+                work = new_command(calculator_state, functions, true, x_steps, y_steps, xmin, ymax);
+                work -> curve = (c_curve) { compile_component(arguments[0], polar), NULL, polar, t0, t1 };
+                if(work -> curve.x == NULL || (!polar && (work -> curve.y = compile_component(arguments[1], polar)) == NULL)) {
+                    release_command(work);
+                    break;
+                }
+                start_command(&job, command, work, interactive);
             break;
 
             // sets the base of log in the calculator.
             case STATE_base:
-                if(argument != NULL) {
-                    clear_data(expression);
-                    expression -> input = argument;
-                    compile(expression);
-                } else {
-                    clear_data(expression);
+                if(argument == NULL) {
                     printf("current log() base: %Lf\n", base);
                     printf("new log() base: $ ");
-                    expression -> input = calloc(MAX_INPUT_LENGTH, 1);
-                    fgets(expression -> input, MAX_INPUT_LENGTH, stdin);
-                    expression -> input = eat_whitespace(expression -> input, strlen(expression -> input));
-                    compile(expression);
+                    fgets(input, MAX_INPUT_LENGTH, stdin);
                 }
 
-                base = evaluate(x_value, expression, base);
-                printf("new log() base set to %Lf\n", base);
+                if(calculate(context, argument != NULL ? argument : input, x_value, &value)) {
+                    base = value;
+                    calc_set_base(context, base);
+                    printf("new log() base set to %Lf\n", base);
+                }
             break;
 
             // prints the current window boundaries
@@ -335,59 +1065,32 @@ int main(void) {
                         calculator_state = STATE_error;
                     }
                     
-                    x_steps = ((ymax-ymin) / WINDOW_WIDTH);
+                    x_steps = ((xmax-xmin) / WINDOW_WIDTH);
                     y_steps = ((ymax-ymin) / WINDOW_HEIGHT);
-
-                    display = quantify_plane(x_steps, y_steps, xmin, ymax);
                 }
             break;
 
             // clear function table.
             case STATE_clear:
-                for(int i = 0 ; i < MAX_FUNCTIONS ; i++) {
-                    functions[i] = calloc(1, sizeof(p_data));
-                    functions[i] -> input = calloc(MAX_INPUT_LENGTH, 1);
-                }
+                ftable_clear(functions);
             break;
 
             // change the value of x in general expression evaluation.
             case STATE_x:
-                if(argument != NULL) {
-                    clear_data(expression);
-                    expression -> input = argument;
-                    compile(expression);
-                } else {
-                    clear_data(expression);
-                    expression -> input = calloc(MAX_INPUT_LENGTH, 1);
+                if(argument == NULL) {
                     printf("current x value for expression evaluation: %Lf\n", x_value);
                     printf("new x value: $ ");
-                    fgets(expression -> input, MAX_INPUT_LENGTH, stdin);
-                    expression -> input = eat_whitespace(expression -> input, strlen(expression -> input));
-                    compile(expression);
+                    fgets(input, MAX_INPUT_LENGTH, stdin);
                 }
-                x_value = evaluate(x_value, expression, base);
-                printf("new x value set to %Lf\n", x_value);
-            break;
-
-            // graphs the derivatives of the functions in the current function table and outputs the graph.
-            case STATE_derive:
 
-                draw_plane(display, x_steps, y_steps);
-                if(argument != NULL) {
-                    clear_data(expression);
-                    expression -> input = argument;
-                    compile(expression);
-                    draw_line(display, &expression, x_steps, y_steps, &derive, 1);
-                } else draw_line(display, functions, x_steps, y_steps, &derive, MAX_FUNCTIONS);
-
-                print_plane(display);
+                if(calculate(context, argument != NULL ? argument : input, x_value, &value)) {
+                    x_value = value;
+                    printf("new x value set to %Lf\n", x_value);
+                }
             break;
 
             // graphs the definite integral of a selected function in the function table.
             case STATE_integrate:
-
-                draw_plane(display, x_steps, y_steps);
-
                 // prompts the user for left and right bounds of the integral.
                 long double left_bound, right_bound;
                 printf("left bound: $ ");
@@ -397,32 +1100,77 @@ int main(void) {
                 fgets(input, MAX_INPUT_LENGTH, stdin);
                 right_bound = atof(input);
 
-                if(argument != NULL) {
-                    clear_data(expression);
-                    expression -> input = argument;
-                    compile(expression);
-                    shade_graph(display, &expression, x_steps, y_steps, 0, left_bound, right_bound);
+                work = new_command(STATE_integrate, functions, true, x_steps, y_steps, xmin, ymax);
+                work -> selected = malloc(sizeof(p_data *));
+                work -> selected_count = 1;
+                work -> left_bound = left_bound;
+                work -> right_bound = right_bound;
+
+                // the argument is either a function in the function table (by index or name) or an expression.
+                function_index = argument != NULL ? ftable_find(functions, argument) : -1;
+                if(argument != NULL && function_index < 0) {
+                    if((work -> expression = compile_function(argument)) == NULL) {
+                        printf("ERROR: %s\n", error_message);
+                        release_command(work);
+                        break;
+                    }
+                    work -> selected[0] = work -> expression;
                 } else {
                     // acquires user input for their desired function to integrate under.
-                    if(function_count > 1) {
+                    if(argument == NULL && functions -> live > 1) {
                         print_functions(functions);
-                        printf("which function would you like to integrate under? (1-10)$ ");
+                        printf("which function would you like to integrate under? (index or name)$ ");
                         fgets(input, MAX_INPUT_LENGTH, stdin);
-                        function_index = atoi(input) - 1;
-                    } else function_index = function_count-1;
+                        input[strcspn(input, "\n")] = '\0';
+                        function_index = ftable_find(functions, input);
+                    } else if(argument == NULL) function_index = ftable_next(functions, -1);
 
                     // error handling
-                    if(function_index < 0 || function_index > 9) {
+                    if(function_index < 0) {
                         printf("ERROR: function does not exist.\n");
-                        continue;
+                        release_command(work);
+                        break;
                     }
+                    work -> selected[0] = functions -> entries[function_index].data;
+                }
 
-                    // graphs the function with the shading parameters of the draw function enabled, and outputs the graph.
-                    shade_graph(display, functions, x_steps, y_steps, function_index, left_bound, right_bound);
-                } print_plane(display);
-
+                // graphs the function with the shading parameters of the draw function enabled, outputs the graph and
                 // prints the AUC.
-                printf("area = %Lf\n", integrate(left_bound, right_bound, argument == NULL? functions[function_index] : expression));
+                start_command(&job, command, work, interactive);
+            break;
+
+            // draws a function (in the function table, by index or name, or an expression), its derivative and the area
+            // under it between the bounds (the window unless they're given) from one sample per column.
+            case STATE_analyze:
+                if(argument_count != 1 && argument_count != 3) {
+                    printf("ERROR: usage is /analyze function <a b>.\n");
+                    break;
+                }
+
+                left_bound = xmin;
+                right_bound = xmax;
+                if(argument_count == 3 && (!calculate(context, arguments[1], x_value, &left_bound) || !calculate(context, arguments[2], x_value, &right_bound)))
+                    break;
+                if(view_samples(xmin, x_steps, left_bound, right_bound, NULL) < 0) {
+                    printf("ERROR: the bounds are too far outside of the window.\n");
+                    break;
+                }
+
+                work = new_command(STATE_analyze, functions, true, x_steps, y_steps, xmin, ymax);
+                work -> selected = malloc(sizeof(p_data *));
+                work -> selected_count = 1;
+                work -> left_bound = left_bound;
+                work -> right_bound = right_bound;
+                if((function_index = ftable_find(functions, arguments[0])) >= 0)
+                    work -> selected[0] = functions -> entries[function_index].data;
+                else if((work -> expression = compile_function(arguments[0])) != NULL)
+                    work -> selected[0] = work -> expression;
+                else {
+                    printf("ERROR: %s\n", error_message);
+                    release_command(work);
+                    break;
+                }
+                start_command(&job, command, work, interactive);
             break;
 
             // displays the function table.
@@ -430,89 +1178,290 @@ int main(void) {
                 print_functions(functions);
             break;
 
-            // adds a function to the first empty slot in the function table.
+            // adds a function to the first empty slot in the function table, or replaces the function with the same name.
             case STATE_add:
-
-                if(function_count == 10) {
-                    printf("maximum function count [10] has been reached.\n");
-                    printf("which function would you like to replace? (1-10)$ ");
+                if(argument == NULL) {
+                    // prompts user for function input.
+                    printf("new function: ");
                     fgets(input, MAX_INPUT_LENGTH, stdin);
-                    function_index = atoi(input);
-                    if(function_index < 1 || function_index > 10) {
-                        printf("ERROR: input must be a number between 1 and 10.\n");
-                        function_index = function_count;
-                        break;
-                    }
                 }
 
-                function_index = 0;
+                // a definition is either "name = expression" or an expression, which is named after its index.
+                char *name, *definition;
+                if(!split_definition(argument != NULL ? argument : input, &name, &definition)) {
+                    printf("ERROR: function names start with a letter and only have letters, digits and '_'.\n");
+                    break;
+                }
 
-                // finds the first opening in the function table
-                while(function_index < 10 && strlen(functions[function_index] -> input) != 0)
-                    function_index++;
+                // compiles the function and prints it along with its index.
+                p_data *added = compile_function(definition);
+                if(added == NULL)
+                    printf("ERROR: %s\n", error_message);
+                else {
+                    function_index = ftable_set(functions, name, added);
+                    functions -> entries[function_index].unsaved = true;
+                    print_function(functions, function_index);
+                }
+            break;
 
-                if(argument != NULL) {
-                    functions[function_index] -> input = argument;
+            // removes a desired function from the function table.
+            case STATE_remove:
+                if(argument == NULL) {
+                    // prompts the user to select a function to remove.
+                    print_functions(functions);
+                    printf("which function would you like to remove? (index or name)$ ");
+                    fgets(input, MAX_INPUT_LENGTH, stdin);
+                    input[strcspn(input, "\n")] = '\0';
+                }
+
+                function_index = ftable_find(functions, argument != NULL ? argument : input);
+                if(function_index < 0) {
+                    printf("ERROR: function does not exist.\n");
                 } else {
+                    // frees the function and prints the updated function table.
+                    ftable_remove(functions, function_index);
+                    print_functions(functions);
+                }
+            break;
 
-                    // prompts user for function input.
-                    printf("new function: ");
-                    fgets(functions[function_index] -> input, MAX_INPUT_LENGTH, stdin);
+            // finds the roots of functions in the function table and marks them on the graph.
+            case STATE_roots:
+                // arguments are [index] [left bound, right bound] [tolerance], and default to every function in the window.
+                function_index = argument_count == 1 || argument_count >= 3 ? ftable_find(functions, arguments[0]) : -1;
+                left_bound = argument_count >= 2 ? atof(arguments[argument_count == 2 ? 0 : 1]) : xmin;
+                right_bound = argument_count >= 2 ? atof(arguments[argument_count == 2 ? 1 : 2]) : xmax;
+                long double tolerance = argument_count >= 4 ? atof(arguments[3]) : ROOT_TOLERANCE;
+
+                if((argument_count == 1 || argument_count >= 3) && function_index < 0) {
+                    printf("ERROR: function does not exist.\n");
+                    break;
+                }
+
+                work = new_command(STATE_roots, functions, true, x_steps, y_steps, xmin, ymax);
+                work -> first = function_index;
+                work -> left_bound = left_bound;
+                work -> right_bound = right_bound;
+                work -> tolerance = tolerance;
+                if(function_index >= 0) {
+                    work -> selected = malloc(sizeof(p_data *));
+                    work -> selected[0] = functions -> entries[function_index].data;
+                    work -> selected_count = 1;
+                } else work -> selected = select_functions(functions, 0, NULL, &work -> selected_count);
+                start_command(&job, command, work, interactive);
+            break;
 
-                    // compiles the function and prints the new function table.
-                    functions[function_index] -> input = eat_whitespace(functions[function_index] -> input, strlen(functions[function_index] -> input));
+            // finds the intersections of two functions in the function table and marks them on the graph.
+            case STATE_intersect:
+                // arguments are index, index [left bound, right bound] [tolerance].
+                if(argument_count < 2) {
+                    printf("ERROR: two functions must be given.\n");
+                    break;
                 }
 
-                compile(functions[function_index]);
-                print_functions(functions);
+                int first = ftable_find(functions, arguments[0]), second = ftable_find(functions, arguments[1]);
+                left_bound = argument_count >= 4 ? atof(arguments[2]) : xmin;
+                right_bound = argument_count >= 4 ? atof(arguments[3]) : xmax;
+                tolerance = argument_count >= 5 ? atof(arguments[4]) : ROOT_TOLERANCE;
 
-                function_count++;
+                if(first < 0 || second < 0) {
+                    printf("ERROR: function does not exist.\n");
+                    break;
+                }
+
+                work = new_command(STATE_intersect, functions, true, x_steps, y_steps, xmin, ymax);
+                work -> first = first;
+                work -> second = second;
+                work -> selected = malloc(2 * sizeof(p_data *));
+                work -> selected[0] = functions -> entries[first].data;
+                work -> selected[1] = functions -> entries[second].data;
+                work -> selected_count = 2;
+                work -> left_bound = left_bound;
+                work -> right_bound = right_bound;
+                work -> tolerance = tolerance;
+                start_command(&job, command, work, interactive);
             break;
 
-            // removes a desired function from the function table.
-            case STATE_remove:
+            // prints the minimum, maximum, mean and rms of a function in the function table over an interval.
+            case STATE_range:
+                // arguments are index, left bound, right bound [sample count].
+                if(argument_count < 3) {
+                    printf("ERROR: usage is /stats-range function left right <samples>.\n");
+                    break;
+                }
 
-                if(argument != NULL) {
-                    function_index = atoi(argument)-1;
+                function_index = ftable_find(functions, arguments[0]);
+                if(function_index < 0) {
+                    printf("ERROR: function does not exist.\n");
+                    break;
+                }
 
-                    if(function_index < 0 || function_index > 9) {
-                        printf("ERROR: input must be a number between 1 and 10.\n");
-                        continue;
-                    } else {
-                        // clears the function from the function table and prints the updated function table.
-                        functions[function_index] = calloc(1, sizeof(p_data));
-                        functions[function_index] -> input = calloc(MAX_INPUT_LENGTH, 1);
-                        function_count--;
+                long samples = argument_count >= 4 ? atol(arguments[3]) : STATS_SAMPLES;
+                if(samples < 1) {
+                    printf("ERROR: sample count must be positive.\n");
+                    break;
+                }
 
-                        print_functions(functions);
-                    }
-                } else {
-                    // prompts the user to select a function to remove.
-                    print_functions(functions);
-                    printf("which function would you like to remove? (1-10)$ ");
-                    fgets(input, MAX_INPUT_LENGTH, stdin);
-                    function_index = atoi(input)-1;
+                work = new_command(STATE_range, functions, false, x_steps, y_steps, xmin, ymax);
+                work -> first = function_index;
+                work -> selected = malloc(sizeof(p_data *));
+                work -> selected[0] = functions -> entries[function_index].data;
+                work -> selected_count = 1;
+                work -> left_bound = atof(arguments[1]);
+                work -> right_bound = atof(arguments[2]);
+                work -> samples = samples;
+                start_command(&job, command, work, interactive);
+            break;
 
-                    if(function_index < 0 || function_index > 9) {
-                        printf("ERROR: input must be a number between 1 and 10.\n");
-                        continue;
-                    } else {
-                        // clears the function from the function table and prints the updated function table.
-                        functions[function_index] = calloc(1, sizeof(p_data));
-                        functions[function_index] -> input = calloc(MAX_INPUT_LENGTH, 1);
-                        function_count--;
+            // evaluates an expression (or function, by index or name) at evenly spaced points over the window (or
+            // between the bounds) and prints how long every part of it took.
+            case STATE_profile:
+                if(argument_count != 1 && argument_count != 3 && argument_count != 4) {
+                    printf("ERROR: usage is /profile expression <x0 x1 <samples>>.\n");
+                    break;
+                }
 
-                        print_functions(functions);
-                    }
+                left_bound = xmin;
+                right_bound = xmax;
+                if(argument_count >= 3 && (!calculate(context, arguments[1], x_value, &left_bound) || !calculate(context, arguments[2], x_value, &right_bound)))
+                    break;
+                samples = argument_count == 4 ? atol(arguments[3]) : PROFILE_SAMPLES;
+                if(samples < 1) {
+                    printf("ERROR: sample count must be positive.\n");
+                    break;
                 }
+
+                function_index = ftable_find(functions, arguments[0]);
+                work = new_command(STATE_profile, functions, false, x_steps, y_steps, xmin, ymax);
+                work -> left_bound = left_bound;
+                work -> right_bound = right_bound;
+                work -> samples = samples;
+                if((work -> expression = compile_expression(function_index >= 0 ? functions -> entries[function_index].data -> input : arguments[0], true)) == NULL) {
+                    printf("ERROR: %s\n", error_message);
+                    release_command(work);
+                    break;
+                }
+                start_command(&job, command, work, interactive);
+            break;
+
+            // samples expressions over an interval and writes them to a csv or binary file.
+            case STATE_table:
+                // arguments are expression<;expression...>, x0, x1, step [file].
+                if(argument_count < 4) {
+                    printf("ERROR: usage is /table expression x0 x1 step <file>.\n");
+                    break;
+                }
+
+                work = new_command(STATE_table, functions, false, x_steps, y_steps, xmin, ymax);
+                for(int i = 0 ; i < argument_count && i < 5 ; i++)
+                    snprintf(work -> table[i], sizeof(work -> table[i]), "%s", arguments[i]);
+                start_command(&job, command, work, interactive);
+            break;
+
+            // prints the counters and timers, or turns them on, off or back to zero.
+            case STATE_stats:
+                if(argument_count == 0)
+                    print_instrumentation(stdout);
+                else if(strcmp(arguments[0], "on") == 0) {
+                    if(instrument_enable(true)) printf("instrumentation is on.\n");
+                    else printf("ERROR: instrumentation isn't compiled in (INSTRUMENT is 0).\n");
+                } else if(strcmp(arguments[0], "off") == 0) {
+                    instrument_enable(false);
+                    printf("instrumentation is off.\n");
+                } else if(strcmp(arguments[0], "reset") == 0) {
+                    instrument_reset();
+                    printf("the counters and timers are back to zero.\n");
+                } else printf("ERROR: usage is /stats <on|off|reset>.\n");
+            break;
+
+            // prints the memory that every part of the calculator holds and the resident set size.
+            case STATE_memory:
+                print_memory(stdout);
+            break;
+
+            // turns progressive graphs on or off.
+            case STATE_progressive:
+                if(argument_count > 0 && strcmp(arguments[0], "on") == 0) progressive = true;
+                else if(argument_count > 0 && strcmp(arguments[0], "off") == 0) progressive = false;
+                else if(argument_count > 0) {
+                    printf("ERROR: usage is /progressive <on|off>.\n");
+                    break;
+                }
+                printf("progressive graphs are %s.\n", progressive ? "on" : "off");
+            break;
+
+            // prints how far along the running job is.
+            case STATE_jobs:
+                print_job(&job, stdout);
+            break;
+
+            // asks the running job to stop, it stops at the end of its current block.
+            case STATE_cancel:
+                if(job_cancel(&job))
+                    printf("canceling \"%s\".\n", job.command);
+                else printf("no job is running.\n");
+            break;
+
+            // prints the variables and functions that were defined.
+            case STATE_definitions:
+                print_definitions();
+            break;
+
+            // removes a definition, unless something still uses it.
+            case STATE_undefine:
+                if(argument_count == 0) {
+                    printf("ERROR: usage is /undef name.\n");
+                    break;
+                }
+
+                int slot = definition_find(&calc_definitions, arguments[0]);
+                if(slot < 0) {
+                    printf("ERROR: \"%s\" isn't defined.\n", arguments[0]);
+                    break;
+                }
+
+                bool *marked = calloc(calc_definitions.count, sizeof(bool));
+                marked[slot] = true;
+                function_index = ftable_next(functions, -1);
+                while(function_index >= 0 && !text_depends(&calc_definitions, functions -> entries[function_index].data -> input, marked))
+                    function_index = ftable_next(functions, function_index);
+                free(marked);
+
+                if(function_index >= 0)
+                    printf("ERROR: %s uses %s, remove it first.\n", functions -> entries[function_index].name, arguments[0]);
+                else if(!definition_remove(&calc_definitions, slot))
+                    printf("ERROR: other definitions use %s, remove them first.\n", arguments[0]);
+                else printf("%s is no longer defined.\n", arguments[0]);
             break;
 
             // save current runtime data and exit the program.
             case STATE_quit:
+                // a running job is canceled, and finished before anything is saved.
+                if(job_cancel(&job)) {
+                    while(!job_wait(&job, -1, stdout));
+                    job_finish(&job, stdout);
+                }
+
+                // changes that other programs made since the last reload are kept instead of being overwritten.
+                changes = watch_changes(&watch);
+                reload_sources(changes, functions, window_data, stdout);
+                if(changes & WATCH_window) {
+                    xmin = window_data[0];
+                    xmax = window_data[1];
+                    ymin = window_data[2];
+                    ymax = window_data[3];
+                }
+
                 save_functions(functions);
                 printf("functions saved successfully.\n");
                 save_window_data(xmin, xmax, ymin, ymax);
                 printf("window data saved successfully.\n");
+                if(save_definitions() != 0)
+                    printf("ERROR: could not save the definitions.\n");
+
+                // the snapshot is made from the files that were just saved, so that the next start can skip compiling.
+                long double window[4] = { xmin, xmax, ymin, ymax };
+                if(write_snapshot(SNAPSHOT_FILE, functions, window, base, source_hash()) != 0)
+                    printf("ERROR: could not save the snapshot.\n");
                 exit(0);
             break;
 
@@ -521,5 +1470,6 @@ int main(void) {
                 printf("ERROR: invalid command, type \"/help\" for a list of commands.\n");
             break;
         }
+        phase_end_named(PHASE_command, command_start, command);
     }
 }
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#ifndef CDEF
+#define CDEF static inline
+#endif
+
+// the samples a curve starts with, evenly spaced over its parameter.
+#ifndef CURVE_SAMPLES
+#define CURVE_SAMPLES 256
+#endif
+
+// how many times the step between two samples can be halved, and the most samples a curve takes in all.
+#ifndef CURVE_DEPTH
+#define CURVE_DEPTH 16
+#endif
+
+#ifndef CURVE_MAX_SAMPLES
+#define CURVE_MAX_SAMPLES (1 << 20)
+#endif
+
+// how many cells apart two samples can be and still be joined once their step can't be halved anymore. farther apart
+// they are a jump, at a pole or a discontinuity, and are left apart.
+#ifndef CURVE_JUMP
+#define CURVE_JUMP 4
+#endif
+
+// a curve in the plane. a parametric curve is (x(t), y(t)), a polar curve is r(θ) with r as its x and no y. both
+// are compiled as functions of x, which stands for the parameter.
+typedef struct {
+    p_data *x, *y;
+    bool polar;
+    long double t0, t1;
+} c_curve;
+
+// a sample of a curve, at its cell of the display. columns and rows count from the top left pixel, and aren't
+// rounded so that the direction between two samples is kept.
+typedef struct {
+    long double t, column, row;
+    int depth;
+} c_point;
+
+// how much sampling a curve took.
+typedef struct {
+    long samples, evaluations;
+    int passes;
+    double seconds;
+} c_result;
+
+// writes the text of a curve's component with every parameter name (t, or theta and θ for a polar curve) replaced
+// by x, so that it compiles as a function of x. returns false if it doesn't fit.
+CDEF bool parameter_to_x(const char *text, bool polar, char *out, int size) {
+    int length = 0, theta = strlen("θ");
+    for(int i = 0 ; text[i] != '\0' ; ) {
+        // names are copied whole, so that the t of tan or of a definition's name is left alone.
+        int word = 1;
+        bool parameter = false;
+        if(isalpha((unsigned char) text[i])) {
+            while(name_character(text[i + word]))
+                word++;
+            parameter = (word == 1 && text[i] == 't') || (polar && word == 5 && strncmp(text + i, "theta", 5) == 0);
+        } else if(polar && strncmp(text + i, "θ", theta) == 0) {
+            word = theta;
+            parameter = true;
+        }
+
+        int copied = parameter ? 1 : word;
+        if(length + copied >= size)
+            return false;
+        memcpy(out + length, parameter ? "x" : text + i, copied);
+        length += copied;
+        i += word;
+    }
+    out[length] = '\0';
+    return true;
+}
+
+// evaluates every component over one batch of parameter values and places the points on the display. a polar curve
+// evaluates r once and turns it into x and y.
+CDEF void sample_curve(c_curve *curve, pixel **display, long double x_steps, long double y_steps, c_point *points, int n, long double *t, long double *xvalues, long double *yvalues) {
+    for(int i = 0 ; i < n ; i++)
+        t[i] = points[i].t;
+
+    evaluate_batch(curve -> x, t, xvalues, n, base);
+    if(curve -> polar)
+        for(int i = 0 ; i < n ; i++) {
+            long double r = xvalues[i];
+            xvalues[i] = r * cosl(t[i]);
+            yvalues[i] = r * sinl(t[i]);
+        }
+    else evaluate_batch(curve -> y, t, yvalues, n, base);
+
+    for(int i = 0 ; i < n ; i++) {
+        points[i].column = (xvalues[i] - display[0][0].x) / x_steps;
+        points[i].row = (display[0][0].y - yvalues[i]) / y_steps;
+    }
+}
+
+// returns whether a point has a place in the plane, and whether two points are on the same side of the display, where
+// nothing between them can be seen.
+CDEF bool point_finite(c_point *point) {
+    return isfinite(point -> column) && isfinite(point -> row);
+}
+
+CDEF bool outside_together(c_point *a, c_point *b) {
+    return (a -> column < -1 && b -> column < -1) || (a -> column > WINDOW_WIDTH && b -> column > WINDOW_WIDTH)
+        || (a -> row < -1 && b -> row < -1) || (a -> row > WINDOW_HEIGHT && b -> row > WINDOW_HEIGHT);
+}
+
+// returns how many cells apart two points are.
+CDEF long double cell_distance(c_point *a, c_point *b) {
+    return fmaxl(fabsl(b -> column - a -> column), fabsl(b -> row - a -> row));
+}
+
+// the stroke that a curve going from one cell to another is drawn with. rows count down, so going right and down
+// is '\'.
+CDEF char curve_stroke(long double columns, long double rows) {
+    if(fabsl(rows) * 2 < fabsl(columns))
+        return '-';
+    if(fabsl(columns) * 2 < fabsl(rows))
+        return '|';
+    return (columns > 0) == (rows > 0) ? '\\' : '/';
+}
+
+// draws a cell of the curve, if it's on the display.
+CDEF void plot_cell(pixel **display, long double column, long double row, char stroke) {
+    int x = (int) roundl(column), y = (int) roundl(row);
+    if(x >= 0 && x < WINDOW_WIDTH && y >= 0 && y < WINDOW_HEIGHT)
+        display[y][x].display = stroke;
+}
+
+// joins two samples by stepping a cell at a time along the line between them.
+CDEF void step_line(pixel **display, c_point *a, c_point *b) {
+    long double columns = b -> column - a -> column, rows = b -> row - a -> row;
+    int steps = (int) ceill(fmaxl(fabsl(columns), fabsl(rows)));
+    char stroke = curve_stroke(columns, rows);
+    for(int s = 0 ; s <= steps ; s++)
+        plot_cell(display, a -> column + (steps > 0 ? columns * s / steps : 0), a -> row + (steps > 0 ? rows * s / steps : 0), stroke);
+}
+
+// draws a curve onto the display. it starts from CURVE_SAMPLES evenly spaced samples, and then every pass halves the
+// step between the neighbours that are more than a cell apart, with the new samples of a pass evaluated as one batch,
+// until every visible part of the curve is drawn a cell at a time. the samples are then joined by line stepping.
+CDEF c_result draw_curve(pixel **display, c_curve *curve, long double x_steps, long double y_steps) {
+    double start = phase_begin(), seconds_start = now_seconds();
+    c_result result;
+    int components = curve -> polar ? 1 : 2;
+
+    // a malformed component is evaluated once first, so that it reports its error before anything is allocated.
+    if(!curve -> x -> valid) evaluate(curve -> t0, curve -> x, base);
+    if(!curve -> polar && !curve -> y -> valid) evaluate(curve -> t0, curve -> y, base);
+
+    int count = CURVE_SAMPLES, capacity = 2 * CURVE_SAMPLES, passes = 1;
+    c_point *points = (c_point *) malloc(capacity * sizeof(c_point)), *fresh = (c_point *) malloc(capacity * sizeof(c_point));
+    int *after = (int *) malloc(capacity * sizeof(int));
+    long double *buffer = (long double *) malloc(3 * capacity * sizeof(long double));
+    for(int i = 0 ; i < count ; i++)
+        points[i] = (c_point) { curve -> t0 + (curve -> t1 - curve -> t0) * i / (count - 1), 0, 0, 0 };
+
+    progress_total(CURVE_DEPTH + 1);
+    sample_curve(curve, display, x_steps, y_steps, points, count, buffer, buffer + capacity, buffer + 2 * capacity);
+
+    for( ; passes <= CURVE_DEPTH && !progress_advance(1) ; passes++) {
+        // the samples that halve the steps that are too long, each after the sample it follows. steps that can't be
+        // seen aren't halved: both ends undefined, or both off the same side of the display.
+        int added = 0;
+        for(int i = 0 ; i + 1 < count && count + added < CURVE_MAX_SAMPLES ; i++) {
+            c_point *a = &points[i], *b = &points[i + 1];
+            if(a -> depth == CURVE_DEPTH || b -> depth == CURVE_DEPTH || (!point_finite(a) && !point_finite(b)))
+                continue;
+            if(point_finite(a) && point_finite(b) && (cell_distance(a, b) <= 1 || outside_together(a, b)))
+                continue;
+
+            after[added] = i;
+            fresh[added++] = (c_point) { (a -> t + b -> t) / 2, 0, 0, (a -> depth > b -> depth ? a -> depth : b -> depth) + 1 };
+        }
+        if(added == 0)
+            break;
+
+        // the arrays grow to fit every sample of the next pass.
+        if(count + added > capacity) {
+            capacity = 2 * (count + added);
+            points = (c_point *) realloc(points, capacity * sizeof(c_point));
+            fresh = (c_point *) realloc(fresh, capacity * sizeof(c_point));
+            after = (int *) realloc(after, capacity * sizeof(int));
+            buffer = (long double *) realloc(buffer, 3 * capacity * sizeof(long double));
+        }
+        sample_curve(curve, display, x_steps, y_steps, fresh, added, buffer, buffer + capacity, buffer + 2 * capacity);
+
+        // merged from the back, so that nothing is overwritten before it's moved.
+        for(int i = count - 1, k = added - 1, to = count + added - 1 ; k >= 0 ; i--) {
+            if(after[k] == i)
+                points[to--] = fresh[k--];
+            points[to--] = points[i];
+        }
+        count += added;
+    }
+    progress_advance(CURVE_DEPTH + 1 - passes);
+
+    // neighbours that are close enough are joined, the rest are where the curve jumps or leaves the display.
+    for(int i = 0 ; i < count && !canceled() ; i++) {
+        c_point *a = &points[i], *b = i + 1 < count ? &points[i + 1] : NULL;
+        if(!point_finite(a))
+            continue;
+        if(b != NULL && point_finite(b) && cell_distance(a, b) <= CURVE_JUMP)
+            step_line(display, a, b);
+        else if(i == 0 || !point_finite(&points[i - 1]) || cell_distance(&points[i - 1], a) > CURVE_JUMP)
+            plot_cell(display, a -> column, a -> row, '.');
+    }
+
+    free(points);
+    free(fresh);
+    free(after);
+    free(buffer);
+
+    result.samples = count;
+    result.passes = passes;
+    result.evaluations = (long) count * components;
+    result.seconds = now_seconds() - seconds_start;
+    if(instrumenting())
+        instrument_add(calc_instrument.render_evaluations, result.evaluations);
+    phase_end(PHASE_curve, start);
+    return result;
+}
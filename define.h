@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifndef DDEF
+#define DDEF static inline
+#endif
+
+// the longest name a definition (or a function in the function table) can have.
+#ifndef MAX_NAME
+#define MAX_NAME 32
+#endif
+
+// the longest an expression can get once the definitions in it are inlined, which stops definitions that call each
+// other many times over from growing without bound.
+#ifndef MAX_EXPANSION
+#define MAX_EXPANSION 65536
+#endif
+
+// the save file for definitions.
+#ifndef DEFINITIONS_FILE
+#define DEFINITIONS_FILE "definitions.txt"
+#endif
+
+// the words the parser already knows, which definitions can't start with or they'd never be found.
+static const char *reserved_words[] = { "sin", "csc", "cos", "sec", "tan", "cot", "log", "abs", "min", "max", "if", "pi" };
+#define RESERVED_WORDS (int) (sizeof(reserved_words) / sizeof(reserved_words[0]))
+
+// a variable ("a = 3.2") or a function of one parameter ("g(u) = u^2+sin(u)"). the body is kept as text and inlined
+// into the expressions that use it when they are compiled, so using one costs nothing when they are evaluated.
+typedef struct {
+    char name[MAX_NAME + 1];
+    char parameter[MAX_NAME + 1];
+    char *body;
+
+    // the definitions that the body uses, the edges of the dependency graph.
+    int *uses;
+    int use_count;
+} d_definition;
+
+// every definition. removed definitions leave their slot empty, so that the edges to the others stay valid.
+typedef struct {
+    d_definition *entries;
+    int count, capacity;
+    int live;
+} d_table;
+
+// the one set of definitions. like the instrumentation, it is a weak definition so that the library and the program
+// using it share it.
+__attribute__((weak)) d_table calc_definitions;
+
+// an expansion being built.
+typedef struct {
+    char *text;
+    int length, capacity;
+} d_buffer;
+
+// appends text to an expansion, returns false once it would be longer than MAX_EXPANSION.
+DDEF bool buffer_append(d_buffer *buffer, const char *text, int length) {
+    if(buffer -> length + length >= MAX_EXPANSION)
+        return false;
+
+    if(buffer -> length + length + 1 > buffer -> capacity) {
+        while(buffer -> length + length + 1 > buffer -> capacity)
+            buffer -> capacity = buffer -> capacity > 0 ? buffer -> capacity * 2 : 64;
+        buffer -> text = realloc(buffer -> text, buffer -> capacity);
+    }
+    memcpy(buffer -> text + buffer -> length, text, length);
+    buffer -> length += length;
+    buffer -> text[buffer -> length] = '\0';
+    return true;
+}
+
+// returns whether a character can be part of a name.
+DDEF bool name_character(char c) {
+    return isalnum((unsigned char) c) || c == '_';
+}
+
+// returns the length of the reserved word at the start of the text, or 0 if there isn't one.
+DDEF int reserved_length(const char *text) {
+    for(int i = 0 ; i < RESERVED_WORDS ; i++)
+        if(strncmp(text, reserved_words[i], strlen(reserved_words[i])) == 0)
+            return strlen(reserved_words[i]);
+    return 0;
+}
+
+// returns whether a name can be defined: it starts with a letter or '_', only has letters, digits and '_', and
+// isn't x, y, e or p or anything that starts with a word the parser already knows.
+DDEF bool valid_definition_name(const char *name) {
+    int length = strlen(name);
+    if(length == 0 || length > MAX_NAME || !(isalpha((unsigned char) name[0]) || name[0] == '_'))
+        return false;
+    for(int i = 0 ; i < length ; i++)
+        if(!name_character(name[i]))
+            return false;
+
+    return !(length == 1 && strchr("xyep", name[0]) != NULL) && reserved_length(name) == 0;
+}
+
+// returns the slot of the definition with a name, or -1.
+DDEF int definition_find(d_table *table, const char *name) {
+    for(int i = 0 ; i < table -> count ; i++)
+        if(table -> entries[i].body != NULL && strcmp(table -> entries[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+// returns whether a name can end right before the text: the text doesn't go on with a letter or '_', or what it goes
+// on with is a word the parser knows, x, y, e, p, a definition or the parameter. otherwise the name is only the start
+// of a longer token (the way "xa" is in "xabs(x)") and isn't meant.
+DDEF bool name_ends(d_table *table, const char *text, const char *parameter) {
+    if(!isalpha((unsigned char) text[0]) && text[0] != '_')
+        return true;
+    if(reserved_length(text) > 0 || strchr("xyep", text[0]) != NULL)
+        return true;
+    if(parameter != NULL && parameter[0] != '\0' && strncmp(text, parameter, strlen(parameter)) == 0)
+        return true;
+    for(int i = 0 ; i < table -> count ; i++)
+        if(table -> entries[i].body != NULL && strncmp(text, table -> entries[i].name, strlen(table -> entries[i].name)) == 0)
+            return true;
+    return false;
+}
+
+// names in expressions aren't separated from what's around them (the way "2xsin(x)" isn't), so the longest
+// definition (or parameter) that the text starts with, and that ends where something else can start, is the one
+// that's meant. returns its slot, -2 for the parameter, or -1 if there is neither, along with its length.
+DDEF int match_definition(d_table *table, const char *text, const char *parameter, int *length) {
+    int match = -1;
+    *length = 0;
+    for(int i = 0 ; i < table -> count ; i++) {
+        int name_length = strlen(table -> entries[i].name);
+        if(table -> entries[i].body != NULL && name_length > *length && strncmp(text, table -> entries[i].name, name_length) == 0
+            && name_ends(table, text + name_length, parameter)) {
+            match = i;
+            *length = name_length;
+        }
+    }
+
+    int parameter_length = parameter != NULL ? strlen(parameter) : 0;
+    if(parameter_length > 0 && parameter_length >= *length && strncmp(text, parameter, parameter_length) == 0
+        && name_ends(table, text + parameter_length, parameter)) {
+        match = -2;
+        *length = parameter_length;
+    }
+    return match;
+}
+
+// returns the length of the parenthesized argument at the start of the text (with its parentheses), or 0 if the
+// text doesn't start with one or it isn't closed.
+DDEF int argument_length(const char *text) {
+    if(text[0] == '\0' || strchr("([{", text[0]) == NULL)
+        return 0;
+
+    int depth = 0;
+    for(int i = 0 ; text[i] != '\0' ; i++) {
+        if(strchr("([{", text[i]) != NULL) depth++;
+        else if(strchr(")]}", text[i]) != NULL && --depth == 0)
+            return i + 1;
+    }
+    return 0;
+}
+
+// reports an expansion that got too long, returns false.
+DDEF bool expansion_full(char *message, int size) {
+    snprintf(message, size, "the definitions expand to more than %i characters", MAX_EXPANSION);
+    return false;
+}
+
+// appends the text to the expansion with every definition in it inlined: variables become their parenthesized
+// body and calls become their function's parenthesized body with the (inlined) argument in place of the parameter.
+// inside a function's body its parameter is replaced by the argument. returns false with the error in the message.
+DDEF bool expand_text(d_table *table, const char *text, int length, const char *parameter, const char *argument, d_buffer *output, char *message, int size) {
+    for(int i = 0 ; i < length ; ) {
+        int word = reserved_length(text + i), name_length;
+        if(word > 0) {
+            if(!buffer_append(output, text + i, word))
+                return expansion_full(message, size);
+            i += word;
+            continue;
+        }
+
+        int match = isalpha((unsigned char) text[i]) || text[i] == '_' ? match_definition(table, text + i, parameter, &name_length) : -1;
+        if(match == -1) {
+            if(!buffer_append(output, text + i, 1))
+                return expansion_full(message, size);
+            i++;
+            continue;
+        }
+
+        if(match == -2) {
+            if(!buffer_append(output, "(", 1) || !buffer_append(output, argument, strlen(argument)) || !buffer_append(output, ")", 1))
+                return expansion_full(message, size);
+            i += name_length;
+            continue;
+        }
+
+        d_definition *definition = &table -> entries[match];
+        i += name_length;
+        if(definition -> parameter[0] == '\0') {
+            if(!buffer_append(output, "(", 1))
+                return expansion_full(message, size);
+            if(!expand_text(table, definition -> body, strlen(definition -> body), NULL, NULL, output, message, size))
+                return false;
+            if(!buffer_append(output, ")", 1))
+                return expansion_full(message, size);
+            continue;
+        }
+
+        // the argument is inlined where the call is, so that it sees the caller's parameter rather than the callee's.
+        int call = argument_length(text + i);
+        if(call == 0 || i + call > length) {
+            snprintf(message, size, "%s takes an argument, as in %s(x)", definition -> name, definition -> name);
+            return false;
+        }
+
+        d_buffer inlined = { NULL, 0, 0 };
+        buffer_append(&inlined, "", 0);
+        bool expanded = expand_text(table, text + i + 1, call - 2, parameter, argument, &inlined, message, size);
+        if(expanded && !buffer_append(output, "(", 1))
+            expanded = expansion_full(message, size);
+        if(expanded)
+            expanded = expand_text(table, definition -> body, strlen(definition -> body), definition -> parameter, inlined.text, output, message, size);
+        if(expanded && !buffer_append(output, ")", 1))
+            expanded = expansion_full(message, size);
+        free(inlined.text);
+        if(!expanded)
+            return false;
+        i += call;
+    }
+    return true;
+}
+
+// returns the text with every definition in it inlined (which the caller frees), or NULL with the error in the
+// message. when there are no definitions the text is returned as it is, without a copy.
+DDEF char *expand_definitions(d_table *table, char *text, char *message, int size) {
+    if(table -> live == 0)
+        return text;
+
+    d_buffer output = { NULL, 0, 0 };
+    if(!buffer_append(&output, "", 0) || !expand_text(table, text, strlen(text), NULL, NULL, &output, message, size)) {
+        free(output.text);
+        return NULL;
+    }
+    return output.text;
+}
+
+// marks the definitions that a text uses directly, returns how many it uses.
+DDEF int text_uses(d_table *table, const char *text, const char *parameter, bool *used) {
+    int count = 0, length;
+    for(int i = 0 ; text[i] != '\0' ; ) {
+        int word = reserved_length(text + i);
+        int match = word == 0 && (isalpha((unsigned char) text[i]) || text[i] == '_') ? match_definition(table, text + i, parameter, &length) : -1;
+        if(match >= 0 && !used[match]) {
+            used[match] = true;
+            count++;
+        }
+        i += word > 0 ? word : match != -1 ? length : 1;
+    }
+    return count;
+}
+
+// marks a definition and every definition that depends on it, directly or through others.
+DDEF void definitions_affected(d_table *table, int slot, bool *affected) {
+    memset(affected, 0, table -> count * sizeof(bool));
+    affected[slot] = true;
+    for(bool changed = true ; changed ; ) {
+        changed = false;
+        for(int i = 0 ; i < table -> count ; i++) {
+            d_definition *definition = &table -> entries[i];
+            for(int k = 0 ; definition -> body != NULL && !affected[i] && k < definition -> use_count ; k++)
+                if(affected[definition -> uses[k]])
+                    affected[i] = changed = true;
+        }
+    }
+}
+
+// returns whether a text uses any of the marked definitions.
+DDEF bool text_depends(d_table *table, const char *text, bool *marked) {
+    bool *used = calloc(table -> count + 1, sizeof(bool));
+    text_uses(table, text, NULL, used);
+
+    bool depends = false;
+    for(int i = 0 ; i < table -> count && !depends ; i++)
+        depends = used[i] && marked[i];
+    free(used);
+    return depends;
+}
+
+// a definition as it was before it was replaced, so that the replacement can be undone.
+typedef struct {
+    int slot;
+    bool existed;
+    d_definition definition;
+} d_previous;
+
+// the bytes a definition holds besides its slot, which is what it's accounted for.
+DDEF long definition_bytes(d_definition *definition) {
+    return strlen(definition -> body) + 1 + (definition -> use_count + 1) * sizeof(int);
+}
+
+// works out the edges of every definition again. a name that comes or goes can change what the others use, since
+// definitions loaded from a file can use ones that come after them, and names are matched longest first.
+// definitions that are still being set (without edges yet) are left alone.
+DDEF void definitions_link(d_table *table) {
+    bool *used = malloc((table -> count + 1) * sizeof(bool));
+    for(int i = 0 ; i < table -> count ; i++) {
+        d_definition *definition = &table -> entries[i];
+        if(definition -> body == NULL || definition -> uses == NULL)
+            continue;
+
+        memset(used, 0, (table -> count + 1) * sizeof(bool));
+        text_uses(table, definition -> body, definition -> parameter[0] != '\0' ? definition -> parameter : NULL, used);
+        memory_release(MEMORY_definitions, definition_bytes(definition));
+        definition -> uses = realloc(definition -> uses, (table -> count + 1) * sizeof(int));
+        definition -> use_count = 0;
+        for(int k = 0 ; k < table -> count ; k++)
+            if(used[k]) definition -> uses[definition -> use_count++] = k;
+        memory_acquire(MEMORY_definitions, definition_bytes(definition));
+    }
+    free(used);
+}
+
+// adds a definition, or replaces the one with the same name, and returns its slot. a definition can't use itself,
+// directly or through others, since inlining it would never end. returns -1 with the error in the message if it does.
+DDEF int definition_set(d_table *table, const char *name, const char *parameter, const char *body, d_previous *previous, char *message, int size) {
+    int slot = definition_find(table, name);
+    if(slot < 0) {
+        for(slot = 0 ; slot < table -> count && table -> entries[slot].body != NULL ; slot++);
+        if(slot == table -> count) {
+            if(table -> count == table -> capacity) {
+                table -> capacity = table -> capacity > 0 ? table -> capacity * 2 : 16;
+                table -> entries = realloc(table -> entries, table -> capacity * sizeof(d_definition));
+            }
+            table -> count++;
+        }
+        memset(&table -> entries[slot], 0, sizeof(d_definition));
+        snprintf(table -> entries[slot].name, sizeof(table -> entries[slot].name), "%s", name);
+    }
+
+    // a new definition is found by its own name while its body is looked through, so that it can't use itself.
+    d_definition *definition = &table -> entries[slot];
+    bool existed = definition -> body != NULL;
+    if(!existed)
+        definition -> body = "";
+    definitions_link(table);
+
+    bool *used = calloc(table -> count, sizeof(bool));
+    text_uses(table, body, parameter, used);
+
+    // the body can't use anything that depends on the definition.
+    bool *dependents = calloc(table -> count, sizeof(bool));
+    definitions_affected(table, slot, dependents);
+    if(!existed)
+        definition -> body = NULL;
+
+    for(int i = 0 ; i < table -> count ; i++)
+        if(used[i] && dependents[i]) {
+            snprintf(message, size, "%s can't be defined in terms of itself%s%s", name, i != slot ? ", through " : "", i != slot ? table -> entries[i].name : "");
+            if(!existed)
+                memset(definition -> name, 0, sizeof(definition -> name));
+            definitions_link(table);
+            free(used);
+            free(dependents);
+            return -1;
+        }
+    free(dependents);
+
+    previous -> slot = slot;
+    previous -> existed = existed;
+    previous -> definition = *definition;
+    if(!existed)
+        table -> live++;
+
+    snprintf(definition -> parameter, sizeof(definition -> parameter), "%s", parameter != NULL ? parameter : "");
+    definition -> body = strdup(body);
+    definition -> uses = malloc((table -> count + 1) * sizeof(int));
+    definition -> use_count = 0;
+    for(int i = 0 ; i < table -> count ; i++)
+        if(used[i]) definition -> uses[definition -> use_count++] = i;
+    free(used);
+    memory_acquire(MEMORY_definitions, definition_bytes(definition));
+    return slot;
+}
+
+// undoes the last definition_set().
+DDEF void definition_restore(d_table *table, d_previous *previous) {
+    d_definition *definition = &table -> entries[previous -> slot];
+    memory_release(MEMORY_definitions, definition_bytes(definition));
+    free(definition -> body);
+    free(definition -> uses);
+    if(previous -> existed) *definition = previous -> definition;
+    else {
+        memset(definition, 0, sizeof(d_definition));
+        table -> live--;
+    }
+    definitions_link(table);
+}
+
+// lets go of the definition that definition_set() replaced, once the replacement is kept.
+DDEF void definition_forget(d_previous *previous) {
+    if(previous -> existed) {
+        memory_release(MEMORY_definitions, definition_bytes(&previous -> definition));
+        free(previous -> definition.body);
+        free(previous -> definition.uses);
+    }
+}
+
+// removes a definition, returns false if another definition uses it.
+DDEF bool definition_remove(d_table *table, int slot) {
+    for(int i = 0 ; i < table -> count ; i++)
+        for(int k = 0 ; table -> entries[i].body != NULL && i != slot && k < table -> entries[i].use_count ; k++)
+            if(table -> entries[i].uses[k] == slot)
+                return false;
+
+    memory_release(MEMORY_definitions, definition_bytes(&table -> entries[slot]));
+    free(table -> entries[slot].body);
+    free(table -> entries[slot].uses);
+    memset(&table -> entries[slot], 0, sizeof(d_definition));
+    table -> live--;
+    definitions_link(table);
+    return true;
+}
+
+// splits a "name = body" or "name(parameter) = body" definition, returns false if the text isn't one. the parts
+// point into the text, which is changed to end them.
+DDEF bool split_function_definition(char *text, char **name, char **parameter, char **body) {
+    char *equals = strchr(text, '=');
+    if(equals == NULL || equals[1] == '=' || (equals > text && strchr("<>!=", equals[-1]) != NULL))
+        return false;
+
+    char *start = text, *end = equals;
+    while(isspace((unsigned char) *start)) start++;
+    while(end > start && isspace((unsigned char) end[-1])) end--;
+
+    // the parameter is whatever is between the parentheses after the name.
+    *parameter = NULL;
+    char *open = memchr(start, '(', end - start);
+    if(open != NULL) {
+        if(end[-1] != ')')
+            return false;
+        end[-1] = '\0';
+        *parameter = open + 1;
+        while(isspace((unsigned char) **parameter)) (*parameter)++;
+        for(char *last = end - 2 ; last >= *parameter && isspace((unsigned char) *last) ; last--) *last = '\0';
+        end = open;
+        while(end > start && isspace((unsigned char) end[-1])) end--;
+    }
+    *end = '\0';
+    *name = start;
+
+    *body = equals + 1;
+    while(isspace((unsigned char) **body)) (*body)++;
+    (*body)[strcspn(*body, "\r\n")] = '\0';
+    return true;
+}
+
+// writes a definition the way it's typed.
+DDEF void write_definition(d_definition *definition, FILE *file) {
+    if(definition -> parameter[0] != '\0')
+        fprintf(file, "%s(%s) = %s\n", definition -> name, definition -> parameter, definition -> body);
+    else fprintf(file, "%s = %s\n", definition -> name, definition -> body);
+}
@@ -0,0 +1,420 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <setjmp.h>
+
+#ifndef FDEF
+#define FDEF static inline
+#endif
+
+// the longest name a function in the function table can have.
+#ifndef MAX_NAME
+#define MAX_NAME 32
+#endif
+
+// the amount of slots a new function table starts with, it doubles whenever it fills up.
+#ifndef TABLE_CAPACITY
+#define TABLE_CAPACITY 16
+#endif
+
+// a slot in the function table, slots of removed functions stay empty so that the other indices don't change.
+// unsaved marks a function that was added or changed in the calculator and isn't in the function file yet.
+typedef struct {
+    char *name;
+    p_data *data;
+    int next;
+    bool unsaved;
+} f_entry;
+
+// the function table. functions are found by index through the slots and by name through a chained hash table
+// over the slots, so both lookups take the same time no matter how many functions there are.
+typedef struct {
+    f_entry *entries;
+    int size, capacity;
+    int live;
+    int first_free;
+    int *buckets;
+    unsigned int bucket_mask;
+} f_table;
+
+// the hash of a function name.
+FDEF unsigned int hash_name(const char *name) {
+    unsigned int hash = 5381;
+    for( ; *name != '\0' ; name++)
+        hash = hash * 33 + (unsigned char) *name;
+    return hash;
+}
+
+// returns whether a string can be used as a function name: a letter or '_' followed by letters, digits and '_'.
+FDEF bool valid_name(const char *name) {
+    if(name == NULL || !(isalpha(name[0]) || name[0] == '_') || strlen(name) > MAX_NAME)
+        return false;
+
+    for(int i = 1 ; name[i] != '\0' ; i++)
+        if(!isalnum(name[i]) && name[i] != '_')
+            return false;
+    return true;
+}
+
+// links every function into the hash table, after the slots moved.
+FDEF void rehash_table(f_table *table) {
+    unsigned int bucket_count = 1;
+    while(bucket_count < (unsigned int) table -> capacity * 2)
+        bucket_count *= 2;
+
+    free(table -> buckets);
+    table -> buckets = malloc(bucket_count * sizeof(int));
+    table -> bucket_mask = bucket_count - 1;
+    for(unsigned int i = 0 ; i < bucket_count ; i++)
+        table -> buckets[i] = -1;
+
+    for(int i = 0 ; i < table -> size ; i++) {
+        if(table -> entries[i].data == NULL)
+            continue;
+
+        unsigned int bucket = hash_name(table -> entries[i].name) & table -> bucket_mask;
+        table -> entries[i].next = table -> buckets[bucket];
+        table -> buckets[bucket] = i;
+    }
+}
+
+// returns an empty function table.
+FDEF f_table *ftable_new() {
+    f_table *table = calloc(1, sizeof(f_table));
+    table -> capacity = TABLE_CAPACITY;
+    table -> entries = calloc(table -> capacity, sizeof(f_entry));
+    rehash_table(table);
+    return table;
+}
+
+// returns the slot of the function with the given name, or -1 if there isn't one.
+FDEF int ftable_named(f_table *table, const char *name) {
+    for(int i = table -> buckets[hash_name(name) & table -> bucket_mask] ; i >= 0 ; i = table -> entries[i].next)
+        if(strcmp(table -> entries[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+// returns the slot of a function given by its index (starting at 1) or its name, or -1 if there isn't one.
+FDEF int ftable_find(f_table *table, const char *key) {
+    if(key == NULL || key[0] == '\0')
+        return -1;
+
+    if(strspn(key, "0123456789") == strlen(key)) {
+        long index = atol(key) - 1;
+        if(index < 0 || index >= table -> size || table -> entries[index].data == NULL)
+            return -1;
+        return (int) index;
+    }
+    return ftable_named(table, key);
+}
+
+// returns the slot of the next function after the given slot (or the first function for -1), or -1 at the end.
+FDEF int ftable_next(f_table *table, int slot) {
+    for(slot++ ; slot < table -> size ; slot++)
+        if(table -> entries[slot].data != NULL)
+            return slot;
+    return -1;
+}
+
+// empties a slot and frees its function.
+FDEF void ftable_remove(f_table *table, int slot) {
+    if(slot < 0 || slot >= table -> size || table -> entries[slot].data == NULL)
+        return;
+
+    f_entry *entry = &table -> entries[slot];
+    int *link = &table -> buckets[hash_name(entry -> name) & table -> bucket_mask];
+    while(*link != slot)
+        link = &table -> entries[*link].next;
+    *link = entry -> next;
+
+    destroy_data(entry -> data);
+    free(entry -> name);
+    memset(entry, 0, sizeof(f_entry));
+    table -> live--;
+
+    if(slot < table -> first_free)
+        table -> first_free = slot;
+    while(table -> size > 0 && table -> entries[table -> size - 1].data == NULL)
+        table -> size--;
+}
+
+// stores a compiled function in a given slot, which has to be empty. an unnamed function is named after its index
+// (f1, f2, ...). the table owns the function from then on.
+FDEF void ftable_insert(f_table *table, int slot, const char *name, p_data *data) {
+    if(slot >= table -> capacity) {
+        int capacity = table -> capacity;
+        while(slot >= table -> capacity)
+            table -> capacity *= 2;
+        table -> entries = realloc(table -> entries, table -> capacity * sizeof(f_entry));
+        memset(table -> entries + capacity, 0, (table -> capacity - capacity) * sizeof(f_entry));
+        rehash_table(table);
+    }
+    if(slot >= table -> size)
+        table -> size = slot + 1;
+    if(slot == table -> first_free)
+        table -> first_free = slot + 1;
+
+    char generated[MAX_NAME + 16];
+    if(name == NULL) {
+        snprintf(generated, sizeof(generated), "f%i", slot + 1);
+        for(int suffix = 2 ; ftable_named(table, generated) >= 0 ; suffix++)
+            snprintf(generated, sizeof(generated), "f%i_%i", slot + 1, suffix);
+        name = generated;
+    }
+
+    f_entry *entry = &table -> entries[slot];
+    entry -> name = strdup(name);
+    entry -> data = data;
+    entry -> unsaved = false;
+
+    unsigned int bucket = hash_name(name) & table -> bucket_mask;
+    entry -> next = table -> buckets[bucket];
+    table -> buckets[bucket] = slot;
+    table -> live++;
+}
+
+// stores a compiled function under a name, replacing the function that already has the name, or in the first empty
+// slot. returns the slot.
+FDEF int ftable_set(f_table *table, const char *name, p_data *data) {
+    int slot = name != NULL ? ftable_named(table, name) : -1;
+    if(slot >= 0) {
+        destroy_data(table -> entries[slot].data);
+        table -> entries[slot].data = data;
+        return slot;
+    }
+
+    // no slot below first_free is empty, so the search for the first empty slot starts there.
+    slot = table -> first_free;
+    while(slot < table -> size && table -> entries[slot].data != NULL)
+        slot++;
+    table -> first_free = slot;
+
+    ftable_insert(table, slot, name, data);
+    return slot;
+}
+
+// removes and frees every function.
+FDEF void ftable_clear(f_table *table) {
+    for(int i = table -> size - 1 ; i >= 0 ; i--)
+        ftable_remove(table, i);
+    table -> size = 0;
+    table -> first_free = 0;
+}
+
+// frees the function table along with its functions.
+FDEF void ftable_free(f_table *table) {
+    ftable_clear(table);
+    free(table -> entries);
+    free(table -> buckets);
+    free(table);
+}
+
+// gathers the functions given by their names or indices (or every function, if there are no keys) into the
+// output, in order. returns the amount of functions, or -1 if one of the keys isn't in the table.
+FDEF int ftable_select(f_table *table, char **keys, int key_count, p_data **output, int *slots) {
+    int count = 0;
+    if(key_count == 0) {
+        for(int i = 0 ; i < table -> size ; i++)
+            if(table -> entries[i].data != NULL) {
+                if(slots != NULL) slots[count] = i;
+                output[count++] = table -> entries[i].data;
+            }
+        return count;
+    }
+
+    for(int i = 0 ; i < key_count ; i++) {
+        int slot = ftable_find(table, keys[i]);
+        if(slot < 0)
+            return -1;
+        if(slots != NULL) slots[count] = slot;
+        output[count++] = table -> entries[slot].data;
+    }
+    return count;
+}
+
+// compiles an expression, returning NULL (with the error in error_message) instead of ending the program if it
+// can't be compiled. a profiled expression is compiled as it was written, see p_data.
+FDEF p_data *compile_expression(const char *text, bool profiled) {
+    jmp_buf handler, *volatile previous = error_handler;
+    p_data *volatile data = calloc(1, sizeof(p_data));
+    data -> profiled = profiled;
+
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        destroy_data(data);
+        return NULL;
+    }
+
+    data -> input = eat_whitespace((char *) text, strlen(text));
+    if(strlen(data -> input) == 0)
+        throw_error("missing expression");
+    compile(data);
+
+    error_handler = previous;
+    return data;
+}
+
+FDEF p_data *compile_function(const char *text) {
+    return compile_expression(text, false);
+}
+
+// splits a "name = expression" definition into its name and expression, the name is NULL when there is no '='.
+// returns false if the name isn't a valid name.
+FDEF bool split_definition(char *definition, char **name, char **expression) {
+    // the '=' of a comparison (==, <=, >=, !=) isn't the one that ends the name.
+    char *equals = definition;
+    while((equals = strchr(equals, '=')) != NULL && (equals[1] == '=' || (equals > definition && strchr("<>!=", equals[-1]) != NULL)))
+        equals += equals[1] == '=' ? 2 : 1;
+    *name = NULL;
+    *expression = definition;
+    if(equals == NULL)
+        return true;
+
+    *equals = '\0';
+    *expression = equals + 1;
+
+    // the name is trimmed of surrounding whitespace.
+    char *start = definition, *end = equals;
+    while(isspace(*start)) start++;
+    while(end > start && isspace(end[-1])) end--;
+    *end = '\0';
+    *name = start;
+    return valid_name(start);
+}
+
+// reads functions from a file with a "name = expression" (or just "expression") per line into the table. lines
+// that can't be compiled are reported and skipped. returns the amount of functions that were read.
+FDEF int ftable_read(f_table *table, FILE *file) {
+    char line[MAX_LENGTH];
+    int count = 0, line_number = 0;
+    while(fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if(strspn(line, " \t") == strlen(line))
+            continue;
+
+        char *name, *expression;
+        if(!split_definition(line, &name, &expression)) {
+            fprintf(stderr, "ERROR: line %i of the function file has an invalid name.\n", line_number);
+            continue;
+        }
+
+        p_data *data = compile_function(expression);
+        if(data == NULL) {
+            fprintf(stderr, "ERROR: line %i of the function file: %s\n", line_number, error_message);
+            continue;
+        }
+        ftable_set(table, name, data);
+        count++;
+    }
+    return count;
+}
+
+// what reloading the function table changed, unsaved counts the functions kept because they aren't saved yet.
+typedef struct {
+    int kept, compiled, removed, failed, unsaved;
+} f_reload;
+
+// brings the table in line with a function file that changed. functions whose text is the same as before keep their
+// compiled programs (and their indices), only new or changed functions are compiled, and functions that are no
+// longer in the file are removed. functions that fail to compile keep their previous version, and functions that
+// were added or changed in the calculator since the file was saved are kept as they are, so that they aren't lost.
+FDEF f_reload ftable_reload(f_table *table, FILE *file) {
+    f_reload result = { 0, 0, 0, 0, 0 };
+    int seen_size = table -> capacity;
+    bool *seen = calloc(seen_size, sizeof(bool));
+
+    char line[MAX_LENGTH];
+    int line_number = 0;
+    while(fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if(strspn(line, " \t") == strlen(line))
+            continue;
+
+        char *name, *expression;
+        if(!split_definition(line, &name, &expression)) {
+            fprintf(stderr, "ERROR: line %i of the function file has an invalid name.\n", line_number);
+            result.failed++;
+            continue;
+        }
+
+        // named functions are matched by name, unnamed ones by their text.
+        char *text = eat_whitespace(expression, strlen(expression));
+        int slot = -1;
+        if(name != NULL)
+            slot = ftable_named(table, name);
+        else for(int i = ftable_next(table, -1) ; i >= 0 && slot < 0 ; i = ftable_next(table, i))
+            if(i < seen_size && !seen[i] && strcmp(table -> entries[i].data -> input, text) == 0)
+                slot = i;
+
+        if(slot >= 0 && strcmp(table -> entries[slot].data -> input, text) == 0) {
+            table -> entries[slot].unsaved = false;
+            result.kept++;
+        } else if(slot >= 0 && table -> entries[slot].unsaved) {
+            result.unsaved++;
+        } else {
+            p_data *data = compile_function(text);
+            if(data == NULL) {
+                fprintf(stderr, "ERROR: line %i of the function file: %s\n", line_number, error_message);
+                result.failed++;
+            } else {
+                slot = ftable_set(table, name, data);
+                result.compiled++;
+            }
+        }
+        free(text);
+
+        if(slot >= seen_size) {
+            seen = realloc(seen, table -> capacity * sizeof(bool));
+            memset(seen + seen_size, 0, (table -> capacity - seen_size) * sizeof(bool));
+            seen_size = table -> capacity;
+        }
+        if(slot >= 0)
+            seen[slot] = true;
+    }
+
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i))
+        if((i >= seen_size || !seen[i]) && table -> entries[i].unsaved) {
+            result.unsaved++;
+        } else if(i >= seen_size || !seen[i]) {
+            ftable_remove(table, i);
+            result.removed++;
+        }
+    free(seen);
+    return result;
+}
+
+// compiles the functions that use any of the marked definitions again, after the definitions changed. the others
+// keep their programs, and functions that no longer compile keep their previous version.
+FDEF f_reload ftable_recompile(f_table *table, d_table *definitions, bool *marked) {
+    f_reload result = { 0, 0, 0, 0, 0 };
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i)) {
+        f_entry *entry = &table -> entries[i];
+        if(!text_depends(definitions, entry -> data -> input, marked)) {
+            result.kept++;
+            continue;
+        }
+
+        p_data *data = compile_function(entry -> data -> input);
+        if(data == NULL) {
+            result.failed++;
+            continue;
+        }
+        destroy_data(entry -> data);
+        entry -> data = data;
+        result.compiled++;
+    }
+    return result;
+}
+
+// writes every function in the table as a "name = expression" line.
+FDEF void ftable_write(f_table *table, FILE *file) {
+    for(int i = 0 ; i < table -> size ; i++)
+        if(table -> entries[i].data != NULL)
+            fprintf(file, "%s = %s\n", table -> entries[i].name, table -> entries[i].data -> input);
+}
@@ -12,18 +12,27 @@
 #define WINDOW_WIDTH (long double) 200
 #define WINDOW_HEIGHT (long double) 100
 
+// the stride of the first pass of a progressive render, every pass after it halves it.
+#ifndef PROGRESSIVE_STRIDE
+#define PROGRESSIVE_STRIDE 8
+#endif
+
 typedef struct { long double x, y; char display; } pixel;
 
 long double base = 10;
 
 // return whether or not a value is close to another value based off of a certain deviation.
-bool close_to(long double x, long double y, long double deviation) { return fabsl(x-y) < deviation; }
+GDEF bool close_to(long double x, long double y, long double deviation) { return fabsl(x-y) < deviation; }
+
+// the bytes a display holds.
+#define DISPLAY_BYTES (long) (WINDOW_HEIGHT * (sizeof(pixel *) + WINDOW_WIDTH * sizeof(pixel)))
 
 GDEF pixel **initialize_display() {
     // initialize display as multidimensional array of pixels.
     pixel **display = (pixel **) calloc(WINDOW_HEIGHT, sizeof(pixel *));
     for(int i = 0; i < WINDOW_HEIGHT; i++)
         display[i] = (pixel *) calloc(WINDOW_WIDTH, sizeof(pixel));
+    memory_acquire(MEMORY_displays, DISPLAY_BYTES);
     return display;
 }
 
@@ -42,7 +51,7 @@ GDEF pixel **quantify_plane(long double x_steps, long double y_steps, long doubl
 }
 
 // returns a different ascii character based on how close a value is to the end of a range of values.
-char ycompress(long double num, long double pixel, long double range) {
+GDEF char ycompress(long double num, long double pixel, long double range) {
     char *table = "_,.-~*'`";
 
     // splits the pixel's height by 1/8
@@ -58,9 +67,10 @@ char ycompress(long double num, long double pixel, long double range) {
     return table[counter - 1];
 }
 
-// prints the display.
-GDEF void print_plane(pixel **display) {
-    char **output = malloc(sizeof(char*) * WINDOW_HEIGHT + 1);
+// prints the display to the output.
+GDEF void print_plane(pixel **display, FILE *file) {
+    double start = phase_begin();
+    char **output = malloc(sizeof(char*) * WINDOW_HEIGHT);
     for(int i = 0; i < WINDOW_HEIGHT; i++)
         output[i] = malloc(sizeof(char) * WINDOW_WIDTH + 1);
 
@@ -71,28 +81,32 @@ GDEF void print_plane(pixel **display) {
         output[y][(int)WINDOW_WIDTH] = '\0';
     }
 
-    for(int y = 0; y < WINDOW_HEIGHT; y++)
-        puts(output[y]);
+    for(int y = 0; y < WINDOW_HEIGHT; y++) {
+        fputs(output[y], file);
+        fputc('\n', file);
+    }
 
-    for(int i = 0; i <= WINDOW_HEIGHT; i++)
+    for(int i = 0; i < WINDOW_HEIGHT; i++)
         free(output[i]);
     free(output);
+    phase_end(PHASE_print_plane, start);
 }
 
 // graphs the line and shades under the curve between the given bounds.
 GDEF void shade_graph(pixel **display, p_data **data, long double x_steps, long double y_steps, int function_index, long double left_bound, long double right_bound) {
     long double rel_x, rel_y;
+    if(strlen(data[function_index] -> input) == 0)
+        return;
 
-    for(int y = 0 ; y < WINDOW_HEIGHT ; y++) {
+    double start = phase_begin();
+    progress_total(WINDOW_HEIGHT);
+    for(int y = 0 ; y < WINDOW_HEIGHT && !progress_advance(1) ; y++) {
         for(int x = 0 ; x < WINDOW_WIDTH ; x++) {
             pixel *pixel = &display[y][x];
 
             rel_x = pixel -> x;
             rel_y = pixel -> y;
 
-            if(strlen(data[function_index] -> input) == 0)
-                return;
-
             long double output = evaluate(rel_x, data[function_index], base);
             if(close_to(output, rel_y, y_steps/2.1))
                 pixel -> display = ycompress(output, rel_y, y_steps);
@@ -100,35 +114,66 @@ GDEF void shade_graph(pixel **display, p_data **data, long double x_steps, long
                 pixel -> display = '#';
         }
     }
+
+    if(instrumenting())
+        instrument_add(calc_instrument.render_evaluations, (long) (WINDOW_WIDTH * WINDOW_HEIGHT));
+    phase_end(PHASE_shade_graph, start);
 }
 
-GDEF void draw_line(pixel **display, p_data **data, long double x_steps, long double y_steps, long double (*eval)(long double, p_data *, long double), int function_count) {
-    long double rel_x, rel_y;
+// marks the pixels of a column, in the first height rows of the display, that are close enough to a function's output
+// there.
+GDEF void plot_rows(pixel **display, int height, int x, long double output, long double y_steps) {
+    if(!isfinite(output))
+        return;
 
-    for(int y = 0 ; y < WINDOW_HEIGHT ; y++) {
-        for(int x = 0 ; x < WINDOW_WIDTH ; x++) {
-            pixel *pixel = &display[y][x];
-            rel_x = pixel -> x;
-            rel_y = pixel -> y;
+    // only the rows next to the one that the output falls in can be close enough to it.
+    long double row = roundl((display[0][x].y - output) / y_steps);
+    if(row < -1 || row > height)
+        return;
 
+    for(int y = (int) row - 1 ; y <= (int) row + 1 ; y++) {
+        if(y < 0 || y >= height)
+            continue;
 
-            long double output;
-            for(int i = 0 ; i < function_count ; i++) {
-                if(strlen(data[i] -> input) == 0)
-                    continue;
-                output = eval(rel_x, data[i], base);
-                if(close_to(output, rel_y, y_steps/2.1))
-                    pixel -> display = ycompress(output, rel_y, y_steps);
-            }
+        pixel *pixel = &display[y][x];
+        if(close_to(output, pixel -> y, y_steps/2.1))
+            pixel -> display = ycompress(output, pixel -> y, y_steps);
+    }
+}
 
-        }
+GDEF void plot_column(pixel **display, int x, long double output, long double y_steps) {
+    plot_rows(display, WINDOW_HEIGHT, x, output, y_steps);
+}
+
+GDEF void draw_line(pixel **display, p_data **data, long double x_steps, long double y_steps, long double (*eval)(long double, p_data *, long double), int function_count) {
+    // every pixel in a column has the same x, so each function is evaluated once per column instead of once per pixel.
+    long double *outputs = malloc(WINDOW_WIDTH * sizeof(long double));
+    double start = phase_begin();
+    long evaluations = 0;
+
+    progress_total(function_count);
+    for(int i = 0 ; i < function_count && !progress_advance(1) ; i++) {
+        if(strlen(data[i] -> input) == 0)
+            continue;
+
+        evaluations += WINDOW_WIDTH;
+        for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+            outputs[x] = eval(display[0][x].x, data[i], base);
+
+        for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+            plot_column(display, x, outputs[x], y_steps);
     }
+    free(outputs);
+
+    if(instrumenting())
+        instrument_add(calc_instrument.render_evaluations, evaluations);
+    phase_end(PHASE_draw_line, start);
 }
 
-// sets the display of every pixel to the correct ascii character.
-GDEF void draw_plane(pixel **display, long double x_steps, long double y_steps) {
+// sets the display of every pixel in the first height rows of the display to the correct ascii character.
+GDEF void draw_rows(pixel **display, int height, long double x_steps, long double y_steps) {
     long double rel_x, rel_y;
-    for(int y = 0; y < WINDOW_HEIGHT; y++) {
+    for(int y = 0; y < height; y++) {
         for(int x = 0; x < WINDOW_WIDTH; x++) {
             pixel *pixel = &display[y][x];
             rel_x = pixel -> x;
@@ -150,10 +195,98 @@ GDEF void draw_plane(pixel **display, long double x_steps, long double y_steps)
     }
 }
 
+GDEF void draw_plane(pixel **display, long double x_steps, long double y_steps) {
+    double start = phase_begin();
+    draw_rows(display, WINDOW_HEIGHT, x_steps, y_steps);
+    phase_end(PHASE_draw_plane, start);
+}
+
 
+// how long a progressive render took to its first frame and to its last, in seconds, and its evaluations.
+typedef struct {
+    double first, final;
+    long evaluations;
+    int frames;
+} g_progressive;
+
+// draws the functions like draw_line(), a frame at a time from coarse to fine. the first pass evaluates every
+// PROGRESSIVE_STRIDE-th column, and every pass after it evaluates the columns halfway between the ones before, so
+// that the last frame has taken as many evaluations as draw_line() would have. the columns in between the ones that
+// were evaluated are drawn from a line between their neighbours. frame(), unless it's NULL, is called with the display
+// and the stride as soon as each frame is drawn.
+GDEF g_progressive draw_progressive(pixel **display, p_data **data, long double x_steps, long double y_steps, long double (*eval)(long double, p_data *, long double),
+    int function_count, void (*frame)(pixel **display, int stride, void *argument), void *argument) {
+    long double *outputs = malloc(function_count * WINDOW_WIDTH * sizeof(long double));
+    double start = phase_begin(), seconds_start = instrument_now();
+    g_progressive result = { 0, 0, 0, 0 };
+    int width = WINDOW_WIDTH;
+
+    int passes = 0;
+    for(int stride = PROGRESSIVE_STRIDE ; stride >= 1 ; stride /= 2)
+        passes++;
+    progress_total((long) passes * function_count);
+
+    for(int stride = PROGRESSIVE_STRIDE ; stride >= 1 && !canceled() ; stride /= 2) {
+        for(int i = 0 ; i < function_count && !progress_advance(1) ; i++) {
+            if(strlen(data[i] -> input) == 0)
+                continue;
+
+            // the columns of the passes before this one are already known.
+            long double *output = outputs + (size_t) i * width;
+            for(int x = 0 ; x < width ; x += stride)
+                if(stride == PROGRESSIVE_STRIDE || x % (2 * stride) != 0) {
+                    output[x] = eval(display[0][x].x, data[i], base);
+                    result.evaluations++;
+                }
+        }
+        if(canceled())
+            break;
+
+        draw_plane(display, x_steps, y_steps);
+        for(int i = 0 ; i < function_count ; i++) {
+            if(strlen(data[i] -> input) == 0)
+                continue;
+
+            long double *output = outputs + (size_t) i * width;
+            for(int x = 0 ; x < width ; x++) {
+                int left = x - x % stride, right = left + stride;
+                long double value = output[left];
+                if(x != left && right < width && isfinite(value) && isfinite(output[right]))
+                    value += (output[right] - value) * (x - left) / stride;
+                plot_column(display, x, value, y_steps);
+            }
+        }
+
+        if(frame != NULL)
+            frame(display, stride, argument);
+        result.frames++;
+        result.final = (instrument_now() - seconds_start) * 1e-6;
+        if(result.frames == 1)
+            result.first = result.final;
+    }
+    free(outputs);
+
+    if(instrumenting())
+        instrument_add(calc_instrument.render_evaluations, result.evaluations);
+    phase_end(PHASE_draw_line, start);
+    return result;
+}
+
+// marks points on the display with an 'o', points outside of the window are skipped.
+GDEF void mark_points(pixel **display, long double *xvalues, long double *yvalues, int count, long double x_steps, long double y_steps) {
+    for(int i = 0 ; i < count ; i++) {
+        int x = (int) roundl((xvalues[i] - display[0][0].x) / x_steps);
+        int y = (int) roundl((display[0][0].y - yvalues[i]) / y_steps);
+
+        if(x >= 0 && x < WINDOW_WIDTH && y >= 0 && y < WINDOW_HEIGHT)
+            display[y][x].display = 'o';
+    }
+}
 
+// frees a display made by initialize_display().
 GDEF void clear_display(pixel **display) {
     for(int i = 0; i < WINDOW_HEIGHT; i++)
         free(display[i]);
     free(display);
+    memory_release(MEMORY_displays, DISPLAY_BYTES);
 }
@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#ifndef ZDEF
+#define ZDEF static inline
+#endif
+
+// the amount of rows a worker claims at a time when evaluating a grid.
+#ifndef GRID_ROWS
+#define GRID_ROWS 4
+#endif
+
+// the characters a heatmap is shaded with, from the lowest value to the highest.
+#ifndef HEATMAP_RAMP
+#define HEATMAP_RAMP " .:-=+*#%@"
+#endif
+
+// a function of x and y sampled on an evenly spaced grid. row 0 is at y0 and column 0 at x0, so a grid that is
+// printed top down has y0 as its highest y.
+typedef struct {
+    int width, height;
+    long double x0, x1, y0, y1;
+    double *values;
+} z_grid;
+
+// the rows of a grid that the workers share, they claim GRID_ROWS of them at a time until there are none left.
+typedef struct {
+    p_data *function;
+    z_grid *grid;
+    long double base;
+    const long double *xvalues;
+    int next_row;
+
+    // the progress of the computation that the grid is part of.
+    p_progress *progress;
+
+    // the first error that a worker ran into, which stops the others and is raised once they were all joined.
+    int failed;
+    char error[MAX_LENGTH];
+} z_rows;
+
+// allocates a grid over the given bounds, returns NULL if it can't be.
+ZDEF z_grid *grid_new(int width, int height, long double x0, long double x1, long double y0, long double y1) {
+    if(width < 1 || height < 1)
+        return NULL;
+
+    z_grid *grid = (z_grid *) malloc(sizeof(z_grid));
+    if(grid == NULL)
+        return NULL;
+    *grid = (z_grid) { width, height, x0, x1, y0, y1, (double *) malloc((size_t) width * height * sizeof(double)) };
+    if(grid -> values == NULL) {
+        free(grid);
+        return NULL;
+    }
+    memory_acquire(MEMORY_grids, sizeof(z_grid) + (long) width * height * sizeof(double));
+    return grid;
+}
+
+ZDEF void grid_free(z_grid *grid) {
+    if(grid == NULL)
+        return;
+    memory_release(MEMORY_grids, sizeof(z_grid) + (long) grid -> width * grid -> height * sizeof(double));
+    free(grid -> values);
+    free(grid);
+}
+
+// returns the x of a column and the y of a row of the grid.
+ZDEF long double grid_x(z_grid *grid, int column) {
+    return grid -> width > 1 ? grid -> x0 + (grid -> x1 - grid -> x0) * column / (grid -> width - 1) : grid -> x0;
+}
+
+ZDEF long double grid_y(z_grid *grid, int row) {
+    return grid -> height > 1 ? grid -> y0 + (grid -> y1 - grid -> y0) * row / (grid -> height - 1) : grid -> y0;
+}
+
+// evaluates rows of the grid until there are none left. every row has a single y, so a row is one call to the batch
+// evaluator with the x values that all rows share.
+ZDEF void *evaluate_rows(void *argument) {
+    z_rows *rows = (z_rows *) argument;
+    progress = rows -> progress;
+    z_grid *grid = rows -> grid;
+    long double *volatile output = (long double *) malloc(grid -> width * sizeof(long double));
+
+    // the calling thread is one of the workers, so its own handler is put back however its share ends.
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        if(__atomic_exchange_n(&rows -> failed, 1, __ATOMIC_ACQ_REL) == 0)
+            snprintf(rows -> error, MAX_LENGTH, "%s", error_message);
+        free(output);
+        return NULL;
+    }
+
+    for(;;) {
+        int first = __atomic_fetch_add(&rows -> next_row, GRID_ROWS, __ATOMIC_RELAXED);
+        if(first >= grid -> height || canceled() || __atomic_load_n(&rows -> failed, __ATOMIC_ACQUIRE))
+            break;
+
+        int last = first + GRID_ROWS < grid -> height ? first + GRID_ROWS : grid -> height;
+        for(int row = first ; row < last ; row++) {
+            evaluate_batch_xy(rows -> function, rows -> xvalues, grid_y(grid, row), output, grid -> width, rows -> base);
+
+            double *values = grid -> values + (size_t) row * grid -> width;
+            for(int i = 0 ; i < grid -> width ; i++)
+                values[i] = (double) output[i];
+        }
+
+        if(progress_advance(last - first))
+            break;
+    }
+
+    error_handler = previous;
+    free(output);
+    return NULL;
+}
+
+// evaluates a function of x and y at every point of the grid, split between worker threads by blocks of rows.
+// returns the time it took in seconds.
+ZDEF double evaluate_grid(p_data *function, z_grid *grid, int threads, long double base) {
+    double start = phase_begin(), seconds_start = now_seconds();
+
+    // a malformed function is evaluated once first, so that it reports its error before any thread is started.
+    if(!function -> valid)
+        evaluate_xy(grid -> x0, grid -> y0, function, base);
+
+    if(threads < 1)
+        threads = worker_count();
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    // there's no point in more threads than there are blocks of rows.
+    if((grid -> height + GRID_ROWS - 1) / GRID_ROWS < threads)
+        threads = (grid -> height + GRID_ROWS - 1) / GRID_ROWS;
+
+    long double *xvalues = (long double *) malloc(grid -> width * sizeof(long double));
+    for(int i = 0 ; i < grid -> width ; i++)
+        xvalues[i] = grid_x(grid, i);
+
+    z_rows rows = { function, grid, base, xvalues, 0, progress, 0 };
+    progress_total(grid -> height);
+
+    // the calling thread is one of the workers, and rows are shared out as they're claimed, so threads that can't be
+    // started only leave more of the rows to the others.
+    pthread_t workers[MAX_THREADS];
+    int started = 1;
+    while(started < threads && pthread_create(&workers[started], NULL, &evaluate_rows, &rows) == 0)
+        started++;
+    evaluate_rows(&rows);
+
+    // every worker is joined before an error is raised, since they all use the rows and x values of this call.
+    for(int i = 1 ; i < started ; i++)
+        pthread_join(workers[i], NULL);
+
+    free(xvalues);
+    phase_end(PHASE_grid, start);
+    if(rows.failed)
+        throw_error(rows.error);
+    if(instrumenting())
+        instrument_add(calc_instrument.render_evaluations, (long) grid -> width * grid -> height);
+    return now_seconds() - seconds_start;
+}
+
+// finds the smallest and largest finite value in the grid, returns false if there are none.
+ZDEF bool grid_range(z_grid *grid, double *min, double *max) {
+    *min = INFINITY;
+    *max = -INFINITY;
+    size_t count = (size_t) grid -> width * grid -> height;
+    for(size_t i = 0 ; i < count ; i++) {
+        double value = grid -> values[i];
+        if(!isfinite(value))
+            continue;
+        if(value < *min) *min = value;
+        if(value > *max) *max = value;
+    }
+    return *min <= *max;
+}
+
+// prints the grid with a character per point, shaded by where its value falls between the smallest and largest
+// finite values. points that aren't finite are left as '?'.
+ZDEF void print_heatmap(z_grid *grid, FILE *file) {
+    const char *ramp = HEATMAP_RAMP;
+    int levels = strlen(ramp);
+    double min, max;
+    bool finite = grid_range(grid, &min, &max);
+
+    char *line = (char *) malloc(grid -> width + 1);
+    for(int row = 0 ; row < grid -> height ; row++) {
+        double *values = grid -> values + (size_t) row * grid -> width;
+        for(int i = 0 ; i < grid -> width ; i++) {
+            if(!isfinite(values[i]))
+                line[i] = '?';
+            else {
+                int level = max > min ? (int) ((values[i] - min) / (max - min) * levels) : 0;
+                line[i] = ramp[level < levels ? level : levels - 1];
+            }
+        }
+        line[grid -> width] = '\0';
+        fputs(line, file);
+        fputc('\n', file);
+    }
+    free(line);
+
+    if(finite)
+        fprintf(file, "'%c' = %.6g ... '%c' = %.6g\n", ramp[0], min, ramp[levels - 1], max);
+    else
+        fprintf(file, "no finite values.\n");
+}
+
+// draws where a function of x and y is 0 onto the display, by marching squares. the function is sampled at the
+// corners of every pixel, and a pixel whose corners don't all have the same sign gets the stroke that the curve takes
+// through it. returns the time the sampling took in seconds.
+ZDEF double draw_implicit(pixel **display, p_data *function, long double x_steps, long double y_steps, int threads, long double base) {
+    int width = WINDOW_WIDTH, height = WINDOW_HEIGHT;
+    long double left = display[0][0].x - x_steps / 2, top = display[0][0].y + y_steps / 2;
+    z_grid *corners = grid_new(width + 1, height + 1, left, left + width * x_steps, top, top - height * y_steps);
+    if(corners == NULL)
+        throw_error("out of memory");
+    double seconds = evaluate_grid(function, corners, threads, base);
+
+    // the stroke for every combination of corners that are above 0, with the top left as 8, the top right as 4, the
+    // bottom right as 2 and the bottom left as 1. opposite corners above 0 (5 and 10) depend on the center.
+    const char *strokes = " \\/-\\X|//|X\\-/\\ ";
+
+    for(int y = 0 ; y < height && !canceled() ; y++) {
+        double *upper = corners -> values + (size_t) y * (width + 1), *lower = upper + width + 1;
+        for(int x = 0 ; x < width ; x++) {
+            double tl = upper[x], tr = upper[x + 1], br = lower[x + 1], bl = lower[x];
+            if(!isfinite(tl) || !isfinite(tr) || !isfinite(br) || !isfinite(bl))
+                continue;
+
+            int cell = (tl > 0) << 3 | (tr > 0) << 2 | (br > 0) << 1 | (bl > 0);
+            if(cell == 0 || cell == 15)
+                continue;
+
+            char stroke = strokes[cell];
+            if(stroke == 'X') {
+                // when the center is above 0 the corners that are above 0 are connected through it, and the curve
+                // cuts off the other two.
+                bool center = tl + tr + br + bl > 0;
+                stroke = (cell == 5) == center ? '/' : '\\';
+            }
+            display[y][x].display = stroke;
+        }
+    }
+
+    grid_free(corners);
+    return seconds;
+}
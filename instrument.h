@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#ifndef IDEF
+#define IDEF static inline
+#endif
+
+// the counters and timers are compiled in unless INSTRUMENT is 0. even then they only count once they're turned on,
+// until then every probe is a single branch that is predicted not to be taken.
+#ifndef INSTRUMENT
+#define INSTRUMENT 1
+#endif
+
+// the environment variables that turn instrumentation on at startup, and that name a file to export a trace to.
+#ifndef STATS_VARIABLE
+#define STATS_VARIABLE "CALC_STATS"
+#endif
+
+#ifndef TRACE_VARIABLE
+#define TRACE_VARIABLE "CALC_TRACE"
+#endif
+
+// the phases that are timed.
+typedef enum {
+    PHASE_command,
+    PHASE_preprocess,
+    PHASE_tokenize,
+    PHASE_postfix,
+    PHASE_assemble,
+    PHASE_fold,
+    PHASE_polynomial,
+    PHASE_draw_plane,
+    PHASE_draw_line,
+    PHASE_shade_graph,
+    PHASE_print_plane,
+    PHASE_grid,
+    PHASE_curve,
+    PHASE_views,
+    PHASE_integrate,
+    PHASE_count
+} i_phase;
+
+static const char *phase_names[PHASE_count] = {
+    "command", "preprocess", "tokenize", "infix_to_postfix", "assemble", "fold_constants", "detect_polynomial",
+    "draw_plane", "draw_line", "shade_graph", "print_plane", "evaluate_grid", "draw_curve", "draw_views",
+    "integrate"
+};
+
+static const char *phase_categories[PHASE_count] = {
+    "command", "compile", "compile", "compile", "compile", "compile", "compile", "render", "render", "render", "render", "render", "render", "render",
+    "analysis"
+};
+
+// the parts of the program whose memory is accounted for, so that /mem can show what a long session is holding on to.
+typedef enum {
+    MEMORY_expressions,
+    MEMORY_definitions,
+    MEMORY_displays,
+    MEMORY_grids,
+    MEMORY_commands,
+    MEMORY_count
+} i_memory;
+
+static const char *memory_names[MEMORY_count] = {
+    "expressions", "definitions", "displays", "grids", "commands"
+};
+
+// how often a phase ran and for how long, in nanoseconds.
+typedef struct {
+    long calls;
+    long total;
+    long longest;
+} i_timer;
+
+// every counter. they are added to atomically, since evaluations also happen on worker threads.
+typedef struct {
+    bool enabled;
+    i_timer timers[PHASE_count];
+
+    // evaluate() calls, the ones that took the polynomial fast path, and evaluate_batch() calls and values.
+    long evaluations, polynomial_evaluations, batches, batch_values;
+
+    // the instructions that the evaluators ran, by opcode.
+    long opcodes[128];
+
+    // evaluations made by the renderer and the integrator.
+    long render_evaluations, integrate_evaluations;
+
+    // the live allocations of every subsystem and the bytes they hold. unlike the other counters they are always kept,
+    // since they only change when something is allocated or freed, and resetting the counters leaves them alone.
+    long allocations[MEMORY_count], allocated[MEMORY_count];
+
+    // the trace being exported, if there is one. events are appended as they finish.
+    FILE *trace;
+    char trace_name[256];
+    long trace_events;
+    double trace_start;
+    pthread_mutex_t trace_lock;
+} i_state;
+
+// the one set of counters. it is a weak definition, so that the library and the program using it share it instead
+// of each counting on its own.
+__attribute__((weak)) i_state calc_instrument = { .trace_lock = PTHREAD_MUTEX_INITIALIZER };
+
+#if INSTRUMENT
+#define instrumenting() __builtin_expect(calc_instrument.enabled, 0)
+#else
+#define instrumenting() 0
+#endif
+
+// adds to a counter from any thread.
+#define instrument_add(counter, amount) __atomic_add_fetch(&(counter), (amount), __ATOMIC_RELAXED)
+
+// accounts for an allocation of a subsystem, and for it being freed.
+IDEF void memory_acquire(i_memory subsystem, long bytes) {
+    instrument_add(calc_instrument.allocations[subsystem], 1);
+    instrument_add(calc_instrument.allocated[subsystem], bytes);
+}
+
+IDEF void memory_release(i_memory subsystem, long bytes) {
+    instrument_add(calc_instrument.allocations[subsystem], -1);
+    instrument_add(calc_instrument.allocated[subsystem], -bytes);
+}
+
+// returns the resident set size of a process (0 for this one) in bytes, or -1 if it can't be read.
+IDEF long resident_bytes(int pid) {
+    char name[64];
+    long pages, resident;
+    if(pid > 0) snprintf(name, sizeof(name), "/proc/%i/statm", pid);
+    else snprintf(name, sizeof(name), "/proc/self/statm");
+
+    FILE *statm = fopen(name, "r");
+    if(statm == NULL)
+        return -1;
+    int read = fscanf(statm, "%li %li", &pages, &resident);
+    fclose(statm);
+    return read == 2 ? resident * sysconf(_SC_PAGESIZE) : -1;
+}
+
+// returns the time in microseconds since an arbitrary point, which is never 0.
+IDEF double instrument_now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e6 + time.tv_nsec * 1e-3 + 1;
+}
+
+// starts timing a phase, returns 0 when instrumentation is off.
+IDEF double phase_begin() {
+    return instrumenting() ? instrument_now() : 0;
+}
+
+// writes a string into a json string, escaping what has to be.
+IDEF void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for( ; *text != '\0' ; text++) {
+        if(*text == '"' || *text == '\\') fprintf(file, "\\%c", *text);
+        else if((unsigned char) *text < 0x20) fprintf(file, "\\u%04x", *text);
+        else fputc(*text, file);
+    }
+    fputc('"', file);
+}
+
+// finishes timing a phase that was started with phase_begin(), adding it to the trace under a name of its own when
+// one is given.
+IDEF void phase_end_named(i_phase phase, double start, const char *name) {
+    if(start == 0)
+        return;
+
+    double end = instrument_now();
+    long duration = (end - start) * 1e3;
+    i_timer *timer = &calc_instrument.timers[phase];
+    instrument_add(timer -> calls, 1);
+    instrument_add(timer -> total, duration);
+    for(long longest = timer -> longest ; duration > longest ; )
+        if(__atomic_compare_exchange_n(&timer -> longest, &longest, duration, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+
+    if(calc_instrument.trace == NULL)
+        return;
+
+    // chrome's trace format: complete events ("X") with their start and duration in microseconds.
+    static _Thread_local int thread_id = 0;
+    static int thread_count = 0;
+    if(thread_id == 0)
+        thread_id = __atomic_add_fetch(&thread_count, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&calc_instrument.trace_lock);
+    FILE *trace = calc_instrument.trace;
+    if(trace != NULL) {
+        fprintf(trace, "%s\n{\"name\":", calc_instrument.trace_events++ > 0 ? "," : "");
+        write_json_string(trace, name != NULL ? name : phase_names[phase]);
+        fprintf(trace, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%i,\"tid\":%i}", phase_categories[phase],
+            start - calc_instrument.trace_start, end - start, (int) getpid(), thread_id);
+        if(phase == PHASE_command)
+            fflush(trace);
+    }
+    pthread_mutex_unlock(&calc_instrument.trace_lock);
+}
+
+// finishes timing a phase that was started with phase_begin().
+IDEF void phase_end(i_phase phase, double start) {
+    phase_end_named(phase, start, NULL);
+}
+
+// turns instrumentation on or off. it can't be turned on when it isn't compiled in.
+IDEF bool instrument_enable(bool enabled) {
+    calc_instrument.enabled = enabled && INSTRUMENT;
+    return calc_instrument.enabled;
+}
+
+// sets every counter and timer back to zero.
+IDEF void instrument_reset() {
+    memset(calc_instrument.timers, 0, sizeof(calc_instrument.timers));
+    memset(calc_instrument.opcodes, 0, sizeof(calc_instrument.opcodes));
+    calc_instrument.evaluations = calc_instrument.polynomial_evaluations = 0;
+    calc_instrument.batches = calc_instrument.batch_values = 0;
+    calc_instrument.render_evaluations = calc_instrument.integrate_evaluations = 0;
+}
+
+// closes the array of trace events so that the trace is complete json.
+IDEF void instrument_finish() {
+    pthread_mutex_lock(&calc_instrument.trace_lock);
+    if(calc_instrument.trace != NULL) {
+        fprintf(calc_instrument.trace, "\n]\n");
+        fclose(calc_instrument.trace);
+        calc_instrument.trace = NULL;
+    }
+    pthread_mutex_unlock(&calc_instrument.trace_lock);
+}
+
+// turns instrumentation on when the environment asks for it, and starts exporting a trace when it names a file.
+// returns false if the trace couldn't be started.
+IDEF bool instrument_start() {
+    char *stats = getenv(STATS_VARIABLE), *trace = getenv(TRACE_VARIABLE);
+    if(stats != NULL && stats[0] != '\0' && strcmp(stats, "0") != 0)
+        instrument_enable(true);
+
+    if(trace == NULL || trace[0] == '\0' || !INSTRUMENT)
+        return true;
+
+    if((calc_instrument.trace = fopen(trace, "w")) == NULL)
+        return false;
+
+    snprintf(calc_instrument.trace_name, sizeof(calc_instrument.trace_name), "%s", trace);
+    calc_instrument.trace_start = instrument_now();
+    fprintf(calc_instrument.trace, "[");
+    instrument_enable(true);
+    atexit(instrument_finish);
+    return true;
+}
+
+// the name of an opcode, for /stats.
+IDEF const char *opcode_name(char op) {
+    switch(op) {
+        case 'x': return "x";
+        case 'y': return "y";
+        case 'n': return "number";
+        case 's': return "sin";
+        case 'S': return "csc";
+        case 'c': return "cos";
+        case 'C': return "sec";
+        case 't': return "tan";
+        case 'T': return "cot";
+        case 'l': return "log";
+        case 'a': return "abs";
+        case 'm': return "min";
+        case 'M': return "max";
+        case 'L': return "<=";
+        case 'G': return ">=";
+        case '=': return "==";
+        case '!': return "!=";
+        case 'j': return "if jump";
+        case 'J': return "else jump";
+        case '?': return "if select";
+    }
+    static char operators[128][2];
+    operators[op & 127][0] = op;
+    return operators[op & 127];
+}
+
+// prints every counter and timer.
+IDEF void print_instrumentation(FILE *output) {
+    fprintf(output, "instrumentation is %s", calc_instrument.enabled ? "on" : INSTRUMENT ? "off (\"/stats on\" turns it on)" : "not compiled in");
+    if(calc_instrument.trace != NULL)
+        fprintf(output, ", exporting a trace to %s", calc_instrument.trace_name);
+    fprintf(output, ".\n\n%-20s %10s %12s %12s %12s\n", "phase", "calls", "total ms", "mean us", "max us");
+    for(int i = 0 ; i < PHASE_count ; i++) {
+        i_timer *timer = &calc_instrument.timers[i];
+        fprintf(output, "%-20s %10li %12.3f %12.3f %12.3f\n", phase_names[i], timer -> calls, timer -> total * 1e-6,
+            timer -> calls > 0 ? timer -> total * 1e-3 / timer -> calls : 0, timer -> longest * 1e-3);
+    }
+
+    fprintf(output, "\nevaluate(): %li calls (%li on the polynomial fast path)\n", calc_instrument.evaluations, calc_instrument.polynomial_evaluations);
+    fprintf(output, "evaluate_batch(): %li calls, %li values\n", calc_instrument.batches, calc_instrument.batch_values);
+    fprintf(output, "evaluations while rendering: %li, while integrating: %li\n", calc_instrument.render_evaluations, calc_instrument.integrate_evaluations);
+
+    long total = 0;
+    for(int i = 0 ; i < 128 ; i++)
+        total += calc_instrument.opcodes[i];
+    fprintf(output, "instructions executed: %li\n", total);
+    for(int i = 0 ; i < 128 ; i++)
+        if(calc_instrument.opcodes[i] > 0)
+            fprintf(output, "\t%-8s %14li (%.1f%%)\n", opcode_name(i), calc_instrument.opcodes[i], 100.0 * calc_instrument.opcodes[i] / total);
+}
+
+// prints the memory every subsystem holds, what the heap holds in all, and the resident set size.
+IDEF void print_memory(FILE *output) {
+    long count = 0, bytes = 0;
+    fprintf(output, "%-20s %10s %14s\n", "subsystem", "live", "bytes");
+    for(int i = 0 ; i < MEMORY_count ; i++) {
+        long live = __atomic_load_n(&calc_instrument.allocations[i], __ATOMIC_RELAXED), held = __atomic_load_n(&calc_instrument.allocated[i], __ATOMIC_RELAXED);
+        fprintf(output, "%-20s %10li %14li\n", memory_names[i], live, held);
+        count += live;
+        bytes += held;
+    }
+    fprintf(output, "%-20s %10li %14li\n", "total", count, bytes);
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 heap = mallinfo2();
+    fprintf(output, "\nheap: %zu bytes in use, %zu bytes free\n", heap.uordblks + heap.hblkhd, heap.fordblks);
+#else
+    fprintf(output, "\n");
+#endif
+
+    long resident = resident_bytes(0);
+    if(resident >= 0)
+        fprintf(output, "resident set size: %.2f MB\n", resident / 1e6);
+    else fprintf(output, "resident set size: unknown\n");
+}
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <errno.h>
+
+#ifndef JDEF
+#define JDEF static inline
+#endif
+
+// how long a job runs in the foreground before the prompt comes back and it carries on in the background, in
+// milliseconds. short commands finish within it and print as if they had never been a job.
+#ifndef JOB_FOREGROUND
+#define JOB_FOREGROUND 250
+#endif
+
+// how often the progress of a job in the background is printed, in milliseconds.
+#ifndef JOB_PROGRESS_INTERVAL
+#define JOB_PROGRESS_INTERVAL 2000
+#endif
+
+// a long command running on a worker thread. its output is collected in memory and printed by the main thread once
+// it's done, so that it doesn't interleave with the commands that run in the meantime.
+typedef struct {
+    pthread_t thread;
+    p_progress progress;
+    bool active, running;
+    double start;
+    char command[MAX_LENGTH];
+
+    // what the job runs, and frees what it ran with afterwards.
+    void (*run)(void *argument, FILE *output);
+    void (*release)(void *argument);
+    void *argument;
+
+    char *output;
+    size_t output_size;
+    FILE *stream;
+
+    // the worker writes to the pipe when it's done, so the main thread can wait for it along with its input.
+    int wake[2];
+
+    // output that the worker published before it was done, for the main thread to print while it waits for the
+    // job. the worker writes to the frames pipe when there is some. published output is copied out of the stream
+    // under the lock, so the main thread never reads the stream while the worker writes to it.
+    bool watched;
+    int frames[2];
+    pthread_mutex_t lock;
+    char *published;
+    size_t published_size, shown;
+} j_job;
+
+// the job that ctrl-c cancels.
+static j_job *interruptible = NULL;
+
+// the job that the current thread is running, if it's a job's worker.
+static _Thread_local j_job *current_job = NULL;
+
+// cancels the running job on ctrl-c instead of ending the program.
+JDEF void interrupt_job(int signal) {
+    (void) signal;
+    if(interruptible != NULL)
+        __atomic_store_n(&interruptible -> progress.canceled, 1, __ATOMIC_RELAXED);
+}
+
+// sets up the job slot, returns false if it can't be.
+JDEF bool job_init(j_job *job) {
+    memset(job, 0, sizeof(j_job));
+    if(pipe(job -> wake) != 0 || pipe(job -> frames) != 0)
+        return false;
+
+    for(int i = 0 ; i < 2 ; i++) {
+        fcntl(job -> wake[i], F_SETFD, FD_CLOEXEC);
+        fcntl(job -> frames[i], F_SETFD, FD_CLOEXEC);
+        fcntl(job -> frames[i], F_SETFL, O_NONBLOCK);
+    }
+    fcntl(job -> wake[0], F_SETFL, O_NONBLOCK);
+    pthread_mutex_init(&job -> lock, NULL);
+    return true;
+}
+
+// runs the job on the worker thread. errors in it are reported in its output instead of ending the program.
+JDEF void *run_job(void *argument) {
+    j_job *job = (j_job *) argument;
+    progress = &job -> progress;
+    current_job = job;
+
+    jmp_buf handler;
+    error_handler = &handler;
+    if(setjmp(handler) == 0)
+        job -> run(job -> argument, job -> stream);
+    else fprintf(job -> stream, "ERROR: %s\n", error_message);
+    error_handler = NULL;
+
+    fclose(job -> stream);
+    __atomic_store_n(&job -> running, false, __ATOMIC_RELEASE);
+    if(write(job -> wake[1], "", 1) != 1)
+        perror("job");
+    return NULL;
+}
+
+// starts a job, returns false if one is already running.
+JDEF bool job_start(j_job *job, char *command, void (*run)(void *, FILE *), void (*release)(void *), void *argument) {
+    if(job -> active)
+        return false;
+
+    job -> progress = (p_progress) { 0, 0, 0 };
+    job -> shown = 0;
+    job -> watched = true;
+    job -> run = run;
+    job -> release = release;
+    job -> argument = argument;
+    job -> start = now_seconds();
+    snprintf(job -> command, sizeof(job -> command), "%.*s", (int) strcspn(command, "\n"), command);
+    if((job -> stream = open_memstream(&job -> output, &job -> output_size)) == NULL)
+        return false;
+
+    // no SA_RESTART, so that waiting for the job or for input wakes up to see the interrupt.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &interrupt_job;
+    sigemptyset(&action.sa_mask);
+    interruptible = job;
+    sigaction(SIGINT, &action, NULL);
+
+    job -> active = job -> running = true;
+    if(pthread_create(&job -> thread, NULL, &run_job, job) != 0) {
+        job -> active = job -> running = false;
+        fclose(job -> stream);
+        free(job -> output);
+        signal(SIGINT, SIG_DFL);
+        return false;
+    }
+    return true;
+}
+
+// returns how far along the job is, from 0 to 1, or -1 if that isn't known.
+JDEF double job_fraction(j_job *job) {
+    long total = __atomic_load_n(&job -> progress.total, __ATOMIC_RELAXED), done = __atomic_load_n(&job -> progress.done, __ATOMIC_RELAXED);
+    return total > 0 ? (double) (done < total ? done : total) / total : -1;
+}
+
+// prints what the job is and how far along it is.
+JDEF void print_job(j_job *job, FILE *output) {
+    if(!job -> active) {
+        fprintf(output, "no job is running.\n");
+        return;
+    }
+
+    double fraction = job_fraction(job);
+    fprintf(output, "[%s] ", job -> command);
+    if(fraction >= 0) fprintf(output, "%.0f%% ", fraction * 100);
+    fprintf(output, "after %.1fs%s\n", now_seconds() - job -> start, job -> progress.canceled ? ", canceling" : "");
+}
+
+// asks the job to stop at the end of its current block.
+JDEF bool job_cancel(j_job *job) {
+    if(!job -> active)
+        return false;
+
+    __atomic_store_n(&job -> progress.canceled, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// returns whether the output that the current thread publishes is printed right away: a job is watched while the
+// main thread waits for it, and anything else prints to its output directly.
+JDEF bool job_watched() {
+    return current_job == NULL || __atomic_load_n(&current_job -> watched, __ATOMIC_ACQUIRE);
+}
+
+// publishes what the current thread wrote to its output so far, so that it's printed while the job is still running.
+JDEF void job_publish(FILE *output) {
+    j_job *job = current_job;
+    fflush(output);
+    if(job == NULL || output != job -> stream)
+        return;
+
+    pthread_mutex_lock(&job -> lock);
+    size_t length = job -> output_size - job -> shown;
+    job -> published = (char *) realloc(job -> published, job -> published_size + length);
+    memcpy(job -> published + job -> published_size, job -> output + job -> shown, length);
+    job -> published_size += length;
+    job -> shown = job -> output_size;
+    pthread_mutex_unlock(&job -> lock);
+
+    if(write(job -> frames[1], "", 1) != 1 && errno != EAGAIN)
+        perror("job");
+}
+
+// prints the output that the job published and that wasn't printed yet.
+JDEF void job_show(j_job *job, FILE *output) {
+    char drain[16];
+    while(read(job -> frames[0], drain, sizeof(drain)) > 0);
+
+    pthread_mutex_lock(&job -> lock);
+    fwrite(job -> published, 1, job -> published_size, output);
+    fflush(output);
+    free(job -> published);
+    job -> published = NULL;
+    job -> published_size = 0;
+    pthread_mutex_unlock(&job -> lock);
+}
+
+// waits up to a timeout in milliseconds (or forever when it's negative) for the job to finish, printing what it
+// publishes in the meantime to the output. returns whether it finished. interrupts end the wait early.
+JDEF bool job_wait(j_job *job, int timeout, FILE *output) {
+    if(!job -> active || !__atomic_load_n(&job -> running, __ATOMIC_ACQUIRE))
+        return true;
+
+    __atomic_store_n(&job -> watched, true, __ATOMIC_RELEASE);
+    double deadline = now_seconds() + timeout * 1e-3;
+    for(;;) {
+        int left = timeout < 0 ? -1 : (int) ((deadline - now_seconds()) * 1e3);
+        struct pollfd polls[2] = { { job -> wake[0], POLLIN, 0 }, { job -> frames[0], POLLIN, 0 } };
+        int ready = poll(polls, 2, timeout < 0 || left > 0 ? left : 0);
+        if(polls[1].revents & POLLIN)
+            job_show(job, output);
+        if(ready <= 0 || polls[0].revents & POLLIN || !__atomic_load_n(&job -> running, __ATOMIC_ACQUIRE))
+            break;
+    }
+
+    // once nobody waits for it, what it publishes is printed with the rest of its output when it's done.
+    bool finished = !__atomic_load_n(&job -> running, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&job -> watched, false, __ATOMIC_RELEASE);
+    return finished;
+}
+
+// collects a finished job and prints its output, returns false if it hasn't finished.
+JDEF bool job_finish(j_job *job, FILE *output) {
+    if(!job -> active || __atomic_load_n(&job -> running, __ATOMIC_ACQUIRE))
+        return false;
+
+    char drain[16];
+    while(read(job -> wake[0], drain, sizeof(drain)) > 0);
+    pthread_join(job -> thread, NULL);
+    interruptible = NULL;
+    signal(SIGINT, SIG_DFL);
+
+    // what it published and wasn't printed yet comes first, then what it wrote after it last published.
+    job_show(job, output);
+    fwrite(job -> output + job -> shown, 1, job -> output_size - job -> shown, output);
+    if(job -> progress.canceled) {
+        double fraction = job_fraction(job);
+        fprintf(output, "[%s] canceled after %.1fs", job -> command, now_seconds() - job -> start);
+        if(fraction >= 0) fprintf(output, " at %.0f%%", fraction * 100);
+        fprintf(output, ", everything else is as it was.\n");
+    }
+
+    free(job -> output);
+    job -> output = NULL;
+    if(job -> release != NULL)
+        job -> release(job -> argument);
+    job -> active = false;
+    return true;
+}
@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef MDEF
+#define MDEF static inline
+#endif
+
+// the amount of values that are converted and evaluated together, small enough that a block of x values, its
+// results and the evaluator's stack stay in cache.
+#ifndef MAP_BLOCK
+#define MAP_BLOCK 2048
+#endif
+
+// one worker's share of a mapped file.
+typedef struct {
+    p_data *function;
+    const unsigned char *input;
+    unsigned char *output;
+    size_t first, last;
+    long double base;
+
+    // an error that the worker ran into, reported once every worker was joined.
+    bool failed;
+    char error[MAX_LENGTH];
+} m_worker;
+
+// what a mapped evaluation did and how long it took.
+typedef struct {
+    size_t values;
+    int threads;
+    double seconds;
+} m_result;
+
+// reads a little-endian binary64 value.
+MDEF double get_double(const unsigned char *in) {
+    uint64_t bits = 0;
+    for(int i = 0 ; i < 8 ; i++)
+        bits |= (uint64_t) in[i] << (8 * i);
+
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// evaluates a worker's share of the file straight from the input mapping into the output mapping.
+MDEF void *evaluate_mapped(void *argument) {
+    m_worker *worker = (m_worker *) argument;
+    long double xvalues[MAP_BLOCK], yvalues[MAP_BLOCK];
+
+    // an error stops this worker's share instead of ending the process, map_file() reports it.
+    jmp_buf handler, *volatile previous = error_handler;
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = previous;
+        worker -> failed = true;
+        snprintf(worker -> error, MAX_LENGTH, "%s", error_message);
+        return NULL;
+    }
+
+    for(size_t block = worker -> first ; block < worker -> last ; block += MAP_BLOCK) {
+        int length = worker -> last - block < MAP_BLOCK ? worker -> last - block : MAP_BLOCK;
+        for(int i = 0 ; i < length ; i++)
+            xvalues[i] = get_double(worker -> input + (block + i) * 8);
+
+        evaluate_batch(worker -> function, xvalues, yvalues, length, worker -> base);
+
+        for(int i = 0 ; i < length ; i++)
+            put_double(worker -> output + (block + i) * 8, yvalues[i]);
+    }
+
+    error_handler = previous;
+    return NULL;
+}
+
+// applies a function to every little-endian double in the input file, and writes the results to the output file
+// as little-endian doubles in the same order. both files are memory mapped, so the kernel pages them in and out
+// as the workers walk through them and files larger than memory work the same as small ones.
+MDEF int map_file(char *input_name, char *output_name, p_data *function, int threads, long double base, m_result *result) {
+    memset(result, 0, sizeof(m_result));
+
+    // a malformed function is refused before the output file is created, so that it isn't left truncated.
+    if(!function -> valid) {
+        fprintf(stderr, "ERROR: invalid expression\n");
+        return 1;
+    }
+
+    int input_file = open(input_name, O_RDONLY);
+    if(input_file < 0) {
+        fprintf(stderr, "ERROR: could not open \"%s\".\n", input_name);
+        return 1;
+    }
+
+    struct stat status;
+    fstat(input_file, &status);
+    size_t size = status.st_size;
+    if(size % 8 != 0) {
+        fprintf(stderr, "ERROR: \"%s\" is not a whole number of doubles.\n", input_name);
+        close(input_file);
+        return 1;
+    }
+
+    int output_file = open(output_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(output_file < 0 || ftruncate(output_file, size) != 0) {
+        fprintf(stderr, "ERROR: could not create \"%s\".\n", output_name);
+        close(input_file);
+        return 1;
+    }
+
+    if(size == 0) {
+        close(input_file);
+        close(output_file);
+        return 0;
+    }
+
+    unsigned char *input = mmap(NULL, size, PROT_READ, MAP_SHARED, input_file, 0);
+    unsigned char *output = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, output_file, 0);
+    if(input == MAP_FAILED || output == MAP_FAILED) {
+        fprintf(stderr, "ERROR: could not map the files.\n");
+        close(input_file);
+        close(output_file);
+        return 1;
+    }
+
+    // both files are walked front to back, so the kernel can read ahead and drop pages behind the workers.
+    madvise(input, size, MADV_SEQUENTIAL);
+    madvise(output, size, MADV_SEQUENTIAL);
+
+    size_t values = size / 8;
+    if(threads < 1)
+        threads = 1;
+    if(threads > MAX_THREADS)
+        threads = MAX_THREADS;
+    if(values / MAP_BLOCK < (size_t) threads)
+        threads = values / MAP_BLOCK > 0 ? values / MAP_BLOCK : 1;
+
+    m_worker workers[MAX_THREADS];
+    pthread_t ids[MAX_THREADS];
+    bool started[MAX_THREADS];
+
+    double start = now_seconds();
+    for(int i = 0 ; i < threads ; i++) {
+        workers[i] = (m_worker) { function, input, output, values * i / threads, values * (i + 1) / threads, base };
+
+        // a share that can't get a thread of its own is evaluated by the calling thread.
+        started[i] = pthread_create(&ids[i], NULL, &evaluate_mapped, &workers[i]) == 0;
+        if(!started[i])
+            evaluate_mapped(&workers[i]);
+    }
+    for(int i = 0 ; i < threads ; i++)
+        if(started[i])
+            pthread_join(ids[i], NULL);
+
+    munmap(input, size);
+    munmap(output, size);
+    close(input_file);
+    close(output_file);
+
+    for(int i = 0 ; i < threads ; i++)
+        if(workers[i].failed) {
+            fprintf(stderr, "ERROR: %s\n", workers[i].error);
+            return 1;
+        }
+
+    result -> values = values;
+    result -> threads = threads;
+    result -> seconds = now_seconds() - start;
+    return 0;
+}
@@ -4,21 +4,27 @@
 #include <math.h>
 #include <string.h>
 #include <ctype.h>
+#include <setjmp.h>
 
 #ifndef PDEF
 #define PDEF static inline
 #endif
 
-// the max amount of parentheses that can be present in an expression.
-#ifndef MAX_COMPLEXITY
-#define MAX_COMPLEXITY 128
-#endif
-
 // the maximum length of an expression.
 #ifndef MAX_LENGTH
 #define MAX_LENGTH 256
 #endif
 
+// the highest degree a polynomial can have and still be stored as a coefficient vector.
+#ifndef MAX_DEGREE
+#define MAX_DEGREE 32
+#endif
+
+// the amount of x values that the batch evaluator carries through the program at once.
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 256
+#endif
+
 // state machine for the text parser.
 typedef enum {
     STATE_par,
@@ -28,6 +34,7 @@ typedef enum {
     STATE_con,
     STATE_num,
     STATE_trg,
+    STATE_sep,
     STATE_end,
     STATE_err
 } p_state;
@@ -39,9 +46,16 @@ typedef enum {
     TYPE_var,
     TYPE_num,
     TYPE_trg,
-    TYPE_con
+    TYPE_con,
+    TYPE_sep
 } p_type;
 
+// a single instruction of an assembled postfix program. numbers and constants are stored as 'n' with their value.
+typedef struct {
+    char op;
+    long double value;
+} p_instr;
+
 // current parser data.
 typedef struct {
     char *input;
@@ -52,12 +66,70 @@ typedef struct {
     p_type *types;
     p_state state;
     char *mkstr;
+
+    // the assembled program, which is what actually gets evaluated.
+    p_instr *program;
+    int program_len;
+    int stack_depth;
+    bool valid;
+
+    // polynomial fast path, coefficients are stored from the constant term upwards.
+    bool polynomial;
+    int degree;
+    long double *coefficients;
+
+    // the input, program and coefficients are borrowed from a mapped snapshot, so they aren't freed with the rest.
+    bool borrowed;
+
+    // the bytes the expression was accounted for once it compiled, given back when it's destroyed.
+    long accounted;
+
+    // a profiled expression is compiled as it was written, unfolded, and keeps where every instruction came from in its
+    // input (-1 for the multiplications that were implied). origins are the same for the makestring, until it's
+    // tokenized.
+    bool profiled;
+    int *origins, *sources;
 } p_data;
 
-// input definitions for ease of use.
-static char *function_shorthand = "sScCtTl";
-static char *accepted_inputs = "^+-/*[]{}()1234567890sincotaexlgpi";
-static char *accepted_functions[7] = {"sin", "csc", "cos", "sec", "tan", "cot", "log"};
+// input definitions for ease of use. functions are encoded as a single character each, as are pi and the comparisons
+// that take two characters (<= as L, >= as G, == as = and != as !).
+static char *function_shorthand = "sScCtTlamM?";
+static char *accepted_inputs = "^+-/*<>,.[]{}()1234567890xyep";
+static char *accepted_functions[11] = {"sin", "csc", "cos", "sec", "tan", "cot", "log", "abs", "min", "max", "if"};
+
+// when an error handler is set, errors jump back to it with the message instead of quitting the program. both are
+// per thread, so that one bad expression doesn't take down the other expressions being evaluated alongside it.
+static _Thread_local jmp_buf *error_handler = NULL;
+static _Thread_local char error_message[MAX_LENGTH];
+
+// how far along a long computation is, and whether another thread canceled it. like the error handler, it is per
+// thread, and long loops report to it and stop at the end of their current block once it's canceled.
+typedef struct {
+    int canceled;
+    long done, total;
+} p_progress;
+
+static _Thread_local p_progress *progress = NULL;
+
+// adds work that is about to be done to the total.
+PDEF void progress_total(long total) {
+    if(progress != NULL)
+        __atomic_add_fetch(&progress -> total, total, __ATOMIC_RELAXED);
+}
+
+// adds work that was done, and returns whether the computation was canceled.
+PDEF bool progress_advance(long done) {
+    if(progress == NULL)
+        return false;
+
+    __atomic_add_fetch(&progress -> done, done, __ATOMIC_RELAXED);
+    return __atomic_load_n(&progress -> canceled, __ATOMIC_RELAXED);
+}
+
+// returns whether the computation was canceled.
+PDEF bool canceled() {
+    return progress != NULL && __atomic_load_n(&progress -> canceled, __ATOMIC_RELAXED);
+}
 
 // memory handling.
 PDEF p_data *clear_data(p_data *data) {
@@ -65,6 +137,40 @@ PDEF p_data *clear_data(p_data *data) {
     return (p_data *) calloc(1, sizeof(p_data));
 }
 
+// frees the tokens and the makestring, which are only needed until the program is assembled.
+PDEF void release_tokens(p_data *data) {
+    if(data -> tokens != NULL)
+        for(int i = 0 ; i < data -> token_cnt ; i++)
+            free(data -> tokens[i]);
+
+    free(data -> tokens);
+    free(data -> types);
+    free(data -> mkstr);
+    free(data -> origins);
+    data -> tokens = NULL;
+    data -> types = NULL;
+    data -> mkstr = NULL;
+    data -> origins = NULL;
+    data -> token_cnt = 0;
+}
+
+// frees a compiled expression along with its input.
+PDEF void destroy_data(p_data *data) {
+    if(data == NULL)
+        return;
+
+    release_tokens(data);
+    if(data -> accounted > 0)
+        memory_release(MEMORY_expressions, data -> accounted);
+    free(data -> sources);
+    if(!data -> borrowed) {
+        free(data -> program);
+        free(data -> coefficients);
+        free(data -> input);
+    }
+    free(data);
+}
+
 // a function that prints all of the tokens of a parser dataset object
 PDEF void print_tokens(p_data *data) {
     for(int i = 0; i < data -> token_cnt; i++)
@@ -81,14 +187,19 @@ PDEF bool isin(char c, char *s) {
     return i < strlen(s);
 }
 
-// is called when an error occurs. prints error and quits.
+// is called when an error occurs. prints error and quits, unless there is an error handler to return to.
 PDEF void throw_error(char *s) {
+    if(error_handler != NULL) {
+        strncpy(error_message, s, MAX_LENGTH - 1);
+        longjmp(*error_handler, 1);
+    }
+
     printf("ERROR: %s\n", s);
     exit(0);
 }
 
 // returns the string corresponding to consecutive integers in the input.
-void findnum(p_data *data, char *start) {
+PDEF void findnum(p_data *data, char *start) {
     int length = 0;
 
     // if the first character is negative, the number parsing starts at the first character after the '-' symbol.
@@ -100,17 +211,21 @@ void findnum(p_data *data, char *start) {
         length++;
 
 
-    char *output = (char *) calloc(length, sizeof(char));
+    char *output = (char *) calloc(length + 1, sizeof(char));
     for(int i = 0; i < length; i++)
         output[i] = start[i];
 
+    if(data -> sources != NULL)
+        data -> sources[data -> token_pos] = data -> origins[data -> pos];
     data -> tokens[data -> token_pos] = output;
     data -> pos += length;
     data -> token_pos++;
 }
 
 // inserts a character as a string token into the token array.
-void add_ctoken(p_data *data, char c) {
+PDEF void add_ctoken(p_data *data, char c) {
+    if(data -> sources != NULL)
+        data -> sources[data -> token_pos] = data -> origins[data -> pos];
     data -> tokens[data -> token_pos] = (char *) calloc(2, sizeof(char));
     data -> tokens[data -> token_pos][0] = c;
     data -> tokens[data -> token_pos][1] = '\0';
@@ -119,18 +234,24 @@ void add_ctoken(p_data *data, char c) {
     return;
 }
 
-// simpifies trig functions to a single character corresponding to that function.
-char encode_trig(char *s) {
-    for(int i = 0;i < 7; i++)
-        for(int j = 0; j < 3; j++)
-            if(s[j] == accepted_functions[i][j] && j == 2) return function_shorthand[i];
+// simpifies functions to a single character corresponding to that function, and sets the length of its name.
+PDEF char encode_function(char *s, int *length) {
+    for(int i = 0 ; i < 11 ; i++) {
+        *length = strlen(accepted_functions[i]);
+        if(strncmp(s, accepted_functions[i], *length) == 0) return function_shorthand[i];
+    }
     return '\0';
 }
 
+// returns the amount of arguments that a function takes.
+PDEF int function_arity(char c) {
+    return c == '?' ? 3 : c == 'm' || c == 'M' ? 2 : 1;
+}
+
 // removes all whitespace from a string.
 PDEF char *eat_whitespace(char *input, int length) {
     int counter = 0;
-    char *a_string = calloc(length, sizeof(char));
+    char *a_string = calloc(length + 1, sizeof(char));
 
     for(int i = 0 ; i < length ; i++) {
         if(!isspace(input[i])) {
@@ -143,45 +264,72 @@ PDEF char *eat_whitespace(char *input, int length) {
 }
 
 // preprocessing done to input in order to produce a makestring.
-void preprocess(p_data *data) {
+PDEF void preprocess(p_data *data) {
     int length = strlen(data -> input);
-    data -> mkstr = (char *) calloc(length * 2, sizeof(char));
+    data -> mkstr = (char *) calloc(length * 2 + 1, sizeof(char));
+
+    // a profiled expression keeps where each character came from, through both passes.
+    int *b_origins = NULL;
+    if(data -> profiled) {
+        data -> origins = (int *) calloc(length * 2 + 1, sizeof(int));
+        b_origins = (int *) calloc(length + 2, sizeof(int));
+    }
 
-    // encodes trig functions.
-    char *b_string = (char *) calloc(length, sizeof(char));
+    // encodes functions, pi and comparisons. anything else that isn't accepted as it is makes the input invalid.
+    char *b_string = (char *) calloc(length + 2, sizeof(char));
     for(int i = 0, j = 0; j < length; i++, j++) {
-        if(isin(data -> input[j], "sctl")) {
-            if(encode_trig(data -> input + j) != '\0') {
-                b_string[i] = encode_trig(data -> input + j);
-                j+=2;
-            } else data -> state = STATE_err;
-        } else b_string[i] = data -> input[j];
+        char c = data -> input[j], next = data -> input[j+1];
+        int word;
+        if(b_origins != NULL)
+            b_origins[i] = j;
+        if(c == 'p' && next == 'i') {
+            b_string[i] = 'p';
+            j++;
+        } else if(isin(c, "<>=!") && next == '=') {
+            b_string[i] = c == '<' ? 'L' : c == '>' ? 'G' : c;
+            j++;
+        } else if(isalpha(c) && encode_function(data -> input + j, &word) != '\0') {
+            b_string[i] = encode_function(data -> input + j, &word);
+            j += word - 1;
+        } else if(isin(c, accepted_inputs)) {
+            b_string[i] = c;
+        } else data -> state = STATE_err;
     }
 
     // insert multiplication symbol where implied by mathematical notation: 2x, xsinx, 3(2-1), etc...
     for(int i = 0, j = 0; i < strlen(b_string); i++, j++) {
         // each conditional here is an edge case that needed to be worked out by hand.
-        if((isin(b_string[i+1], "sScCtTl"       ) && !isin(b_string[i]  , "sScCtTl({[/+-*^"        ))
-        || (isin(b_string[i+1], "([{"           ) && !isin(b_string[i]  , "([{sScCtTl/+-*^"        ))
-        || (isin(b_string[i]  , ")}]"           ) &&  isin(b_string[i+1], "([{xpesScCtTl1234567890"))
-        || (isin(b_string[i]  , "0123456789."   ) &&  isin(b_string[i+1], "([{xsScCtTlpe"          ))
-        || (isin(b_string[i]  , "xpe"           ) &&  isin(b_string[i+1], "0123456789sScCtTl([{x"  ))) {
+        if((isin(b_string[i+1], "sScCtTlamM?"   ) && !isin(b_string[i]  , "sScCtTlamM?({[/+-*^,<>LG=!"  ))
+        || (isin(b_string[i+1], "([{"           ) && !isin(b_string[i]  , "([{sScCtTlamM?/+-*^,<>LG=!"  ))
+        || (isin(b_string[i]  , ")}]"           ) &&  isin(b_string[i+1], "([{xypesScCtTlamM?1234567890"))
+        || (isin(b_string[i]  , "0123456789."   ) &&  isin(b_string[i+1], "([{xysScCtTlamM?pe"          ))
+        || (isin(b_string[i]  , "xype"          ) &&  isin(b_string[i+1], "0123456789sScCtTlamM?([{xy"  ))) {
 
             data -> mkstr[j] = b_string[i]; j++;
             data -> mkstr[j] = '*';
+            if(b_origins != NULL) {
+                data -> origins[j - 1] = b_origins[i];
+                data -> origins[j] = -1;
+            }
 
-        } else { data -> mkstr[j] = b_string[i]; }
+        } else {
+            data -> mkstr[j] = b_string[i];
+            if(b_origins != NULL)
+                data -> origins[j] = b_origins[i];
+        }
     } free(b_string);
+    free(b_origins);
 
 }
 
 // returns the current state of the parser based on the type of the character that is being parsed.
 PDEF p_state identify(char c) {
     if(isin(c, function_shorthand))             return STATE_trg;
-    else if(isin(c, "^+/*-"))                   return STATE_opr;
+    else if(isin(c, "^+/*-<>LG=!"))             return STATE_opr;
+    else if(c == ',')                           return STATE_sep;
     else if(isin(c, "pe"))                      return STATE_con;
     else if(isin(c, "()[]{}"))                  return STATE_par;
-    else if(c == 'x')                           return STATE_var;
+    else if(c == 'x' || c == 'y')               return STATE_var;
     else if((c >= '0' && c <= '9') || c == '.') return STATE_num;
     else if(c == '\0' || c == '\n')             return STATE_end;
     return STATE_err;
@@ -225,7 +373,12 @@ PDEF void tokenize(p_data *data) {
             case STATE_con:
                 data -> types[data -> token_pos] = TYPE_con;
                 add_ctoken(data, curstr[0]);
-                if(curstr[0] == 'p') data -> pos++;
+                data -> state = STATE_str; break;
+
+            // commas separate the arguments of functions that take more than one.
+            case STATE_sep:
+                data -> types[data -> token_pos] = TYPE_sep;
+                add_ctoken(data, curstr[0]);
                 data -> state = STATE_str; break;
 
 
@@ -238,14 +391,15 @@ PDEF void tokenize(p_data *data) {
             // operations are treated as single-character tokens.
             case STATE_opr:
                 // if the operation is a negative, then it could potentially be the start of a negative number and not part of an operation.
-                if(curstr[0] == '-' && (data -> pos == 0 || !isin(data -> mkstr[ + data -> pos - 1], "1234567890)]}xpe"))) {
+                if(curstr[0] == '-' && (data -> pos == 0 || !isin(data -> mkstr[ + data -> pos - 1], "1234567890)]}xype"))) {
 
-                    // this is handled by adding a zero token to the token array and then treating the negative as an operator.
+                    // this is handled by adding a zero token to the token array and then treating the negative as an
+                    // operator, '~', that binds tighter than the others and is subtracted once it's assembled.
                     data -> types[data -> token_pos] = TYPE_num;
                     add_ctoken(data, '0');
                     data -> pos--;
                     data -> types[data -> token_pos] = TYPE_opr;
-                    add_ctoken(data, curstr[0]);
+                    add_ctoken(data, '~');
                     data -> state = STATE_str;
                 } else {
                     data -> types[data -> token_pos] = TYPE_opr;
@@ -262,79 +416,92 @@ PDEF void tokenize(p_data *data) {
     }
 }
 
-// the order of operations starting from exponents. parentheses will be handled using a stack.
-int operation_order(char operation) {
-    int output = 0;
-    char *order_of_operations = "^*/+-";
-    while(operation != order_of_operations[output])
-        output++;
-    return output;
+// the precedence of an operation, higher binds tighter. comparisons bind loosest, and negation binds tighter than
+// everything but powers, so that -x^2 is -(x^2) while 2*-x is 2*(-x). functions written without parentheses bind like
+// negation (sinx^2 is sin(x^2), but sinx+1 is sin(x)+1).
+PDEF int precedence(char operation) {
+    if(operation == '^')                                            return 4;
+    else if(operation == '~' || isin(operation, function_shorthand)) return 3;
+    else if(isin(operation, "*/"))                                  return 2;
+    else if(isin(operation, "+-"))                                  return 1;
+    return 0;
+}
+
+// frees the arrays of infix_to_postfix() before it fails, the tokens themselves are still the data's.
+PDEF void postfix_error(char **output, char **stack, int *commas, char *message) {
+    free(output);
+    free(stack);
+    free(commas);
+    throw_error(message);
 }
 
 // converts the tokens from infix notation (x+2, 2x^3, sin(cos(x)), etc..) to postfix notation (x2+, 2x3^*, xcs, etc...).
+// the arguments of if(c, a, b) are separated by jumps instead of commas, c j a J b ?, so that the scalar evaluator
+// can skip the branch that isn't taken.
 PDEF void infix_to_postfix(p_data *data) {
-    int length = strlen(data -> mkstr);
-    char **output = (char **) calloc(length, sizeof(char*));
-    char **stack  = (char **) calloc(length, sizeof(char*));
-    int top = 0, output_position = 0, pcount = 0;
+    char **output = (char **) calloc(data -> token_cnt + 1, sizeof(char*));
+    char **stack  = (char **) calloc(data -> token_cnt + 1, sizeof(char*));
+    int *commas   = (int *) calloc(data -> token_cnt + 1, sizeof(int));
+    int top = -1, output_position = 0, pcount = 0;
+    char message[MAX_LENGTH];
 
     if(data -> state == STATE_err) {
-        throw_error("invalid token");
+        postfix_error(output, stack, commas, "invalid token");
     } data -> state = STATE_str;
 
     // loops to the end of token array.
     for( ; data -> token_pos < data -> token_cnt ; data -> token_pos++) {
+        char *token = data -> tokens[data -> token_pos];
         switch(data -> types[data -> token_pos]) {
 
-            // numbers are appended immediately to the output.
+            // numbers, variables and constants are appended immediately to the output.
             case TYPE_num:
-                output[output_position] = data -> tokens[data -> token_pos];
+            case TYPE_var:
+            case TYPE_con:
+                output[output_position] = token;
                 output_position++;
                 break;
 
-            // operations are appended to the stack in order of priority.
+            // operations first move the operations on the stack that bind at least as tight to the output. powers are
+            // right associative (2^3^2 is 2^9), and a negation applies to what comes after it, so it moves nothing.
             case TYPE_opr:
-                if(!(stack[top])) {
-                    stack[top] = data -> tokens[data -> token_pos];
-                } else if(isin(stack[top][0], "[{(")) {
-                    top++;
-                    stack[top] = data -> tokens[data -> token_pos];
-                } else if(operation_order(data -> tokens[data -> token_pos][0]) > operation_order(stack[top][0])) {
+                while(token[0] != '~' && top >= 0 && !isin(stack[top][0], "[{(")
+                    && (precedence(stack[top][0]) > precedence(token[0]) || (precedence(stack[top][0]) == precedence(token[0]) && token[0] != '^'))) {
                     output[output_position] = stack[top];
-                    stack[top] = data -> tokens[data -> token_pos];
+                    top--;
                     output_position++;
-                } else {
-                    top++;
-                    stack[top] = data -> tokens[data -> token_pos];
                 }
-                break;
-
-            // variables are treated as numbers.
-            case TYPE_var:
-                output[output_position] = data -> tokens[data -> token_pos];
-                output_position++;
-                break;
-
-            case TYPE_con:
-                output[output_position] = data -> tokens[data -> token_pos];
-                output_position++;
+                stack[++top] = token;
                 break;
 
             // open parentheses are added to the stack, close parentheses initiate a loop that adds to the output until the open parentheses is found.
             case TYPE_par:
-                if(isin(data -> tokens[data -> token_pos][0], "[{(")) {
-                    if(stack[top])
-                        top++;
-                    stack[top] = data -> tokens[data -> token_pos];
+                if(isin(token[0], "[{(")) {
+                    stack[++top] = token;
+                    commas[top] = 0;
                 } else {
-                    while(!isin(stack[top][0], "[{(")) {
+                    while(top >= 0 && !isin(stack[top][0], "[{(")) {
                         output[output_position] = stack[top];
                         top--;
                         output_position++;
                     }
+
+                    if(top < 0)
+                        postfix_error(output, stack, commas, "mismatched parentheses");
+
+                    // a function takes one more argument than there are commas between its parentheses.
+                    int arguments = commas[top] + 1;
+                    bool function = top >= 1 && isin(stack[top-1][0], function_shorthand);
+                    if(function && arguments != function_arity(stack[top-1][0])) {
+                        snprintf(message, sizeof(message), "%s takes %i argument%s", accepted_functions[strchr(function_shorthand, stack[top-1][0]) - function_shorthand],
+                            function_arity(stack[top-1][0]), function_arity(stack[top-1][0]) == 1 ? "" : "s");
+                        postfix_error(output, stack, commas, message);
+                    }
+
+                    // matched parentheses don't make it to the output.
                     top--;
 
-                    if(top >= 0 && isin(stack[top][0], "sScCtTl")) {
+                    if(function) {
                         output[output_position] = stack[top];
                         top--;
                         output_position++;
@@ -342,175 +509,787 @@ PDEF void infix_to_postfix(p_data *data) {
                 } pcount++;
                 break;
 
-            // trig functions are appended to the stack, and effectively treated as operations until the expression is evaluated.
+            // commas end an argument, so everything since the open parenthesis goes to the output. the commas of if()
+            // become its jumps, the rest don't make it to the output.
+            case TYPE_sep:
+                while(top >= 0 && !isin(stack[top][0], "[{(")) {
+                    output[output_position] = stack[top];
+                    top--;
+                    output_position++;
+                }
+
+                if(top < 1 || !isin(stack[top-1][0], function_shorthand) || ++commas[top] >= function_arity(stack[top-1][0]))
+                    postfix_error(output, stack, commas, "misplaced ','");
+
+                if(stack[top-1][0] == '?') {
+                    token[0] = commas[top] == 1 ? 'j' : 'J';
+                    output[output_position] = token;
+                    output_position++;
+                } else pcount++;
+                break;
+
+            // functions are appended to the stack, and effectively treated as operations until the expression is evaluated.
             case TYPE_trg:
-                top++;
-                stack[top] = data -> tokens[data -> token_pos];
+                stack[++top] = token;
                 break;
             }
         }
 
     // adds whatever operations are in the stack to the output.
     while(top > -1) {
+        if(isin(stack[top][0], "[{("))
+            postfix_error(output, stack, commas, "mismatched parentheses");
+
         output[output_position] = stack[top];
         top--;
         output_position++;
     }
 
+    // the sources follow their tokens to the output.
+    if(data -> sources != NULL) {
+        int *sources = (int *) calloc(data -> token_cnt + 1, sizeof(int));
+        for(int i = 0 ; i < output_position ; i++)
+            for(int k = 0 ; k < data -> token_cnt ; k++)
+                if(data -> tokens[k] == output[i]) {
+                    sources[i] = data -> sources[k];
+                    break;
+                }
+        free(data -> sources);
+        data -> sources = sources;
+    }
+
+    // the parentheses and commas that didn't make it to the output are freed once nothing can go wrong, so that an
+    // error frees every token once.
+    for(int i = 0 ; i < data -> token_cnt ; i++)
+        if(data -> types[i] == TYPE_par || (data -> types[i] == TYPE_sep && data -> tokens[i][0] == ','))
+            free(data -> tokens[i]);
+
+    free(data -> tokens);
+    free(stack);
+    free(commas);
+
     data -> tokens = output;
     data -> token_cnt -= pcount;
     data -> token_pos = 0;
 }
 
-// evaluates the postfix string.
-PDEF long double evaluate(long double xvalue, p_data *data, long double base) {
-    long double *stack = calloc(data -> token_cnt, sizeof(long double));
-    bool *states = calloc(data -> token_cnt, sizeof(bool));
-    int top = 0;
+// turns the postfix tokens into a program of instructions so that numbers are only parsed once.
+PDEF void assemble(p_data *data) {
+    data -> program = (p_instr *) calloc(data -> token_cnt + 1, sizeof(p_instr));
+    data -> program_len = data -> token_cnt;
+    data -> stack_depth = 0;
+    data -> valid = true;
+
+    // the stack depth of a postfix program does not depend on x, so underflows can be found ahead of time.
+    int depth = 0;
+    for(int i = 0 ; i < data -> token_cnt ; i++) {
+        p_instr *instr = &data -> program[i];
+        char c = data -> tokens[i] != NULL ? data -> tokens[i][0] : '\0';
+
+        if(c == 'x' || c == 'y') {
+            instr -> op = c;
+            depth++;
+        } else if(c == 'p') {
+            instr -> op = 'n';
+            instr -> value = atan(1) * 4;
+            depth++;
+        } else if(c == 'e') {
+            instr -> op = 'n';
+            instr -> value = exp(1);
+            depth++;
+        } else if(isin(c, "1234567890.")) {
+            instr -> op = 'n';
+            instr -> value = atof(data -> tokens[i]);
+            depth++;
+        } else if(isin(c, "+-/^*~<>LG=!")) {
+            instr -> op = c == '~' ? '-' : c;
+            if(depth < 2)
+                data -> valid = false;
+            depth--;
+        } else if(isin(c, function_shorthand)) {
+            instr -> op = c;
+            if(depth < function_arity(c))
+                data -> valid = false;
+            depth -= function_arity(c) - 1;
+        } else if(c == 'j' || c == 'J') {
+            // jumps land at the end until link_jumps() points them at their branches.
+            instr -> op = c;
+            instr -> value = data -> token_cnt;
+        } else {
+            instr -> op = c;
+            data -> valid = false;
+        }
 
-    // loops through until the end of the token array.
-    for( ; data -> token_pos < data -> token_cnt ; data -> token_pos++) {
-        // if it is an operand, it gets pushed to the stack.
-        if(isin(data -> tokens[data -> token_pos][0], "1234567890.xpe")) {
-            if(states[top])
-                top++;
+        if(depth > data -> stack_depth)
+            data -> stack_depth = depth;
+    }
+}
+
+// compares two values, 1 when the comparison holds and 0 when it doesn't (or either value is nan, except for !=).
+PDEF long double compare(char op, long double a, long double b) {
+    switch(op) {
+        case '<': return a < b;
+        case '>': return a > b;
+        case 'L': return a <= b;
+        case 'G': return a >= b;
+        case '=': return a == b;
+        case '!': return a != b;
+    }
+    return 0;
+}
+
+// folds the instructions whose operands are all constants into a constant, so that what's constant (inlined
+// variables in particular) is computed once when compiling instead of at every evaluation. in a postfix program an
+// instruction's operands are constants exactly when the instructions right before it push constants. log() isn't
+// folded, since it depends on the base at evaluation time.
+PDEF void fold_constants(p_data *data) {
+    if(!data -> valid)
+        return;
 
-            // x is substituted for the x value and pushed to the stack.
-            if(data -> tokens[data -> token_pos][0] == 'x') {
-                stack[top] = xvalue;
-                states[top] = true;
-            } else if(data -> tokens[data -> token_pos][0] == 'p') {
-                stack[top] = atan(1) * 4;
-                states[top] = true;
-            } else if(data -> tokens[data -> token_pos][0] == 'e') {
-                stack[top] = exp(1);
-                states[top] = true;
-            } else {
-                stack[top] = atof(data -> tokens[data -> token_pos]);
-                states[top] = true;
+    int length = 0;
+    for(int i = 0 ; i < data -> program_len ; i++) {
+        p_instr instr = data -> program[i];
+        p_instr *a = length >= 2 ? &data -> program[length - 2] : NULL;
+        p_instr *b = length >= 1 ? &data -> program[length - 1] : NULL;
+
+        // the arithmetic is the same as evaluate()'s, so that folding doesn't change any result.
+        if(isin(instr.op, "+-*/^<>LG=!mM") && a != NULL && a -> op == 'n' && b -> op == 'n') {
+            switch(instr.op) {
+                case '+': a -> value = b -> value + a -> value;                       break;
+                case '-': a -> value = a -> value - b -> value;                       break;
+                case '*': a -> value = b -> value * a -> value;                       break;
+                case '/': a -> value = a -> value / b -> value;                       break;
+                case '^': a -> value = (long double) pow(a -> value, b -> value);     break;
+                case 'm': a -> value = fminl(a -> value, b -> value);                 break;
+                case 'M': a -> value = fmaxl(a -> value, b -> value);                 break;
+                default:  a -> value = compare(instr.op, a -> value, b -> value);     break;
             }
-            } else if(isin(data -> tokens[data -> token_pos][0], "+-/^*sScCtTl")) {
-                // if it is an operator, the operator is carried out with the top two items of the stack.
-                switch(data -> tokens[data -> token_pos][0]) {
-                case '+':
-                    if(top-1 < 0)
-                        throw_error("invalid operation");
-
-                    long double sum = stack[top] + stack[top-1];
-                    top--;
-                    stack[top] = sum;
-                break;
+            length--;
+        } else if(isin(instr.op, "sScCtTa") && b != NULL && b -> op == 'n') {
+            switch(instr.op) {
+                case 's': b -> value = (long double) sin(b -> value);         break;
+                case 'S': b -> value = (long double) (1/sin(b -> value));     break;
+                case 'c': b -> value = (long double) cos(b -> value);         break;
+                case 'C': b -> value = (long double) (1 / cos(b -> value));   break;
+                case 't': b -> value = (long double) tan(b -> value);         break;
+                case 'T': b -> value = (long double) (1 / tan(b -> value));   break;
+                case 'a': b -> value = fabsl(b -> value);                     break;
+            }
+        } else data -> program[length++] = instr;
+    }
+    data -> program_len = length;
 
-                case '-':
-                    if(top-1 < 0)
-                        throw_error("invalid operation");
+    // folding only ever shortens the stack.
+    int depth = 0;
+    data -> stack_depth = 0;
+    for(int i = 0 ; i < length ; i++) {
+        char op = data -> program[i].op;
+        depth += op == 'x' || op == 'y' || op == 'n' ? 1 : isin(op, "+-*/^<>LG=!mM") ? -1 : op == '?' ? -2 : 0;
+        if(depth > data -> stack_depth)
+            data -> stack_depth = depth;
+    }
+}
 
-                    long double difference = stack[top-1] - stack[top];
-                    top--;
-                    stack[top] = difference;
+// points the jumps of every if(c, a, b), c j a J b ?, at where they land: j (taken when c is 0) at the start of b,
+// and J at the instruction after the select. ifs nest, so the jumps that are still open are kept on a stack.
+PDEF void link_jumps(p_data *data) {
+    if(!data -> valid)
+        return;
+
+    int *open = (int *) malloc((data -> program_len + 1) * sizeof(int)), top = 0;
+    for(int i = 0 ; i < data -> program_len && data -> valid ; i++) {
+        char op = data -> program[i].op;
+        if(op == 'j')
+            open[top++] = i;
+        else if(op == 'J' || op == '?') {
+            if(top == 0 || data -> program[open[top - 1]].op != (op == 'J' ? 'j' : 'J')) {
+                data -> valid = false;
                 break;
+            }
+            data -> program[open[--top]].value = i + 1;
+            if(op == 'J')
+                open[top++] = i;
+        }
+    }
 
-                case '*':
-                    if(top-1 < 0)
-                        throw_error("invalid operation");
+    if(top != 0)
+        data -> valid = false;
+    free(open);
+}
 
-                    long double product = stack[top] * stack[top-1];
-                    top--;
-                    stack[top] = product;
-                break;
+// evaluates a polynomial with horner's scheme.
+PDEF long double evaluate_polynomial(long double xvalue, p_data *data) {
+    long double output = data -> coefficients[data -> degree];
+    for(int k = data -> degree - 1 ; k >= 0 ; k--)
+        output = output * xvalue + data -> coefficients[k];
+    return output;
+}
 
-                case '/':
-                    if(top-1 < 0)
-                        throw_error("invalid operation");
+// evaluates the exact derivative of a polynomial with horner's scheme.
+PDEF long double derive_polynomial(long double xvalue, p_data *data) {
+    long double output = 0;
+    for(int k = data -> degree ; k >= 1 ; k--)
+        output = output * xvalue + k * data -> coefficients[k];
+    return output;
+}
 
-                    long double quotient = stack[top-1] / stack[top];
-                    top--;
-                    stack[top] = quotient;
-                break;
+// evaluates the antiderivative of a polynomial (with a constant of zero) with horner's scheme.
+PDEF long double antiderive_polynomial(long double xvalue, p_data *data) {
+    long double output = 0;
+    for(int k = data -> degree ; k >= 0 ; k--)
+        output = output * xvalue + data -> coefficients[k] / (k + 1);
+    return output * xvalue;
+}
 
-                case '^':
-                    if(top-1 < 0)
-                        throw_error("invalid operation");
+// counts evaluations of a program for /stats, by the instructions that they run or as polynomials.
+PDEF void count_program(p_data *data, long count) {
+    if(data -> polynomial) {
+        instrument_add(calc_instrument.polynomial_evaluations, count);
+        return;
+    }
 
-                    long double result = (long double) pow(stack[top-1], stack[top]);
-                    top--;
-                    stack[top] = result;
-                break;
+    for(int i = 0 ; i < data -> program_len ; i++)
+        instrument_add(calc_instrument.opcodes[data -> program[i].op & 127], count);
+}
+
+// evaluates the assembled program at a point (x, y).
+PDEF long double evaluate_xy(long double xvalue, long double yvalue, p_data *data, long double base) {
+    if(instrumenting()) {
+        instrument_add(calc_instrument.evaluations, 1);
+        count_program(data, 1);
+    }
 
-                // if it is a trig function, it is treated like an operator and is performed on the top item of the stack.
-                case 's':
-                    if(!states[top])
-                        throw_error("invalid sin");
+    if(data -> polynomial)
+        return evaluate_polynomial(xvalue, data);
+
+    long double stack[data -> stack_depth + 1];
+    int top = -1;
 
-                    stack[top] = (long double) sin(stack[top]);
-                break;
+    // loops through until the end of the program.
+    for(int i = 0 ; i < data -> program_len ; i++) {
+        p_instr *instr = &data -> program[i];
+        switch(instr -> op) {
+            // operands get pushed to the stack, x and y are substituted for their values.
+            case 'x':
+                stack[++top] = xvalue;
+            break;
+
+            case 'y':
+                stack[++top] = yvalue;
+            break;
+
+            case 'n':
+                stack[++top] = instr -> value;
+            break;
+
+            // if it is an operator, the operator is carried out with the top two items of the stack.
+            case '+':
+                if(top-1 < 0)
+                    throw_error("invalid operation");
 
-                case 'S':
-                    if(!states[top])
-                        throw_error("invalid csc");
+                top--;
+                stack[top] = stack[top+1] + stack[top];
+            break;
 
-                    stack[top] = (long double) (1/sin(stack[top]));
-                break;
+            case '-':
+                if(top-1 < 0)
+                    throw_error("invalid operation");
 
-                case 'c':
-                    if(!states[top])
-                        throw_error("invalid cos");
+                top--;
+                stack[top] = stack[top] - stack[top+1];
+            break;
 
-                    stack[top] = (long double) cos(stack[top]);
-                break;
+            case '*':
+                if(top-1 < 0)
+                    throw_error("invalid operation");
 
-                case 'C':
-                    if(!states[top])
-                        throw_error("invalid sec");
+                top--;
+                stack[top] = stack[top+1] * stack[top];
+            break;
 
-                    stack[top] = (long double) (1 / cos(stack[top]));
-                break;
+            case '/':
+                if(top-1 < 0)
+                    throw_error("invalid operation");
 
-                case 't':
-                    if(!states[top])
-                        throw_error("invalid tan");
+                top--;
+                stack[top] = stack[top] / stack[top+1];
+            break;
 
-                    stack[top] = (long double) tan(stack[top]);
-                break;
+            case '^':
+                if(top-1 < 0)
+                    throw_error("invalid operation");
 
-                case 'T':
-                    if(!states[top])
-                        throw_error("invalid cot");
+                top--;
+                stack[top] = (long double) pow(stack[top], stack[top+1]);
+            break;
 
-                    stack[top] = (long double) (1 / tan(stack[top]));
-                break;
+            case '<': case '>': case 'L': case 'G': case '=': case '!':
+                if(top-1 < 0)
+                    throw_error("invalid comparison");
+
+                top--;
+                stack[top] = compare(instr -> op, stack[top], stack[top+1]);
+            break;
+
+            case 'm':
+                if(top-1 < 0)
+                    throw_error("invalid min");
+
+                top--;
+                stack[top] = fminl(stack[top], stack[top+1]);
+            break;
+
+            case 'M':
+                if(top-1 < 0)
+                    throw_error("invalid max");
+
+                top--;
+                stack[top] = fmaxl(stack[top], stack[top+1]);
+            break;
+
+            // only the branch of an if that is taken is evaluated: j skips to the else branch when the condition is
+            // 0, and J skips over the else branch at the end of the then branch, so the select is left with nothing
+            // to do.
+            case 'j':
+                if(top < 0 || !data -> valid)
+                    throw_error("invalid if");
 
-                case 'l':
-                    if(!states[top])
+                if(stack[top--] == 0)
+                    i = (int) instr -> value - 1;
+            break;
+
+            case 'J':
+                if(!data -> valid)
+                    throw_error("invalid if");
+
+                i = (int) instr -> value - 1;
+            break;
+
+            case '?':
+            break;
+
+            // if it is a trig function, it is treated like an operator and is performed on the top item of the stack.
+            case 's':
+                if(top < 0)
+                    throw_error("invalid sin");
+
+                stack[top] = (long double) sin(stack[top]);
+            break;
+
+            case 'S':
+                if(top < 0)
+                    throw_error("invalid csc");
+
+                stack[top] = (long double) (1/sin(stack[top]));
+            break;
+
+            case 'c':
+                if(top < 0)
+                    throw_error("invalid cos");
+
+                stack[top] = (long double) cos(stack[top]);
+            break;
+
+            case 'C':
+                if(top < 0)
+                    throw_error("invalid sec");
+
+                stack[top] = (long double) (1 / cos(stack[top]));
+            break;
+
+            case 't':
+                if(top < 0)
+                    throw_error("invalid tan");
+
+                stack[top] = (long double) tan(stack[top]);
+            break;
+
+            case 'T':
+                if(top < 0)
+                    throw_error("invalid cot");
+
+                stack[top] = (long double) (1 / tan(stack[top]));
+            break;
+
+            case 'l':
+                if(top < 0)
                     throw_error("invalid log");
 
-                    stack[top] = (long double) (log(stack[top])/log(base));
-                break;
+                stack[top] = (long double) (log(stack[top])/log(base));
+            break;
 
-            }
-        } else {
-            throw_error("syntax");
+            case 'a':
+                if(top < 0)
+                    throw_error("invalid abs");
+
+                stack[top] = fabsl(stack[top]);
+            break;
+
+            default:
+                throw_error("syntax");
         }
     }
 
-    data -> token_pos = 0;
-    return stack[top];
+    return top < 0 ? 0 : stack[top];
+}
+
+// evaluates the assembled program, with y as 0 for functions of x alone.
+PDEF long double evaluate(long double xvalue, p_data *data, long double base) {
+    return evaluate_xy(xvalue, 0, data, base);
+}
+
+// runs one instruction over a block of length values, on a stack with a row of BATCH_SIZE values for each of its
+// entries, and returns the new top of the stack.
+PDEF int batch_step(p_instr *instr, long double *stack, int top, const long double *xvalues, long double yvalue, int length, double log_base) {
+    char op = instr -> op;
+
+    // operands fill the next row of the stack.
+    if(op == 'x' || op == 'y' || op == 'n') {
+        top++;
+        long double *a = stack + top * BATCH_SIZE;
+        long double value = op == 'y' ? yvalue : instr -> value;
+        if(op == 'x')
+            memcpy(a, xvalues, length * sizeof(long double));
+        else for(int j = 0 ; j < length ; j++)
+            a[j] = value;
+        return top;
+    }
+
+    // both branches of an if are evaluated for the whole block, so the jumps do nothing and the select picks
+    // a branch for every value without branching.
+    if(op == 'j' || op == 'J')
+        return top;
+
+    if(op == '?') {
+        top -= 2;
+        long double *c = stack + top * BATCH_SIZE, *a = c + BATCH_SIZE, *b = a + BATCH_SIZE;
+        for(int j = 0 ; j < length ; j++)
+            c[j] = c[j] != 0 ? a[j] : b[j];
+        return top;
+    }
+
+    long double *a = stack + (isin(op, "+-*/^<>LG=!mM") ? --top : top) * BATCH_SIZE;
+    long double *b = a + BATCH_SIZE;
+    switch(op) {
+        case '+': for(int j = 0 ; j < length ; j++) a[j] = b[j] + a[j];                          break;
+        case '-': for(int j = 0 ; j < length ; j++) a[j] = a[j] - b[j];                          break;
+        case '*': for(int j = 0 ; j < length ; j++) a[j] = b[j] * a[j];                          break;
+        case '/': for(int j = 0 ; j < length ; j++) a[j] = a[j] / b[j];                          break;
+        case '^': for(int j = 0 ; j < length ; j++) a[j] = (long double) pow(a[j], b[j]);        break;
+        case 's': for(int j = 0 ; j < length ; j++) a[j] = (long double) sin(a[j]);              break;
+        case 'S': for(int j = 0 ; j < length ; j++) a[j] = (long double) (1/sin(a[j]));          break;
+        case 'c': for(int j = 0 ; j < length ; j++) a[j] = (long double) cos(a[j]);              break;
+        case 'C': for(int j = 0 ; j < length ; j++) a[j] = (long double) (1 / cos(a[j]));        break;
+        case 't': for(int j = 0 ; j < length ; j++) a[j] = (long double) tan(a[j]);              break;
+        case 'T': for(int j = 0 ; j < length ; j++) a[j] = (long double) (1 / tan(a[j]));        break;
+        case 'l': for(int j = 0 ; j < length ; j++) a[j] = (long double) (log(a[j])/log_base);   break;
+        case 'a': for(int j = 0 ; j < length ; j++) a[j] = fabsl(a[j]);                         break;
+        case 'm': for(int j = 0 ; j < length ; j++) a[j] = fminl(a[j], b[j]);                   break;
+        case 'M': for(int j = 0 ; j < length ; j++) a[j] = fmaxl(a[j], b[j]);                   break;
+        case '<': for(int j = 0 ; j < length ; j++) a[j] = a[j] < b[j];                          break;
+        case '>': for(int j = 0 ; j < length ; j++) a[j] = a[j] > b[j];                          break;
+        case 'L': for(int j = 0 ; j < length ; j++) a[j] = a[j] <= b[j];                         break;
+        case 'G': for(int j = 0 ; j < length ; j++) a[j] = a[j] >= b[j];                         break;
+        case '=': for(int j = 0 ; j < length ; j++) a[j] = a[j] == b[j];                         break;
+        case '!': for(int j = 0 ; j < length ; j++) a[j] = a[j] != b[j];                         break;
+    }
+    return top;
+}
+
+// evaluates the program at n x values. instead of walking the program once per value, every instruction is
+// applied to a whole block of BATCH_SIZE values, so the dispatch cost is paid once per block. y is the same for every
+// value, which is how grids are evaluated a row at a time.
+PDEF void evaluate_batch_xy(p_data *data, const long double *xvalues, long double yvalue, long double *output, int n, long double base) {
+    // malformed programs are counted by evaluate().
+    if(instrumenting()) {
+        instrument_add(calc_instrument.batches, 1);
+        instrument_add(calc_instrument.batch_values, n);
+        if(data -> polynomial || (data -> valid && data -> program_len > 0))
+            count_program(data, n);
+    }
+
+    // polynomials are evaluated coefficient by coefficient over the block, each lane is independent.
+    if(data -> polynomial) {
+        long double *c = data -> coefficients;
+        for(int start = 0 ; start < n ; start += BATCH_SIZE) {
+            int length = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+            const long double *x = xvalues + start;
+            long double *y = output + start;
+
+            for(int j = 0 ; j < length ; j++)
+                y[j] = c[data -> degree];
+            for(int k = data -> degree - 1 ; k >= 0 ; k--)
+                for(int j = 0 ; j < length ; j++)
+                    y[j] = y[j] * x[j] + c[k];
+        }
+        return;
+    }
+
+    // malformed programs go through the scalar evaluator so that the error is reported the same way.
+    if(!data -> valid || data -> program_len == 0) {
+        for(int i = 0 ; i < n ; i++)
+            output[i] = evaluate_xy(xvalues[i], yvalue, data, base);
+        return;
+    }
+
+    long double *stack = (long double *) malloc(data -> stack_depth * BATCH_SIZE * sizeof(long double));
+    double log_base = log(base);
+
+    for(int start = 0 ; start < n ; start += BATCH_SIZE) {
+        int length = n - start < BATCH_SIZE ? n - start : BATCH_SIZE;
+        int top = -1;
+
+        for(int i = 0 ; i < data -> program_len ; i++)
+            top = batch_step(&data -> program[i], stack, top, xvalues + start, yvalue, length, log_base);
+
+        memcpy(output + start, stack + top * BATCH_SIZE, length * sizeof(long double));
+    }
+
+    free(stack);
+}
+
+// evaluates the program at n x values, with y as 0.
+PDEF void evaluate_batch(p_data *data, const long double *xvalues, long double *output, int n, long double base) {
+    evaluate_batch_xy(data, xvalues, 0, output, n, base);
+}
+
+// attempts to reduce the program to a single polynomial in x by running it on coefficient vectors instead of numbers.
+// only +, -, *, division by a constant and non-negative integer powers of x are reducible, anything else (including
+// log, which depends on the base at evaluation time) leaves the expression on the generic path.
+PDEF void detect_polynomial(p_data *data) {
+    data -> polynomial = false;
+    data -> degree = 0;
+    data -> coefficients = NULL;
+
+    if(!data -> valid || data -> program_len == 0)
+        return;
+
+    int terms = MAX_DEGREE + 1;
+    long double *stack = (long double *) calloc(data -> stack_depth * terms, sizeof(long double));
+    long double *product = (long double *) calloc(terms, sizeof(long double));
+    int *degrees = (int *) calloc(data -> stack_depth, sizeof(int));
+    bool reducible = true;
+    int top = -1;
+
+    for(int i = 0 ; i < data -> program_len && reducible ; i++) {
+        p_instr *instr = &data -> program[i];
+        long double *a, *b;
+
+        switch(instr -> op) {
+            case 'x':
+            case 'n':
+                top++;
+                a = stack + top * terms;
+                memset(a, 0, terms * sizeof(long double));
+                if(instr -> op == 'x') a[1] = 1;
+                else a[0] = instr -> value;
+                degrees[top] = instr -> op == 'x';
+            continue;
+
+            case '+':
+            case '-':
+                top--;
+                a = stack + top * terms;
+                b = a + terms;
+                for(int k = 0 ; k <= degrees[top+1] ; k++)
+                    a[k] = instr -> op == '+' ? b[k] + a[k] : a[k] - b[k];
+                if(degrees[top+1] > degrees[top])
+                    degrees[top] = degrees[top+1];
+            break;
+
+            case '*':
+                top--;
+                a = stack + top * terms;
+                b = a + terms;
+                if(degrees[top] + degrees[top+1] > MAX_DEGREE) {
+                    reducible = false;
+                    break;
+                }
+
+                memset(product, 0, terms * sizeof(long double));
+                for(int j = 0 ; j <= degrees[top] ; j++)
+                    for(int k = 0 ; k <= degrees[top+1] ; k++)
+                        product[j+k] += b[k] * a[j];
+                memcpy(a, product, terms * sizeof(long double));
+                degrees[top] += degrees[top+1];
+            break;
+
+            // only division by a nonzero constant keeps the expression a polynomial.
+            case '/':
+                top--;
+                a = stack + top * terms;
+                b = a + terms;
+                if(degrees[top+1] != 0 || b[0] == 0) {
+                    reducible = false;
+                    break;
+                }
+
+                for(int k = 0 ; k <= degrees[top] ; k++)
+                    a[k] = a[k] / b[0];
+            break;
+
+            // constant powers are folded, and powers of a single term (x^3, (2x)^3) are expanded by repeated
+            // multiplication. a power of a base with more terms stays on the generic path, since expanding (x-c)^n
+            // leaves coefficients that cancel each other near c and lose the value to rounding there.
+            case '^':
+                top--;
+                a = stack + top * terms;
+                b = a + terms;
+                if(degrees[top+1] != 0) {
+                    reducible = false;
+                    break;
+                }
+
+                if(degrees[top] == 0) {
+                    a[0] = (long double) pow(a[0], b[0]);
+                    break;
+                }
+
+                int base_terms = 0;
+                for(int k = 0 ; k <= degrees[top] ; k++)
+                    base_terms += a[k] != 0;
+                if(base_terms > 1 && b[0] != 1) {
+                    reducible = false;
+                    break;
+                }
+
+                if(b[0] < 0 || b[0] != floorl(b[0]) || degrees[top] * b[0] > MAX_DEGREE) {
+                    reducible = false;
+                    break;
+                }
+
+                int exponent = (int) b[0];
+                long double *power = b;
+                memcpy(power, a, terms * sizeof(long double));
+                memset(a, 0, terms * sizeof(long double));
+                a[0] = 1;
+
+                int power_degree = degrees[top];
+                degrees[top] = 0;
+                for(int e = 0 ; e < exponent ; e++) {
+                    memset(product, 0, terms * sizeof(long double));
+                    for(int j = 0 ; j <= degrees[top] ; j++)
+                        for(int k = 0 ; k <= power_degree ; k++)
+                            product[j+k] += power[k] * a[j];
+                    memcpy(a, product, terms * sizeof(long double));
+                    degrees[top] += power_degree;
+                }
+            break;
+
+            // trig functions of constants are folded into constants.
+            case 's': case 'S': case 'c': case 'C': case 't': case 'T':
+                a = stack + top * terms;
+                if(degrees[top] != 0) {
+                    reducible = false;
+                    break;
+                }
+
+                switch(instr -> op) {
+                    case 's': a[0] = (long double) sin(a[0]);         break;
+                    case 'S': a[0] = (long double) (1/sin(a[0]));     break;
+                    case 'c': a[0] = (long double) cos(a[0]);         break;
+                    case 'C': a[0] = (long double) (1 / cos(a[0]));   break;
+                    case 't': a[0] = (long double) tan(a[0]);         break;
+                    case 'T': a[0] = (long double) (1 / tan(a[0]));   break;
+                }
+            break;
+
+            default:
+                reducible = false;
+        }
+
+        // cancelled leading terms lower the degree (x^2-x^2+x is linear).
+        if(reducible)
+            while(degrees[top] > 0 && stack[top * terms + degrees[top]] == 0)
+                degrees[top]--;
+    }
+
+    if(reducible && top == 0) {
+        data -> polynomial = true;
+        data -> degree = degrees[0];
+        data -> coefficients = (long double *) calloc(degrees[0] + 1, sizeof(long double));
+        memcpy(data -> coefficients, stack, (degrees[0] + 1) * sizeof(long double));
+    }
+
+    free(stack);
+    free(product);
+    free(degrees);
 }
 
 // compiles input data into a makestring and tokenizes the makestring
 PDEF void compile(p_data *data) {
-    preprocess(data);
+    double start = phase_begin();
 
-    data -> tokens = (char **) calloc(MAX_COMPLEXITY, sizeof(char *));
-    data -> types = (p_type *) calloc(MAX_COMPLEXITY, sizeof(p_type));
+    // definitions are inlined into the text first. the input keeps the text as it was typed.
+    char *typed = data -> input, message[MAX_LENGTH];
+    char *expanded = expand_definitions(&calc_definitions, typed, message, sizeof(message));
+    if(expanded == NULL)
+        throw_error(message);
+
+    // a profiled expression keeps the text with its definitions inlined instead, since that's where its sources point.
+    data -> input = expanded;
+    preprocess(data);
+    if(!data -> profiled) {
+        data -> input = typed;
+        if(expanded != typed)
+            free(expanded);
+    } else if(expanded != typed)
+        free(typed);
+    phase_end(PHASE_preprocess, start);
+
+    // every character of the makestring becomes at most two tokens (a negative sign becomes "0" and "-").
+    int capacity = 2 * strlen(data -> mkstr) + 1;
+    data -> tokens = (char **) calloc(capacity, sizeof(char *));
+    data -> types = (p_type *) calloc(capacity, sizeof(p_type));
+    if(data -> profiled)
+        data -> sources = (int *) calloc(capacity, sizeof(int));
     data -> pos = 0;
     data -> token_pos = 0;
 
+    start = phase_begin();
     tokenize(data);
+    phase_end(PHASE_tokenize, start);
 
     data -> token_cnt = data -> token_pos;
     data -> pos = 0;
     data -> token_pos = 0;
 
+    start = phase_begin();
     infix_to_postfix(data);
-}
\ No newline at end of file
+    phase_end(PHASE_postfix, start);
+
+    start = phase_begin();
+    assemble(data);
+    phase_end(PHASE_assemble, start);
+
+    // a profiled expression is evaluated as it was written, so that every part of it is timed.
+    start = phase_begin();
+    if(!data -> profiled)
+        fold_constants(data);
+    link_jumps(data);
+    phase_end(PHASE_fold, start);
+
+    start = phase_begin();
+    if(!data -> profiled)
+        detect_polynomial(data);
+    phase_end(PHASE_polynomial, start);
+
+    // all that an expression keeps once it's compiled is its input, its program and its coefficients. folding only
+    // ever shortens the program, so it gives back what it no longer needs.
+    release_tokens(data);
+    p_instr *program = (p_instr *) realloc(data -> program, (data -> program_len + 1) * sizeof(p_instr));
+    if(program != NULL)
+        data -> program = program;
+    int *sources = data -> sources != NULL ? (int *) realloc(data -> sources, (data -> program_len + 1) * sizeof(int)) : NULL;
+    if(sources != NULL)
+        data -> sources = sources;
+
+    data -> accounted = sizeof(p_data) + strlen(data -> input) + 1 + (data -> program_len + 1) * sizeof(p_instr)
+        + (data -> polynomial ? (data -> degree + 1) * sizeof(long double) : 0) + (data -> sources != NULL ? (data -> program_len + 1) * sizeof(int) : 0);
+    memory_acquire(MEMORY_expressions, data -> accounted);
+
+    // a program that doesn't assemble (an operator without its operands, like x+) is rejected here, so that it's
+    // never stored or saved and only ever reported once, not by every evaluation of it.
+    if(!data -> valid)
+        throw_error("invalid expression");
+}
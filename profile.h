@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+#ifndef RDEF
+#define RDEF static inline
+#endif
+
+// the amount of points an expression is profiled at, unless it's given.
+#ifndef PROFILE_SAMPLES
+#define PROFILE_SAMPLES 100000
+#endif
+
+// a node of a profiled expression, which is an instruction of its program along with the nodes of its operands.
+// the jumps of an if aren't nodes of their own, they count towards its select.
+typedef struct {
+    int parent, children[3], child_count;
+    bool jump;
+
+    // where the node is in the input, from its first character to the one after its last.
+    int from, to;
+
+    // whether it depends on neither x nor y, and whether it has something that fold_constants() leaves alone.
+    bool constant, unfolded;
+
+    // the earlier node that computes the same, or -1, and the line the node is printed on.
+    int same, line;
+    unsigned long hash;
+
+    // how many times the scalar evaluator would run it, and how long it took in the batch evaluator, on its own and
+    // with its operands, in nanoseconds.
+    long calls;
+    double self, total;
+} r_node;
+
+// a profile of an expression, with a node for every instruction of its program as it was written.
+typedef struct {
+    r_node *nodes;
+    int count, root;
+    long samples;
+    long double x0, x1;
+
+    // the nanoseconds per value of the program as it was written, with and without the timers, and as it's compiled.
+    double timed, written, compiled;
+    int compiled_length, degree;
+    bool polynomial;
+} r_profile;
+
+// the length of the token that starts at a position of the input, the same way preprocess() reads it.
+RDEF int token_length(const char *text, int position) {
+    const char *s = text + position;
+    int word;
+    if(s[0] == 'p' && s[1] == 'i')
+        return 2;
+    if(isin(s[0], "<>=!") && s[1] == '=')
+        return 2;
+    if(isalpha((unsigned char) s[0]) && encode_function((char *) s, &word) != '\0')
+        return word;
+
+    int length = 0;
+    while(s[length] != '\0' && isin(s[length], "0123456789."))
+        length++;
+    return length > 0 ? length : 1;
+}
+
+// widens the text of a node over the parentheses that it opens or closes without the other half, so that sin(x
+// reads sin(x) and x+1)^2 reads (x+1)^2.
+RDEF void balance_text(const char *text, int *from, int *to) {
+    int open = 0, unopened = 0;
+    for(int i = *from ; i < *to ; i++) {
+        if(isin(text[i], "([{"))
+            open++;
+        else if(isin(text[i], ")]}") && open > 0)
+            open--;
+        else if(isin(text[i], ")]}"))
+            unopened++;
+    }
+    while(open > 0 && text[*to] != '\0' && isin(text[*to], ")]}")) {
+        (*to)++;
+        open--;
+    }
+    while(unopened > 0 && *from > 0 && isin(text[*from - 1], "([{")) {
+        (*from)--;
+        unopened--;
+    }
+}
+
+// returns whether two nodes compute the same thing.
+RDEF bool same_nodes(p_data *data, r_node *nodes, int a, int b) {
+    p_instr *x = &data -> program[a], *y = &data -> program[b];
+    if(nodes[a].hash != nodes[b].hash || x -> op != y -> op || nodes[a].child_count != nodes[b].child_count)
+        return false;
+    if(x -> op == 'n' && x -> value != y -> value)
+        return false;
+    for(int k = 0 ; k < nodes[a].child_count ; k++)
+        if(!same_nodes(data, nodes, nodes[a].children[k], nodes[b].children[k]))
+            return false;
+    return true;
+}
+
+// returns whether a node is the 0 that a negation subtracts from, which is part of the negation.
+RDEF bool negation_zero(p_data *data, r_node *nodes, int i) {
+    int parent = nodes[i].parent;
+    return parent >= 0 && data -> program[parent].op == '-' && nodes[parent].children[0] == i && data -> program[i].op == 'n'
+        && data -> sources[i] == data -> sources[parent];
+}
+
+// builds the tree of a profiled expression out of its program: every instruction takes its operands off a stack of
+// nodes and pushes itself, the way evaluate() does with values.
+RDEF void build_nodes(p_data *data, r_node *nodes, int *root) {
+    int *stack = malloc((data -> program_len + 1) * sizeof(int)), top = -1;
+    for(int i = 0 ; i < data -> program_len ; i++) {
+        r_node *node = &nodes[i];
+        char op = data -> program[i].op;
+        *node = (r_node) { -1, { -1, -1, -1 }, 0, op == 'j' || op == 'J', 0, 0, false, false, -1, 0, 0, 0, 0, 0 };
+        if(node -> jump)
+            continue;
+
+        node -> child_count = op == 'x' || op == 'y' || op == 'n' ? 0 : op == '?' ? 3 : isin(op, "+-*/^<>LG=!mM") ? 2 : 1;
+        for(int k = node -> child_count - 1 ; k >= 0 ; k--) {
+            node -> children[k] = stack[top--];
+            nodes[node -> children[k]].parent = i;
+        }
+
+        // operands come before what they're operands of, so they're done by now.
+        node -> constant = op != 'x' && op != 'y';
+        node -> unfolded = op == 'l' || op == '?';
+        node -> hash = (unsigned long) op * 2654435761u;
+        if(op == 'n') {
+            double value = (double) data -> program[i].value;
+            unsigned long long bits;
+            memcpy(&bits, &value, sizeof(bits));
+            node -> hash = node -> hash * 31 + (unsigned long) (bits ^ (bits >> 32));
+        }
+
+        int source = data -> sources[i];
+        node -> from = source >= 0 ? source : (int) strlen(data -> input);
+        node -> to = source >= 0 ? source + token_length(data -> input, source) : 0;
+        for(int k = 0 ; k < node -> child_count ; k++) {
+            r_node *child = &nodes[node -> children[k]];
+            node -> constant &= child -> constant;
+            node -> unfolded |= child -> unfolded;
+            node -> hash = node -> hash * 1000003u + child -> hash;
+            if(child -> from < node -> from) node -> from = child -> from;
+            if(child -> to > node -> to) node -> to = child -> to;
+        }
+        stack[++top] = i;
+    }
+    *root = top >= 0 ? stack[top] : -1;
+    free(stack);
+
+    // the text of a node is what it spans of the input, and a node that computes the same as an earlier one could
+    // share its value. the earlier one comes first in the tree, since both come in the order of the input.
+    for(int i = 0 ; i < data -> program_len ; i++) {
+        if(nodes[i].jump)
+            continue;
+
+        balance_text(data -> input, &nodes[i].from, &nodes[i].to);
+        for(int j = 0 ; j < i && nodes[i].child_count > 0 && !nodes[i].constant ; j++)
+            if(!nodes[j].jump && same_nodes(data, nodes, i, j)) {
+                nodes[i].same = j;
+                break;
+            }
+    }
+}
+
+// the nanoseconds that reading the clock twice takes, which is taken off of every instruction that is timed.
+RDEF double timer_overhead() {
+    double least = INFINITY;
+    for(int i = 0 ; i < 1000 ; i++) {
+        double start = instrument_now();
+        double spent = instrument_now() - start;
+        if(spent < least)
+            least = spent;
+    }
+    return least * 1e3;
+}
+
+// returns the nanoseconds per value that the batch evaluator takes for a program, over the points of a profile.
+RDEF double time_program(p_data *data, long double x0, long double x1, long samples) {
+    long double xvalues[BATCH_SIZE], output[BATCH_SIZE];
+    double start = instrument_now();
+    for(long first = 0 ; first < samples && !canceled() ; first += BATCH_SIZE) {
+        int length = samples - first < BATCH_SIZE ? samples - first : BATCH_SIZE;
+        for(int j = 0 ; j < length ; j++)
+            xvalues[j] = samples > 1 ? x0 + (x1 - x0) * (first + j) / (samples - 1) : x0;
+        evaluate_batch(data, xvalues, output, length, base);
+    }
+    return (instrument_now() - start) * 1e3 / samples;
+}
+
+// profiles an expression that was compiled as a profiled expression, at evenly spaced points from x0 to x1. the
+// program runs on the batch evaluator with every instruction timed on its own, a block of BATCH_SIZE values at a
+// time, which is long enough for the timer to be accurate. the batch evaluator runs both branches of an if, so the
+// calls of a branch are counted from the lanes whose condition picks it, as the scalar evaluator would run it.
+RDEF r_profile profile_expression(p_data *data, long double x0, long double x1, long samples) {
+    r_profile profile = { NULL, 0, -1, samples, x0, x1, 0, 0, 0, 0, 0, false };
+
+    // a malformed expression is evaluated once first, so that it reports its error before anything is allocated.
+    if(!data -> valid || data -> program_len == 0)
+        evaluate(x0, data, base);
+
+    int length = data -> program_len, ifs = 0;
+    profile.count = length;
+    profile.nodes = (r_node *) calloc(length, sizeof(r_node));
+    build_nodes(data, profile.nodes, &profile.root);
+
+    // the jumps of an if count towards its select: j lands after J, and J after the select.
+    int *owner = malloc(length * sizeof(int));
+    for(int i = 0 ; i < length ; i++) {
+        char op = data -> program[i].op;
+        owner[i] = op == 'J' ? (int) data -> program[i].value - 1 : i;
+        ifs += op == '?';
+    }
+    for(int i = 0 ; i < length ; i++)
+        if(data -> program[i].op == 'j')
+            owner[i] = owner[(int) data -> program[i].value - 1];
+
+    // the lanes that every level of ifs runs for: the lanes of the level above whose condition is nonzero in its then
+    // branch, and zero in its else branch.
+    bool *lanes = malloc((2 * ifs + 1) * BATCH_SIZE * sizeof(bool)), **active = malloc((ifs + 1) * sizeof(bool *));
+    long double *stack = malloc((data -> stack_depth + 1) * BATCH_SIZE * sizeof(long double)), xvalues[BATCH_SIZE];
+    double log_base = log(base), overhead = timer_overhead();
+
+    progress_total((samples + BATCH_SIZE - 1) / BATCH_SIZE);
+    for(long first = 0 ; first < samples && !progress_advance(1) ; first += BATCH_SIZE) {
+        int n = samples - first < BATCH_SIZE ? samples - first : BATCH_SIZE, top = -1, level = 0;
+        for(int j = 0 ; j < n ; j++) {
+            xvalues[j] = samples > 1 ? x0 + (x1 - x0) * (first + j) / (samples - 1) : x0;
+            lanes[j] = true;
+        }
+        active[0] = lanes;
+
+        for(int i = 0 ; i < length ; i++) {
+            p_instr *instr = &data -> program[i];
+            if(instr -> op == 'j') {
+                bool *then = lanes + (2 * level + 1) * BATCH_SIZE, *otherwise = then + BATCH_SIZE;
+                long double *condition = stack + top * BATCH_SIZE;
+                for(int j = 0 ; j < n ; j++) {
+                    then[j] = active[level][j] && condition[j] != 0;
+                    otherwise[j] = active[level][j] && condition[j] == 0;
+                }
+                active[++level] = then;
+            } else if(instr -> op == 'J')
+                active[level] += BATCH_SIZE;
+            else if(instr -> op == '?')
+                level--;
+
+            if(!profile.nodes[i].jump) {
+                long calls = 0;
+                for(int j = 0 ; j < n ; j++)
+                    calls += active[level][j];
+                profile.nodes[i].calls += calls;
+            }
+
+            double start = instrument_now();
+            top = batch_step(instr, stack, top, xvalues, 0, n, log_base);
+            double spent = (instrument_now() - start) * 1e3 - overhead;
+            profile.nodes[owner[i]].self += spent > 0 ? spent : 0;
+        }
+    }
+    free(owner);
+    free(lanes);
+    free(active);
+    free(stack);
+
+    // operands come before what they're operands of, so a node's total is done once its operands are.
+    for(int i = 0 ; i < length ; i++) {
+        r_node *node = &profile.nodes[i];
+        node -> total = node -> self;
+        for(int k = 0 ; k < node -> child_count ; k++)
+            node -> total += profile.nodes[node -> children[k]].total;
+    }
+    if(canceled())
+        return profile;
+
+    // the same points without the timers, as it was written and as it's compiled, for comparison.
+    profile.timed = profile.root >= 0 ? profile.nodes[profile.root].total / samples : 0;
+    profile.written = time_program(data, x0, x1, samples);
+    p_data *compiled = compile_function(data -> input);
+    if(compiled != NULL) {
+        profile.compiled_length = compiled -> program_len;
+        profile.polynomial = compiled -> polynomial;
+        profile.degree = compiled -> degree;
+        profile.compiled = time_program(compiled, x0, x1, samples);
+        destroy_data(compiled);
+    }
+    return profile;
+}
+
+// the name of the operation of a node.
+RDEF const char *node_name(p_data *data, r_node *nodes, int i, char *buffer) {
+    char op = data -> program[i].op;
+    char *at = strchr(function_shorthand, op);
+    if(op == 'x' || op == 'y' || op == 'n')
+        return "";
+    if(op == '-' && negation_zero(data, nodes, nodes[i].children[0]))
+        return "neg";
+    if(op == 'L' || op == 'G')
+        return op == 'L' ? "<=" : ">=";
+    if(op == '=' || op == '!')
+        return op == '=' ? "==" : "!=";
+    if(at != NULL && op != '\0')
+        return accepted_functions[at - function_shorthand];
+    buffer[0] = op;
+    buffer[1] = '\0';
+    return buffer;
+}
+
+// prints a node and the nodes under it, one per line, indented by how deep they are.
+RDEF void print_node(r_profile *profile, p_data *data, int i, int depth, int *line, FILE *output) {
+    r_node *node = &profile -> nodes[i], *parent = node -> parent >= 0 ? &profile -> nodes[node -> parent] : NULL;
+    double whole = profile -> nodes[profile -> root].total;
+    char buffer[2];
+
+    node -> line = ++*line;
+    fprintf(output, "%6.1f%% %6.1f%% %12li  %*s", whole > 0 ? 100 * node -> total / whole : 0, whole > 0 ? 100 * node -> self / whole : 0, node -> calls,
+        2 * depth, "");
+    if(node -> child_count > 0)
+        fprintf(output, "%s  ", node_name(data, profile -> nodes, i, buffer));
+    fprintf(output, "%.*s", node -> to - node -> from, data -> input + node -> from);
+
+    // the largest parts that could be computed once when compiling, or once per evaluation.
+    if(node -> child_count > 0 && node -> constant && (parent == NULL || !parent -> constant))
+        fprintf(output, "   <- constant, %s", node -> unfolded ? "could be folded" : "folded when compiled");
+    else if(data -> program[i].op == '?' && !node -> constant && profile -> nodes[node -> children[0]].constant)
+        fprintf(output, "   <- constant condition, the branch could be picked when compiled");
+    else if(node -> same >= 0 && (parent == NULL || parent -> same < 0))
+        fprintf(output, "   <- same as line %i, could be computed once", profile -> nodes[node -> same].line);
+    fputc('\n', output);
+
+    // the 0 of a negation is part of the negation.
+    for(int k = 0 ; k < node -> child_count ; k++)
+        if(!negation_zero(data, profile -> nodes, node -> children[k]))
+            print_node(profile, data, node -> children[k], depth + 1, line, output);
+}
+
+// prints the tree of a profile, with the share of the time that every node took with its operands and on its own,
+// followed by the time per value of the expression as it was written and as it's compiled.
+RDEF void print_profile(r_profile *profile, p_data *data, FILE *output) {
+    if(profile -> root < 0) {
+        fprintf(output, "ERROR: nothing to profile.\n");
+        return;
+    }
+
+    // the zeros of negations are on no line of their own, their time is part of the negation's.
+    for(int i = 0 ; i < profile -> count ; i++)
+        if(!profile -> nodes[i].jump && negation_zero(data, profile -> nodes, i)) {
+            profile -> nodes[profile -> nodes[i].parent].self += profile -> nodes[i].self;
+            profile -> nodes[i].self = 0;
+        }
+
+    int line = 0;
+    fprintf(output, "%s at %li points from %Lg to %Lg:\n", data -> input, profile -> samples, profile -> x0, profile -> x1);
+    fprintf(output, "  total    self        calls  node\n");
+    print_node(profile, data, profile -> root, 0, &line, output);
+
+    fprintf(output, "as written: %i instructions, %.1f ns per value (%.1f ns with every instruction timed)\n", profile -> count, profile -> written, profile -> timed);
+    if(profile -> polynomial)
+        fprintf(output, "compiled: a polynomial of degree %i, %.1f ns per value\n", profile -> degree, profile -> compiled);
+    else
+        fprintf(output, "compiled: %i instructions, %.1f ns per value\n", profile -> compiled_length, profile -> compiled);
+}
+
+// frees what a profile holds.
+RDEF void profile_free(r_profile *profile) {
+    free(profile -> nodes);
+    profile -> nodes = NULL;
+}
@@ -0,0 +1,750 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifndef SDEF
+#define SDEF static inline
+#endif
+
+// the most clients that can be connected to the server at once.
+#ifndef MAX_CLIENTS
+#define MAX_CLIENTS 256
+#endif
+
+// the longest request line the server accepts.
+#ifndef MAX_REQUEST
+#define MAX_REQUEST (1 << 20)
+#endif
+
+// the amount of compiled expressions that are kept between requests.
+#ifndef CACHE_SIZE
+#define CACHE_SIZE 1024
+#endif
+
+// the amount of recent request latencies that percentiles are computed from.
+#ifndef LATENCY_SAMPLES
+#define LATENCY_SAMPLES 65536
+#endif
+
+// the most x values in a single eval_batch request.
+#ifndef MAX_BATCH
+#define MAX_BATCH 65536
+#endif
+
+// a growable string that responses are written into.
+typedef struct {
+    char *text;
+    size_t length, capacity;
+} s_text;
+
+// a request waiting for a worker, or a response waiting for the event loop.
+typedef struct s_job {
+    long client;
+    char *text;
+    double received;
+    struct s_job *next;
+} s_job;
+
+// a connected client. ids are never reused, so a response for a client that left can't reach a new one.
+typedef struct {
+    int fd;
+    long id;
+    s_text in, out;
+} s_client;
+
+// a compiled expression kept between requests, it can only be replaced while no worker is using it.
+typedef struct {
+    char *text;
+    p_data *data;
+    int users;
+} s_entry;
+
+// everything the server keeps resident between requests.
+typedef struct {
+    f_table *functions;
+    long double xmin, xmax, ymin, ymax;
+
+    // requests hold the table (and window) for reading while they run, and reloads of the save files for writing.
+    pthread_rwlock_t table_lock;
+
+    s_job *requests, *last_request;
+    s_job *responses, *last_response;
+    pthread_mutex_t queue_lock;
+    pthread_cond_t queue_ready;
+    int wake[2];
+
+    s_entry cache[CACHE_SIZE];
+    pthread_mutex_t cache_lock;
+
+    double latencies[LATENCY_SAMPLES];
+    long request_count;
+    pthread_mutex_t latency_lock;
+} s_server;
+
+static volatile sig_atomic_t server_running = 1;
+
+// stops the event loop from a signal.
+SDEF void stop_server(int signal) {
+    (void) signal;
+    server_running = 0;
+}
+
+// appends formatted text to a growable string.
+SDEF void text_append(s_text *text, const char *format, ...) {
+    va_list arguments;
+    while(true) {
+        va_start(arguments, format);
+        int length = vsnprintf(text -> text + text -> length, text -> capacity - text -> length, format, arguments);
+        va_end(arguments);
+
+        if(text -> text != NULL && text -> length + length < text -> capacity) {
+            text -> length += length;
+            return;
+        }
+        text -> capacity = (text -> capacity + length + 1) * 2;
+        text -> text = realloc(text -> text, text -> capacity);
+    }
+}
+
+// appends raw bytes to a growable string.
+SDEF void text_write(s_text *text, const char *bytes, size_t length) {
+    if(text -> length + length + 1 > text -> capacity) {
+        text -> capacity = (text -> length + length + 1) * 2;
+        text -> text = realloc(text -> text, text -> capacity);
+    }
+    memcpy(text -> text + text -> length, bytes, length);
+    text -> length += length;
+    text -> text[text -> length] = '\0';
+}
+
+// appends a number as json, which has no representation for nan or infinity.
+SDEF void text_number(s_text *text, long double value) {
+    if(isfinite(value)) text_append(text, "%.17Lg", value);
+    else text_append(text, "null");
+}
+
+// returns a pointer to the value of a key in a flat json object, or NULL if the key isn't there.
+SDEF char *json_find(char *json, char *key) {
+    size_t length = strlen(key);
+    for(char *at = strchr(json, '"') ; at != NULL ; at = strchr(at + 1, '"')) {
+        if(strncmp(at + 1, key, length) != 0 || at[length + 1] != '"')
+            continue;
+
+        char *value = at + length + 2;
+        while(isspace(*value)) value++;
+        if(*value != ':')
+            continue;
+        value++;
+        while(isspace(*value)) value++;
+        return value;
+    }
+    return NULL;
+}
+
+// reads a json string value into the output, returning false if there isn't one.
+SDEF bool json_string(char *json, char *key, char *output, int size) {
+    char *value = json_find(json, key);
+    if(value == NULL || *value != '"')
+        return false;
+
+    int length = 0;
+    for(value++ ; *value != '\0' && *value != '"' && length < size - 1 ; value++) {
+        if(*value == '\\' && value[1] != '\0')
+            value++;
+        output[length++] = *value;
+    }
+    output[length] = '\0';
+    return *value == '"';
+}
+
+// reads a json number value, returning false if there isn't one.
+SDEF bool json_number(char *json, char *key, long double *output) {
+    char *value = json_find(json, key), *end;
+    if(value == NULL)
+        return false;
+
+    *output = strtold(value, &end);
+    return end != value;
+}
+
+// reads a json array of numbers, returning the amount read or -1 if there isn't one.
+SDEF int json_numbers(char *json, char *key, long double *output, int size) {
+    char *value = json_find(json, key), *end;
+    if(value == NULL || *value != '[')
+        return -1;
+
+    int count = 0;
+    for(value++ ; count < size ; count++) {
+        while(isspace(*value)) value++;
+        if(*value == ']')
+            break;
+
+        output[count] = strtold(value, &end);
+        if(end == value)
+            return -1;
+        value = end;
+        while(isspace(*value)) value++;
+        if(*value == ',')
+            value++;
+    }
+    return count;
+}
+
+// returns a compiled expression from the cache, compiling (and caching, if its slot is free) it when it isn't there.
+SDEF s_entry *acquire_expression(s_server *server, char *text, p_data **compiled) {
+    unsigned long hash = 5381;
+    for(char *c = text ; *c != '\0' ; c++)
+        hash = hash * 33 + *c;
+    s_entry *entry = &server -> cache[hash % CACHE_SIZE];
+
+    pthread_mutex_lock(&server -> cache_lock);
+    if(entry -> text != NULL && strcmp(entry -> text, text) == 0) {
+        entry -> users++;
+        *compiled = entry -> data;
+        pthread_mutex_unlock(&server -> cache_lock);
+        return entry;
+    }
+    pthread_mutex_unlock(&server -> cache_lock);
+
+    // compiling happens outside of the lock. a malformed expression is freed by compile_function() before its error
+    // goes on to the request's handler, so that bad requests don't leak.
+    p_data *data = compile_function(text);
+    if(data == NULL) {
+        char message[MAX_LENGTH];
+        snprintf(message, sizeof(message), "%s", error_message);
+        throw_error(message);
+    }
+    *compiled = data;
+
+    pthread_mutex_lock(&server -> cache_lock);
+    if(entry -> users == 0) {
+        if(entry -> text != NULL) {
+            free(entry -> text);
+            destroy_data(entry -> data);
+        }
+        entry -> text = strdup(text);
+        entry -> data = data;
+        entry -> users = 1;
+        pthread_mutex_unlock(&server -> cache_lock);
+        return entry;
+    }
+    pthread_mutex_unlock(&server -> cache_lock);
+    return NULL;
+}
+
+// gives back an expression from acquire_expression(), uncached expressions are freed.
+SDEF void release_expression(s_server *server, s_entry *entry, p_data *compiled) {
+    if(entry == NULL) {
+        destroy_data(compiled);
+        return;
+    }
+
+    pthread_mutex_lock(&server -> cache_lock);
+    entry -> users--;
+    pthread_mutex_unlock(&server -> cache_lock);
+}
+
+// compares latencies for sorting.
+SDEF int compare_latencies(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// renders the functions into the response as an array of display rows.
+SDEF void render_lines(s_server *server, p_data **functions, int function_count, s_text *response) {
+    long double x_steps = (server -> xmax - server -> xmin) / WINDOW_WIDTH;
+    long double y_steps = (server -> ymax - server -> ymin) / WINDOW_HEIGHT;
+    pixel **display = quantify_plane(x_steps, y_steps, server -> xmin, server -> ymax);
+
+    draw_plane(display, x_steps, y_steps);
+    draw_line(display, functions, x_steps, y_steps, &evaluate, function_count);
+
+    char *row = malloc(WINDOW_WIDTH + 1);
+    text_append(response, ",\"lines\":[");
+    for(int y = 0 ; y < WINDOW_HEIGHT ; y++) {
+        for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+            row[x] = display[y][x].display;
+        row[(int) WINDOW_WIDTH] = '\0';
+        text_append(response, "%s\"%s\"", y > 0 ? "," : "", row);
+    }
+    text_append(response, "]");
+    clear_display(display);
+    free(row);
+}
+
+// handles a single request line and returns its response line. errors anywhere in the request (including in
+// compiling or evaluating the expression) become an error response.
+SDEF char *handle_request(s_server *server, char *request) {
+    s_text response = { NULL, 0, 0 };
+    jmp_buf handler;
+    p_data *volatile function = NULL;
+    s_entry *volatile entry = NULL;
+    volatile bool acquired = false;
+
+    // the request's id (a number or a string) is echoed back, so that pipelined responses can be matched up.
+    char *id = json_find(request, "id");
+    int id_length = 0;
+    if(id != NULL) {
+        if(*id == '"') id_length = strcspn(id + 1, "\"") + 2;
+        else id_length = strcspn(id, ",} \t");
+    }
+    text_append(&response, "{\"id\":%.*s", id != NULL ? id_length : 4, id != NULL ? id : "null");
+
+    error_handler = &handler;
+    if(setjmp(handler)) {
+        error_handler = NULL;
+        if(acquired)
+            release_expression(server, entry, function);
+        response.length = 0;
+        text_append(&response, "{\"id\":%.*s,\"ok\":false,\"error\":", id != NULL ? id_length : 4, id != NULL ? id : "null");
+
+        // the message can quote the expression it failed on, so it's escaped like any other json string.
+        char *escaped = NULL;
+        size_t escaped_length = 0;
+        FILE *stream = open_memstream(&escaped, &escaped_length);
+        if(stream != NULL) {
+            write_json_string(stream, error_message);
+            fclose(stream);
+            text_write(&response, escaped, escaped_length);
+            free(escaped);
+        }
+        else text_append(&response, "\"error\"");
+        text_append(&response, "}\n");
+        return response.text;
+    }
+
+    char op[32], expression[MAX_LENGTH];
+    if(!json_string(request, "op", op, sizeof(op)))
+        throw_error("missing op");
+
+    // the function is either an expression or a function in the function table, by index or name.
+    char key[MAX_NAME + 32];
+    long double index;
+    if(json_string(request, "expr", expression, sizeof(expression))) {
+        p_data *compiled;
+        entry = acquire_expression(server, expression, &compiled);
+        function = compiled;
+        acquired = true;
+    } else if(json_string(request, "fn", key, sizeof(key)) || (json_number(request, "fn", &index) && snprintf(key, sizeof(key), "%.0Lf", index) > 0)) {
+        int slot = ftable_find(server -> functions, key);
+        if(slot < 0)
+            throw_error("function does not exist");
+        function = server -> functions -> entries[slot].data;
+    } else if(strcmp(op, "render") != 0 && strcmp(op, "stats") != 0) {
+        throw_error("missing expr or fn");
+    }
+
+    long double x = 0, a = 0, b = 0;
+    bool has_bounds = json_number(request, "a", &a) && json_number(request, "b", &b);
+
+    if(strcmp(op, "eval") == 0) {
+        json_number(request, "x", &x);
+        long double value = evaluate(x, function, base);
+        text_append(&response, ",\"ok\":true,\"value\":");
+        text_number(&response, value);
+    } else if(strcmp(op, "eval_batch") == 0) {
+        long double *xvalues = malloc(MAX_BATCH * sizeof(long double));
+        int count = json_numbers(request, "xs", xvalues, MAX_BATCH);
+        if(count < 0) {
+            free(xvalues);
+            throw_error("missing xs");
+        }
+
+        long double *values = malloc((count + 1) * sizeof(long double));
+        evaluate_batch(function, xvalues, values, count, base);
+        text_append(&response, ",\"ok\":true,\"values\":[");
+        for(int i = 0 ; i < count ; i++) {
+            if(i > 0) text_write(&response, ",", 1);
+            text_number(&response, values[i]);
+        }
+        text_append(&response, "]");
+        free(xvalues);
+        free(values);
+    } else if(strcmp(op, "integrate") == 0) {
+        if(!has_bounds)
+            throw_error("missing a or b");
+        text_append(&response, ",\"ok\":true,\"value\":");
+        text_number(&response, integrate(a, b, function, base));
+    } else if(strcmp(op, "roots") == 0) {
+        if(!has_bounds) {
+            a = server -> xmin;
+            b = server -> xmax;
+        }
+        long double tolerance = ROOT_TOLERANCE;
+        json_number(request, "tolerance", &tolerance);
+
+        a_roots roots = find_roots(function, NULL, a, b, ROOT_SAMPLES, tolerance, base);
+        text_append(&response, ",\"ok\":true,\"roots\":[");
+        for(int i = 0 ; i < roots.root_cnt ; i++) {
+            if(i > 0) text_write(&response, ",", 1);
+            text_number(&response, roots.roots[i]);
+        }
+        text_append(&response, "],\"evaluations\":%li", roots.scan_evaluations + roots.refine_evaluations);
+    } else if(strcmp(op, "render") == 0) {
+        text_append(&response, ",\"ok\":true");
+        if(function != NULL) {
+            p_data *single = function;
+            render_lines(server, &single, 1, &response);
+        } else {
+            p_data **functions = malloc((server -> functions -> size + 1) * sizeof(p_data *));
+            int function_count = ftable_select(server -> functions, NULL, 0, functions, NULL);
+            render_lines(server, functions, function_count, &response);
+            free(functions);
+        }
+    } else if(strcmp(op, "stats") == 0) {
+        // percentiles are taken over the most recent requests.
+        pthread_mutex_lock(&server -> latency_lock);
+        long total = server -> request_count;
+        int count = total < LATENCY_SAMPLES ? total : LATENCY_SAMPLES;
+        double *sorted = malloc((count + 1) * sizeof(double));
+        memcpy(sorted, server -> latencies, count * sizeof(double));
+        pthread_mutex_unlock(&server -> latency_lock);
+
+        qsort(sorted, count, sizeof(double), &compare_latencies);
+
+        text_append(&response, ",\"ok\":true,\"requests\":%li", total);
+        double percentiles[4] = { 50, 90, 99, 100 };
+        char *names[4] = { "p50_us", "p90_us", "p99_us", "max_us" };
+        for(int i = 0 ; i < 4 ; i++)
+            text_append(&response, ",\"%s\":%.1f", names[i], count > 0 ? sorted[(int) ((count - 1) * percentiles[i] / 100)] * 1e6 : 0);
+        free(sorted);
+    } else {
+        throw_error("unknown op");
+    }
+
+    error_handler = NULL;
+    if(acquired)
+        release_expression(server, entry, function);
+    text_append(&response, "}\n");
+    return response.text;
+}
+
+// takes requests off the queue until the server stops, and hands the responses back to the event loop.
+SDEF void *serve_requests(void *argument) {
+    s_server *server = (s_server *) argument;
+    while(true) {
+        pthread_mutex_lock(&server -> queue_lock);
+        while(server -> requests == NULL && server_running)
+            pthread_cond_wait(&server -> queue_ready, &server -> queue_lock);
+        if(!server_running) {
+            pthread_mutex_unlock(&server -> queue_lock);
+            return NULL;
+        }
+
+        s_job *job = server -> requests;
+        server -> requests = job -> next;
+        if(server -> requests == NULL)
+            server -> last_request = NULL;
+        pthread_mutex_unlock(&server -> queue_lock);
+
+        pthread_rwlock_rdlock(&server -> table_lock);
+        char *response = handle_request(server, job -> text);
+        pthread_rwlock_unlock(&server -> table_lock);
+        free(job -> text);
+        job -> text = response;
+
+        double latency = now_seconds() - job -> received;
+        pthread_mutex_lock(&server -> latency_lock);
+        server -> latencies[server -> request_count % LATENCY_SAMPLES] = latency;
+        server -> request_count++;
+        pthread_mutex_unlock(&server -> latency_lock);
+
+        job -> next = NULL;
+        pthread_mutex_lock(&server -> queue_lock);
+        if(server -> last_response != NULL) server -> last_response -> next = job;
+        else server -> responses = job;
+        server -> last_response = job;
+        pthread_mutex_unlock(&server -> queue_lock);
+
+        // wakes the event loop up so that it writes the response.
+        char byte = 0;
+        if(write(server -> wake[1], &byte, 1) < 0) continue;
+    }
+}
+
+// splits a client's input into request lines and queues them for the workers.
+SDEF bool queue_requests(s_server *server, s_client *client) {
+    char *start = client -> in.text, *end;
+    size_t consumed = 0;
+
+    pthread_mutex_lock(&server -> queue_lock);
+    while(consumed < client -> in.length && (end = memchr(start, '\n', client -> in.length - consumed)) != NULL) {
+        s_job *job = malloc(sizeof(s_job));
+        *job = (s_job) { client -> id, strndup(start, end - start), now_seconds(), NULL };
+        if(server -> last_request != NULL) server -> last_request -> next = job;
+        else server -> requests = job;
+        server -> last_request = job;
+
+        consumed += end - start + 1;
+        start = end + 1;
+    }
+    pthread_cond_broadcast(&server -> queue_ready);
+    pthread_mutex_unlock(&server -> queue_lock);
+
+    memmove(client -> in.text, client -> in.text + consumed, client -> in.length - consumed);
+    client -> in.length -= consumed;
+    return client -> in.length < MAX_REQUEST;
+}
+
+// closes a client's connection and frees its buffers.
+SDEF void drop_client(s_client *client) {
+    close(client -> fd);
+    free(client -> in.text);
+    free(client -> out.text);
+    memset(client, 0, sizeof(s_client));
+    client -> fd = -1;
+}
+
+// serves requests on a unix domain socket until the process is interrupted. a single event loop accepts clients,
+// reads request lines and writes responses, while the requests themselves are handled by the worker threads.
+SDEF int serve(char *path, f_table *functions, long double *window, w_watch *watch, int threads) {
+    s_server *server = calloc(1, sizeof(s_server));
+    *server = (s_server) { .functions = functions, .xmin = window[0], .xmax = window[1], .ymin = window[2], .ymax = window[3] };
+    pthread_rwlock_init(&server -> table_lock, NULL);
+    pthread_mutex_init(&server -> queue_lock, NULL);
+    pthread_mutex_init(&server -> cache_lock, NULL);
+    pthread_mutex_init(&server -> latency_lock, NULL);
+    pthread_cond_init(&server -> queue_ready, NULL);
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if(strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "ERROR: socket path is too long.\n");
+        return 1;
+    }
+    strcpy(address.sun_path, path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path);
+    if(listener < 0 || bind(listener, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(listener, 64) < 0 || pipe(server -> wake) < 0) {
+        fprintf(stderr, "ERROR: could not listen on \"%s\": %s\n", path, strerror(errno));
+        return 1;
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+    fcntl(server -> wake[0], F_SETFL, O_NONBLOCK);
+
+    signal(SIGINT, &stop_server);
+    signal(SIGTERM, &stop_server);
+    signal(SIGPIPE, SIG_IGN);
+
+    if(threads < 1) threads = 1;
+    if(threads > MAX_THREADS) threads = MAX_THREADS;
+    pthread_t workers[MAX_THREADS];
+    for(int i = 0 ; i < threads ; i++)
+        pthread_create(&workers[i], NULL, &serve_requests, server);
+
+    s_client *clients = calloc(MAX_CLIENTS, sizeof(s_client));
+    for(int i = 0 ; i < MAX_CLIENTS ; i++)
+        clients[i].fd = -1;
+    struct pollfd polls[MAX_CLIENTS + 3];
+    int slots[MAX_CLIENTS + 3];
+    long next_id = 1;
+    char buffer[1 << 16];
+
+    fprintf(stderr, "serving on %s with %i workers\n", path, threads);
+    while(server_running) {
+        int poll_count = 0;
+        polls[poll_count++] = (struct pollfd) { listener, POLLIN, 0 };
+        polls[poll_count++] = (struct pollfd) { server -> wake[0], POLLIN, 0 };
+        polls[poll_count++] = (struct pollfd) { watch -> fd, POLLIN, 0 };
+        for(int i = 0 ; i < MAX_CLIENTS ; i++)
+            if(clients[i].fd >= 0) {
+                slots[poll_count] = i;
+                polls[poll_count++] = (struct pollfd) { clients[i].fd, POLLIN | (clients[i].out.length > 0 ? POLLOUT : 0), 0 };
+            }
+
+        if(poll(polls, poll_count, -1) < 0)
+            continue;
+
+        // new clients.
+        if(polls[0].revents & POLLIN) {
+            int fd;
+            while((fd = accept(listener, NULL, NULL)) >= 0) {
+                int slot = 0;
+                while(slot < MAX_CLIENTS && clients[slot].fd >= 0) slot++;
+                if(slot == MAX_CLIENTS) {
+                    close(fd);
+                    continue;
+                }
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                clients[slot] = (s_client) { fd, next_id++ };
+            }
+        }
+
+        // finished responses are moved to their clients' output, responses for clients that left are dropped.
+        if(polls[1].revents & POLLIN) {
+            while(read(server -> wake[0], buffer, sizeof(buffer)) > 0) continue;
+
+            pthread_mutex_lock(&server -> queue_lock);
+            s_job *job = server -> responses;
+            server -> responses = server -> last_response = NULL;
+            pthread_mutex_unlock(&server -> queue_lock);
+
+            while(job != NULL) {
+                for(int i = 0 ; i < MAX_CLIENTS ; i++)
+                    if(clients[i].fd >= 0 && clients[i].id == job -> client) {
+                        text_write(&clients[i].out, job -> text, strlen(job -> text));
+                        break;
+                    }
+
+                s_job *next = job -> next;
+                free(job -> text);
+                free(job);
+                job = next;
+            }
+        }
+
+        // the save files changed, requests that are running finish with the old functions first.
+        if(polls[2].revents & POLLIN) {
+            int changes = watch_changes(watch);
+            if(changes != 0) {
+                pthread_rwlock_wrlock(&server -> table_lock);
+                reload_sources(changes, server -> functions, window, stderr);
+                server -> xmin = window[0];
+                server -> xmax = window[1];
+                server -> ymin = window[2];
+                server -> ymax = window[3];
+                pthread_rwlock_unlock(&server -> table_lock);
+            }
+        }
+
+        for(int p = 3 ; p < poll_count ; p++) {
+            s_client *client = &clients[slots[p]];
+            if(client -> fd != polls[p].fd)
+                continue;
+
+            if(polls[p].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t length = read(client -> fd, buffer, sizeof(buffer));
+                if(length == 0 || (length < 0 && errno != EAGAIN)) {
+                    drop_client(client);
+                    continue;
+                }
+                if(length > 0) {
+                    text_write(&client -> in, buffer, length);
+                    if(!queue_requests(server, client)) {
+                        drop_client(client);
+                        continue;
+                    }
+                }
+            }
+
+            if((polls[p].revents & POLLOUT) && client -> out.length > 0) {
+                ssize_t length = write(client -> fd, client -> out.text, client -> out.length);
+                if(length < 0 && errno != EAGAIN) {
+                    drop_client(client);
+                    continue;
+                }
+                if(length > 0) {
+                    memmove(client -> out.text, client -> out.text + length, client -> out.length - length);
+                    client -> out.length -= length;
+                }
+            }
+        }
+    }
+
+    pthread_mutex_lock(&server -> queue_lock);
+    pthread_cond_broadcast(&server -> queue_ready);
+    pthread_mutex_unlock(&server -> queue_lock);
+    for(int i = 0 ; i < threads ; i++)
+        pthread_join(workers[i], NULL);
+
+    for(int i = 0 ; i < MAX_CLIENTS ; i++)
+        if(clients[i].fd >= 0)
+            drop_client(&clients[i]);
+    free(clients);
+    close(listener);
+    unlink(path);
+    fprintf(stderr, "served %li requests\n", server -> request_count);
+    return 0;
+}
+
+// one load generator connection.
+typedef struct {
+    char *path;
+    char *request;
+    int requests;
+    double *latencies;
+    int errors;
+} s_load;
+
+// sends requests one at a time over a single connection and records how long each response took.
+SDEF void *generate_load(void *argument) {
+    s_load *load = (s_load *) argument;
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    strncpy(address.sun_path, load -> path, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        load -> errors = load -> requests;
+        return NULL;
+    }
+
+    char buffer[1 << 16];
+    size_t request_length = strlen(load -> request);
+    for(int i = 0 ; i < load -> requests ; i++) {
+        double start = now_seconds();
+        if(write(fd, load -> request, request_length) != (ssize_t) request_length) {
+            load -> errors += load -> requests - i;
+            break;
+        }
+
+        // reads until the end of the response line.
+        ssize_t length;
+        bool done = false;
+        while(!done && (length = read(fd, buffer, sizeof(buffer) - 1)) > 0) {
+            buffer[length] = '\0';
+            done = buffer[length - 1] == '\n';
+            if(strstr(buffer, "\"ok\":false") != NULL)
+                load -> errors++;
+        }
+        load -> latencies[i] = now_seconds() - start;
+    }
+    close(fd);
+    return NULL;
+}
+
+// connects a number of clients to a server and has each send requests back to back, then prints the throughput
+// and the latency percentiles seen by the clients.
+SDEF int run_load(char *path, int clients, int requests, char *request) {
+    if(clients < 1) clients = 1;
+    if(clients > MAX_CLIENTS) clients = MAX_CLIENTS;
+
+    s_load *loads = calloc(clients, sizeof(s_load));
+    pthread_t *ids = calloc(clients, sizeof(pthread_t));
+    double *latencies = calloc((long) clients * requests + 1, sizeof(double));
+
+    double start = now_seconds();
+    for(int i = 0 ; i < clients ; i++) {
+        loads[i] = (s_load) { path, request, requests, latencies + (long) i * requests, 0 };
+        pthread_create(&ids[i], NULL, &generate_load, &loads[i]);
+    }
+
+    int errors = 0;
+    for(int i = 0 ; i < clients ; i++) {
+        pthread_join(ids[i], NULL);
+        errors += loads[i].errors;
+    }
+    double seconds = now_seconds() - start;
+
+    long total = (long) clients * requests;
+    qsort(latencies, total, sizeof(double), &compare_latencies);
+    printf("%li requests (%i errors) from %i clients in %.3fs (%.0f requests/s)\n", total, errors, clients, seconds, seconds > 0 ? total / seconds : 0);
+    if(total > 0)
+        printf("latency: p50 %.1fus, p90 %.1fus, p99 %.1fus, max %.1fus\n", latencies[(total - 1) / 2] * 1e6, latencies[(long) ((total - 1) * .9)] * 1e6,
+            latencies[(long) ((total - 1) * .99)] * 1e6, latencies[total - 1] * 1e6);
+
+    free(loads);
+    free(ids);
+    free(latencies);
+    return errors > 0;
+}
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifndef NDEF
+#define NDEF static inline
+#endif
+
+// the snapshot that the function table, window and log() base are saved to next to the text files.
+#ifndef SNAPSHOT_FILE
+#define SNAPSHOT_FILE "functions.snapshot"
+#endif
+
+// the snapshot format's version, which has to change whenever the layout or the compiled programs change.
+#ifndef SNAPSHOT_VERSION
+#define SNAPSHOT_VERSION 3
+#endif
+
+// the start of every snapshot. the layout field holds the sizes that the programs depend on, so that a snapshot
+// from a platform with a different long double is never read as compiled programs.
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t source_hash;
+    uint64_t size;
+    long double window[4];
+    long double base;
+    uint32_t function_count;
+} n_header;
+
+// a function in a snapshot, every offset is from the start of the file.
+typedef struct {
+    int32_t slot;
+    int32_t program_len, stack_depth, degree;
+    uint8_t valid, polynomial;
+    uint64_t name, input, program, coefficients;
+} n_function;
+
+// the layout of the structures that are stored as they are in memory.
+NDEF uint32_t snapshot_layout() {
+    return (uint32_t) sizeof(long double) | (uint32_t) sizeof(p_instr) << 8 | (uint32_t) sizeof(n_function) << 16;
+}
+
+// rounds an offset up so that long doubles stored at it are aligned.
+NDEF uint64_t align_offset(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t) 15;
+}
+
+// adds the contents of a file to a 64 bit fnv-1a hash, a missing file hashes differently from an empty one.
+NDEF uint64_t hash_file(uint64_t hash, char *file_name) {
+    FILE *file = fopen(file_name, "rb");
+    if(file == NULL)
+        return (hash ^ 0xff) * 0x100000001b3ULL;
+
+    unsigned char buffer[1 << 16];
+    size_t length;
+    while((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        for(size_t i = 0 ; i < length ; i++)
+            hash = (hash ^ buffer[i]) * 0x100000001b3ULL;
+    fclose(file);
+    return (hash ^ 0xfe) * 0x100000001b3ULL;
+}
+
+// the hash of the text files that a snapshot was made from.
+NDEF uint64_t hash_sources(char *functions_file, char *window_file) {
+    return hash_file(hash_file(0xcbf29ce484222325ULL, functions_file), window_file);
+}
+
+// writes the function table's compiled programs, the window and the log() base to a snapshot. the snapshot is
+// written next to its final name and renamed over it, so a reader never sees half of one. returns 0 on success.
+NDEF int write_snapshot(char *file_name, f_table *table, long double *window, long double base, uint64_t source_hash) {
+    n_header header = { "CALCSNAP", SNAPSHOT_VERSION, snapshot_layout(), source_hash, 0, { window[0], window[1], window[2], window[3] }, base, table -> live };
+    n_function *records = calloc(table -> live + 1, sizeof(n_function));
+
+    // the programs come first, then the coefficients and then the strings, so that every section is aligned.
+    uint64_t offset = align_offset(sizeof(n_header) + table -> live * sizeof(n_function));
+    int count = 0;
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i), count++) {
+        p_data *data = table -> entries[i].data;
+        records[count] = (n_function) { i, data -> program_len, data -> stack_depth, data -> degree, data -> valid, data -> polynomial };
+        records[count].program = offset;
+        offset += data -> program_len * sizeof(p_instr);
+    }
+    count = 0;
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i), count++) {
+        records[count].coefficients = offset;
+        if(table -> entries[i].data -> polynomial)
+            offset += (table -> entries[i].data -> degree + 1) * sizeof(long double);
+    }
+    count = 0;
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i), count++) {
+        records[count].name = offset;
+        offset += strlen(table -> entries[i].name) + 1;
+        records[count].input = offset;
+        offset += strlen(table -> entries[i].data -> input) + 1;
+    }
+    header.size = offset;
+
+    char temporary[MAX_LENGTH];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", file_name);
+    FILE *file = fopen(temporary, "wb");
+    if(file == NULL) {
+        free(records);
+        return 1;
+    }
+
+    static const char padding[16] = { 0 };
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(records, sizeof(n_function), table -> live, file);
+    fwrite(padding, 1, align_offset(ftell(file)) - ftell(file), file);
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i))
+        fwrite(table -> entries[i].data -> program, sizeof(p_instr), table -> entries[i].data -> program_len, file);
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i))
+        if(table -> entries[i].data -> polynomial)
+            fwrite(table -> entries[i].data -> coefficients, sizeof(long double), table -> entries[i].data -> degree + 1, file);
+    for(int i = ftable_next(table, -1) ; i >= 0 ; i = ftable_next(table, i)) {
+        fwrite(table -> entries[i].name, 1, strlen(table -> entries[i].name) + 1, file);
+        fwrite(table -> entries[i].data -> input, 1, strlen(table -> entries[i].data -> input) + 1, file);
+    }
+
+    bool failed = ferror(file) || (uint64_t) ftell(file) != header.size;
+    failed |= fclose(file) != 0;
+    free(records);
+    if(failed || rename(temporary, file_name) != 0) {
+        remove(temporary);
+        return 1;
+    }
+    return 0;
+}
+
+// returns whether a string at an offset ends inside of the snapshot.
+NDEF bool snapshot_string(const char *map, uint64_t size, uint64_t offset) {
+    return offset < size && memchr(map + offset, '\0', size - offset) != NULL;
+}
+
+// reads a snapshot into the (empty) function table, using the programs in place from the mapped file instead of
+// compiling them again. the log() base is read from any snapshot with a matching layout, but the functions and the
+// window only when the snapshot was made from the current text files. returns 0 when the functions were read, and
+// leaves the table empty otherwise so that they can be loaded from text.
+NDEF int read_snapshot(char *file_name, f_table *table, long double *window, long double *base, uint64_t source_hash) {
+    int file = open(file_name, O_RDONLY);
+    if(file < 0)
+        return 1;
+
+    struct stat status;
+    if(fstat(file, &status) != 0 || (size_t) status.st_size < sizeof(n_header)) {
+        close(file);
+        return 1;
+    }
+
+    uint64_t size = status.st_size;
+    char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if(map == MAP_FAILED)
+        return 1;
+
+    n_header *header = (n_header *) map;
+    if(memcmp(header -> magic, "CALCSNAP", 8) != 0 || header -> version != SNAPSHOT_VERSION || header -> layout != snapshot_layout() || header -> size != size ||
+        sizeof(n_header) + (uint64_t) header -> function_count * sizeof(n_function) > size) {
+        munmap(map, size);
+        return 1;
+    }
+
+    *base = header -> base;
+    if(header -> source_hash != source_hash) {
+        munmap(map, size);
+        return 1;
+    }
+
+    // every record is checked against the file's size, so a damaged snapshot falls back to text instead of crashing.
+    // a program that isn't valid can't have been compiled, so it falls back to text too, where the entry is refused.
+    n_function *records = (n_function *) (map + sizeof(n_header));
+    for(uint32_t i = 0 ; i < header -> function_count ; i++) {
+        n_function *record = &records[i];
+        uint64_t coefficients = record -> polynomial ? (record -> degree + 1) * sizeof(long double) : 0;
+        if(!record -> valid || record -> slot < 0 || (table -> size > 0 && record -> slot < table -> size) || record -> program_len < 0 || record -> degree < 0 ||
+            record -> degree > MAX_DEGREE || record -> program % 16 != 0 || record -> program + record -> program_len * sizeof(p_instr) > size ||
+            record -> coefficients % 16 != 0 || record -> coefficients + coefficients > size || !snapshot_string(map, size, record -> name) ||
+            !snapshot_string(map, size, record -> input) || !valid_name(map + record -> name) || ftable_named(table, map + record -> name) >= 0) {
+            ftable_clear(table);
+            munmap(map, size);
+            return 1;
+        }
+
+        p_data *data = calloc(1, sizeof(p_data));
+        data -> input = map + record -> input;
+        data -> program = (p_instr *) (map + record -> program);
+        data -> program_len = record -> program_len;
+        data -> stack_depth = record -> stack_depth;
+        data -> valid = record -> valid;
+        data -> polynomial = record -> polynomial;
+        data -> degree = record -> degree;
+        data -> coefficients = record -> polynomial ? (long double *) (map + record -> coefficients) : NULL;
+        data -> borrowed = true;
+        data -> accounted = sizeof(p_data);
+        memory_acquire(MEMORY_expressions, data -> accounted);
+        ftable_insert(table, record -> slot, map + record -> name, data);
+    }
+
+    for(int i = 0 ; i < 4 ; i++)
+        window[i] = header -> window[i];
+
+    // the functions use the mapping for as long as they exist, so it stays mapped until the program ends.
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#ifndef TDEF
+#define TDEF static inline
+#endif
+
+// the amount of points that are evaluated and written together.
+#ifndef TABLE_BLOCK
+#define TABLE_BLOCK 4096
+#endif
+
+// the most functions that can be tabulated side by side.
+#ifndef MAX_COLUMNS
+#define MAX_COLUMNS 16
+#endif
+
+// output formats for tabulation. binary tables are rows of little-endian doubles: x, then every function.
+typedef enum {
+    FORMAT_csv,
+    FORMAT_binary
+} t_format;
+
+// what a tabulation wrote and how long it took.
+typedef struct {
+    long points;
+    long bytes;
+    double seconds;
+} t_result;
+
+// binary tables are written as binary64 values regardless of the platform's long double.
+TDEF void put_double(unsigned char *out, long double value) {
+    double d = (double) value;
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    for(int i = 0 ; i < 8 ; i++)
+        out[i] = (unsigned char) (bits >> (8 * i));
+}
+
+// powers of ten from 10^-350 to 10^349, for formatting doubles.
+static long double powers_of_ten[700];
+static bool powers_ready = false;
+
+// writes a double in the form of printf's "%.17g" (17 significant digits) and returns the amount of characters
+// written. the digits come from a single scaled multiplication instead of an exact decimal conversion, which is
+// several times faster but isn't correctly rounded, so the last digit can differ from printf's. the test run checks
+// that a sample of doubles across the whole range reads back unchanged.
+TDEF int format_double(char *out, double value) {
+    int length = 0;
+    if(isnan(value)) {
+        memcpy(out, "nan", 3);
+        return 3;
+    }
+    if(signbit(value))
+        out[length++] = '-';
+    value = fabs(value);
+    if(isinf(value)) {
+        memcpy(out + length, "inf", 3);
+        return length + 3;
+    }
+    if(value == 0) {
+        out[length++] = '0';
+        return length;
+    }
+
+    if(!powers_ready) {
+        for(int i = 0 ; i < 700 ; i++)
+            powers_of_ten[i] = powl(10, i - 350);
+        powers_ready = true;
+    }
+
+    // the decimal exponent is estimated from the binary one and corrected until there are exactly 17 digits.
+    int binary_exponent;
+    frexp(value, &binary_exponent);
+    int exponent = (int) floor((binary_exponent - 1) * 0.30102999566398120);
+    uint64_t digits;
+    while(true) {
+        digits = (uint64_t) llroundl(value * powers_of_ten[350 + 16 - exponent]);
+        if(digits >= 100000000000000000ULL) exponent++;
+        else if(digits < 10000000000000000ULL) exponent--;
+        else break;
+    }
+
+    char d[17];
+    for(int i = 16 ; i >= 0 ; i--, digits /= 10)
+        d[i] = '0' + digits % 10;
+    int last = 16;
+    while(last > 0 && d[last] == '0')
+        last--;
+
+    if(exponent < -4 || exponent >= 17) {
+        out[length++] = d[0];
+        if(last > 0) {
+            out[length++] = '.';
+            memcpy(out + length, d + 1, last);
+            length += last;
+        }
+        out[length++] = 'e';
+        out[length++] = exponent < 0 ? '-' : '+';
+        int magnitude = abs(exponent);
+        if(magnitude >= 100)
+            out[length++] = '0' + magnitude / 100;
+        out[length++] = '0' + magnitude / 10 % 10;
+        out[length++] = '0' + magnitude % 10;
+    } else if(exponent >= 0) {
+        memcpy(out + length, d, exponent + 1);
+        length += exponent + 1;
+        if(last > exponent) {
+            out[length++] = '.';
+            memcpy(out + length, d + exponent + 1, last - exponent);
+            length += last - exponent;
+        }
+    } else {
+        out[length++] = '0';
+        out[length++] = '.';
+        for(int i = 0 ; i < -exponent - 1 ; i++)
+            out[length++] = '0';
+        memcpy(out + length, d, last + 1);
+        length += last + 1;
+    }
+    return length;
+}
+
+// returns the format that a file name implies, .f64 and .bin files are binary and everything else is csv.
+TDEF t_format table_format(char *file_name) {
+    if(file_name == NULL)
+        return FORMAT_csv;
+
+    char *extension = strrchr(file_name, '.');
+    if(extension != NULL && (strcmp(extension, ".f64") == 0 || strcmp(extension, ".bin") == 0))
+        return FORMAT_binary;
+    return FORMAT_csv;
+}
+
+// returns the amount of points from x0 to x1 (inclusive) with the given step, or -1 if the step doesn't get there.
+TDEF long table_points(long double x0, long double x1, long double step) {
+    if(step == 0 || (x1 - x0) / step < 0)
+        return -1;
+    return (long) floorl((x1 - x0) / step + 1e-9) + 1;
+}
+
+// samples the functions at x0, x0 + step, ... up to x1 and streams the samples to the output. the points are
+// evaluated a block at a time with the batch evaluator and every block is formatted into a single buffer before it
+// is written, so memory use doesn't depend on the amount of points.
+TDEF t_result write_table(p_data **functions, char **names, int function_count, long double x0, long double x1, long double step, FILE *output, t_format format, long double base) {
+    t_result result = { 0, 0, 0 };
+    long points = table_points(x0, x1, step);
+    if(points < 0 || function_count < 1 || function_count > MAX_COLUMNS)
+        return result;
+
+    long double *xvalues = (long double *) malloc(TABLE_BLOCK * sizeof(long double));
+    long double *yvalues = (long double *) malloc((long) function_count * TABLE_BLOCK * sizeof(long double));
+
+    // a csv row is at most 26 characters per column.
+    long row_size = format == FORMAT_binary ? 8 * (function_count + 1) : 26 * (function_count + 1) + 1;
+    char *buffer = (char *) malloc(TABLE_BLOCK * row_size);
+
+    double start = now_seconds();
+    if(format == FORMAT_csv) {
+        result.bytes += fprintf(output, "x");
+        for(int f = 0 ; f < function_count ; f++)
+            result.bytes += fprintf(output, ",%s", names[f]);
+        result.bytes += fprintf(output, "\n");
+    }
+
+    progress_total(points);
+    for(long block = 0 ; block < points && !canceled() ; block += TABLE_BLOCK) {
+        int length = points - block < TABLE_BLOCK ? points - block : TABLE_BLOCK;
+        for(int i = 0 ; i < length ; i++)
+            xvalues[i] = x0 + (block + i) * step;
+        for(int f = 0 ; f < function_count ; f++)
+            evaluate_batch(functions[f], xvalues, yvalues + f * TABLE_BLOCK, length, base);
+
+        long size = 0;
+        for(int i = 0 ; i < length ; i++) {
+            if(format == FORMAT_binary) {
+                put_double((unsigned char *) buffer + size, xvalues[i]);
+                size += 8;
+                for(int f = 0 ; f < function_count ; f++, size += 8)
+                    put_double((unsigned char *) buffer + size, yvalues[f * TABLE_BLOCK + i]);
+            } else {
+                size += format_double(buffer + size, (double) xvalues[i]);
+                for(int f = 0 ; f < function_count ; f++) {
+                    buffer[size++] = ',';
+                    size += format_double(buffer + size, (double) yvalues[f * TABLE_BLOCK + i]);
+                }
+                buffer[size++] = '\n';
+            }
+        }
+
+        result.bytes += fwrite(buffer, 1, size, output);
+        result.points += length;
+        progress_advance(length);
+    }
+    fflush(output);
+    result.seconds = now_seconds() - start;
+
+    free(xvalues);
+    free(yvalues);
+    free(buffer);
+    return result;
+}
+
+// compiles a ';' separated list of expressions and tabulates them into the file (or the output when there is no
+// file). returns 0 on success.
+TDEF int tabulate(char *expressions, long double x0, long double x1, long double step, char *file_name, FILE *output, FILE *report, long double base) {
+    p_data *functions[MAX_COLUMNS];
+    char *names[MAX_COLUMNS];
+    int function_count = 0;
+
+    if(table_points(x0, x1, step) < 0) {
+        fprintf(report, "ERROR: the step must move from x0 towards x1.\n");
+        return 1;
+    }
+
+    char *list = strdup(expressions);
+    for(char *name = strtok(list, ";") ; name != NULL ; name = strtok(NULL, ";")) {
+        if(function_count == MAX_COLUMNS) {
+            fprintf(report, "ERROR: at most %i functions can be tabulated at once.\n", MAX_COLUMNS);
+            break;
+        }
+
+        // a column that doesn't compile stops the table before anything is written, with what was compiled freed.
+        names[function_count] = name;
+        if((functions[function_count] = compile_function(name)) == NULL) {
+            fprintf(report, "ERROR: %s\n", error_message);
+            for(int i = 0 ; i < function_count ; i++)
+                destroy_data(functions[i]);
+            free(list);
+            return 1;
+        }
+        function_count++;
+    }
+
+    FILE *file = output;
+    if(file_name != NULL && (file = fopen(file_name, "wb")) == NULL)
+        fprintf(report, "ERROR: could not open \"%s\".\n", file_name);
+
+    if(file != NULL && function_count > 0) {
+        // a large stdio buffer so that every block is written in a few calls.
+        if(file != output)
+            setvbuf(file, NULL, _IOFBF, 1 << 20);
+
+        t_result result = write_table(functions, names, function_count, x0, x1, step, file, table_format(file_name), base);
+        fprintf(report, "%li points, %.1f MB in %.3fs (%.2f million points/s, %.1f MB/s)\n", result.points, result.bytes / 1e6, result.seconds,
+            result.seconds > 0 ? result.points / result.seconds / 1e6 : 0, result.seconds > 0 ? result.bytes / result.seconds / 1e6 : 0);
+    }
+
+    if(file != NULL && file != output)
+        fclose(file);
+
+    // a table that was canceled part of the way through would look complete, so it isn't kept.
+    if(file != NULL && file != output && canceled()) {
+        remove(file_name);
+        fprintf(report, "the table was canceled, \"%s\" was removed.\n", file_name);
+    }
+    for(int i = 0 ; i < function_count ; i++)
+        destroy_data(functions[i]);
+    free(list);
+    return file == NULL || function_count == 0;
+}
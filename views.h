@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef VDEF
+#define VDEF static inline
+#endif
+
+// the views of an analysis are stacked on the display, each a band of VIEW_HEIGHT rows that spans the whole window.
+#define VIEW_COUNT 3
+#define VIEW_HEIGHT (int) (WINDOW_HEIGHT / VIEW_COUNT)
+
+// the most samples an analysis takes, which limits how far outside of the window the bounds of the area can be.
+#ifndef VIEW_MAX_SAMPLES
+#define VIEW_MAX_SAMPLES (1 << 22)
+#endif
+
+// the area an analysis found, and how many evaluations it took.
+typedef struct {
+    long double area;
+    long evaluations;
+    double seconds;
+} v_analysis;
+
+// returns how many samples an analysis takes, or -1 if it would take more than VIEW_MAX_SAMPLES. the samples are a
+// column apart: one per column, one more on either side for the derivative at the edges, and as many more past the
+// window as it takes to reach past both bounds. first is set to the column of the first sample.
+VDEF long view_samples(long double xmin, long double x_steps, long double left_bound, long double right_bound, long *first) {
+    long double low = fminl(left_bound, right_bound), high = fmaxl(left_bound, right_bound);
+    long double from = fminl(-1, floorl((low - xmin) / x_steps) - 1), to = fmaxl(WINDOW_WIDTH, ceill((high - xmin) / x_steps) + 1);
+    if(!isfinite(from) || !isfinite(to) || to - from + 1 > VIEW_MAX_SAMPLES)
+        return -1;
+
+    if(first != NULL)
+        *first = (long) from;
+    return (long) (to - from) + 1;
+}
+
+// the cubic through four samples a column apart, at s columns past the second of them.
+VDEF long double sample_cubic(long double *f, long double s) {
+    return -f[0] * s * (s - 1) * (s - 2) / 6 + f[1] * (s + 1) * (s - 1) * (s - 2) / 2 - f[2] * (s + 1) * s * (s - 2) / 2 + f[3] * (s + 1) * s * (s - 1) / 6;
+}
+
+// integrates the samples between two x values, over the cubic through the four samples around each column step. two
+// point gauss-legendre quadrature is exact for cubics, so every step takes two points of its cubic and no evaluations.
+VDEF long double integrate_samples(long double *samples, long first, long double xmin, long double x_steps, long double low, long double high) {
+    a_sum area = { 0, 0 };
+    long double from = (low - xmin) / x_steps, to = (high - xmin) / x_steps;
+    for(long k = (long) floorl(from) ; k < (long) ceill(to) ; k++) {
+        long double *f = samples + (k - 1 - first);
+        long double s0 = fmaxl(0, from - k), s1 = fminl(1, to - k);
+        if(s1 <= s0)
+            continue;
+
+        long double middle = (s0 + s1) / 2, half = (s1 - s0) / 2, offset = half / sqrtl(3);
+        sum_add(&area, half * (sample_cubic(f, middle - offset) + sample_cubic(f, middle + offset)));
+    }
+    return sum_value(&area) * x_steps;
+}
+
+// shades a column of a view the way shade_graph() does, from an output that was already sampled.
+VDEF void shade_rows(pixel **display, int height, int x, long double output, long double y_steps, long double left_bound, long double right_bound) {
+    for(int y = 0 ; y < height ; y++) {
+        pixel *pixel = &display[y][x];
+        long double rel_x = pixel -> x, rel_y = pixel -> y;
+
+        if(close_to(output, rel_y, y_steps/2.1))
+            pixel -> display = ycompress(output, rel_y, y_steps);
+        else if((output < 0? (rel_y < y_steps/2 && rel_y > output) : (rel_y > -y_steps/2 && rel_y < output)) && (rel_x > left_bound && rel_x < right_bound))
+            pixel -> display = '#';
+    }
+}
+
+// returns how many evaluations /graph, /graphdx and /integrate take between them for the same function.
+VDEF long separate_evaluations(p_data *data) {
+    long evaluations = (long) (WINDOW_WIDTH + WINDOW_WIDTH * WINDOW_HEIGHT);
+    if(!data -> polynomial)
+        evaluations += 2 * (long) WINDOW_WIDTH + INTEGRATE_STEPS;
+    return evaluations;
+}
+
+// samples a function once per column and draws three views of it from the same samples, stacked from the top: the
+// function, its derivative and the area under it between the bounds, shaded. the derivative at a column is the central
+// difference of the columns on either side, and the area is integrated from the samples, so neither evaluates the
+// function again (polynomials use their exact derivative and antiderivative instead). every view spans the window
+// in x and y, the rows of the display are given the y values of the view that they are in.
+VDEF v_analysis draw_views(pixel **display, p_data *data, long double x_steps, long double y_steps, long double left_bound, long double right_bound) {
+    double start = phase_begin(), seconds_start = now_seconds();
+    v_analysis result = { 0, 0, 0 };
+    long double xmin = display[0][0].x, ymax = display[0][0].y;
+    long first, count = view_samples(xmin, x_steps, left_bound, right_bound, &first);
+    if(count < 0)
+        throw_error("the bounds are too far outside of the window");
+
+    // a malformed function is evaluated once first, so that it reports its error before anything is allocated.
+    if(!data -> valid)
+        evaluate(xmin, data, base);
+
+    long double *xvalues = malloc(2 * count * sizeof(long double)), *samples = xvalues + count;
+    for(long i = 0 ; i < count ; i++)
+        xvalues[i] = xmin + x_steps * (first + i);
+
+    // the samples are taken a batch of SCAN_BLOCK at a time, so that the analysis can be canceled in between.
+    progress_total((count + SCAN_BLOCK - 1) / SCAN_BLOCK);
+    for(long i = 0 ; i < count && !canceled() ; i += SCAN_BLOCK) {
+        evaluate_batch(data, xvalues + i, samples + i, (int) (count - i < SCAN_BLOCK ? count - i : SCAN_BLOCK), base);
+        progress_advance(1);
+    }
+    if(canceled()) {
+        free(xvalues);
+        phase_end(PHASE_views, start);
+        return result;
+    }
+
+    long double low = fminl(left_bound, right_bound), high = fmaxl(left_bound, right_bound);
+    long double view_steps = y_steps * (WINDOW_HEIGHT - 1) / (VIEW_HEIGHT - 1);
+    for(int v = 0 ; v < VIEW_COUNT ; v++) {
+        pixel **rows = display + v * VIEW_HEIGHT;
+        for(int y = 0 ; y < VIEW_HEIGHT ; y++)
+            for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+                rows[y][x].y = ymax - view_steps * y;
+        draw_rows(rows, VIEW_HEIGHT, x_steps, view_steps);
+
+        for(int x = 0 ; x < WINDOW_WIDTH ; x++) {
+            long double *f = samples + (x - first);
+            if(v == 0)
+                plot_rows(rows, VIEW_HEIGHT, x, f[0], view_steps);
+            else if(v == 1)
+                plot_rows(rows, VIEW_HEIGHT, x, data -> polynomial ? derive_polynomial(xvalues[x - first], data) : (f[1] - f[-1]) / (2 * x_steps), view_steps);
+            else
+                shade_rows(rows, VIEW_HEIGHT, x, f[0], view_steps, low, high);
+        }
+    }
+
+    if(data -> polynomial)
+        result.area = antiderive_polynomial(right_bound, data) - antiderive_polynomial(left_bound, data);
+    else
+        result.area = (left_bound <= right_bound ? 1 : -1) * integrate_samples(samples, first, xmin, x_steps, low, high);
+    free(xvalues);
+
+    result.evaluations = count;
+    result.seconds = now_seconds() - seconds_start;
+    if(instrumenting())
+        instrument_add(calc_instrument.render_evaluations, result.evaluations);
+    phase_end(PHASE_views, start);
+    return result;
+}
+
+// prints the views of an analysis one under the other, each under a line that says what it shows.
+VDEF void print_views(pixel **display, p_data *data, long double left_bound, long double right_bound, FILE *file) {
+    double start = phase_begin();
+    char *row = malloc(WINDOW_WIDTH + 1);
+    for(int v = 0 ; v < VIEW_COUNT ; v++) {
+        if(v == 0) fprintf(file, "%s:\n", data -> input);
+        else if(v == 1) fprintf(file, "derivative of %s:\n", data -> input);
+        else fprintf(file, "area under %s from %Lf to %Lf:\n", data -> input, left_bound, right_bound);
+
+        for(int y = v * VIEW_HEIGHT ; y < (v + 1) * VIEW_HEIGHT ; y++) {
+            for(int x = 0 ; x < WINDOW_WIDTH ; x++)
+                row[x] = display[y][x].display;
+            row[(int) WINDOW_WIDTH] = '\0';
+            fputs(row, file);
+            fputc('\n', file);
+        }
+    }
+    free(row);
+    phase_end(PHASE_print_plane, start);
+}
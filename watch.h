@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#ifndef WDEF
+#define WDEF static inline
+#endif
+
+// the save files that are watched for changes.
+#ifndef FUNCTIONS_FILE
+#define FUNCTIONS_FILE "functions.txt"
+#endif
+
+#ifndef WINDOW_FILE
+#define WINDOW_FILE "window_data.csv"
+#endif
+
+// flags for the save files that changed.
+#define WATCH_functions 1
+#define WATCH_window 2
+
+// watches the directory of the save files. the directory is watched instead of the files so that files replaced
+// by a rename (the way most editors, and the calculator itself, save) are noticed too. the hashes of the files'
+// contents tell real changes apart from saves that didn't change anything.
+typedef struct {
+    int fd;
+    uint64_t functions_hash, window_hash;
+} w_watch;
+
+// remembers the current contents of the save files, so that only later changes count.
+WDEF void watch_saved(w_watch *watch) {
+    watch -> functions_hash = hash_file(0xcbf29ce484222325ULL, FUNCTIONS_FILE);
+    watch -> window_hash = hash_file(0xcbf29ce484222325ULL, WINDOW_FILE);
+}
+
+// starts watching the save files in the current directory, returns false if they can't be watched.
+WDEF bool watch_start(w_watch *watch) {
+    watch_saved(watch);
+    watch -> fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watch -> fd < 0)
+        return false;
+
+    if(inotify_add_watch(watch -> fd, ".", IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(watch -> fd);
+        watch -> fd = -1;
+        return false;
+    }
+    return true;
+}
+
+// reads the pending events and returns which save files now have different contents.
+WDEF int watch_changes(w_watch *watch) {
+    if(watch -> fd < 0)
+        return 0;
+
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool touched = false;
+    ssize_t length;
+    while((length = read(watch -> fd, buffer, sizeof(buffer))) > 0) {
+        for(char *at = buffer ; at < buffer + length ; ) {
+            struct inotify_event *event = (struct inotify_event *) at;
+            if(event -> len > 0 && (strcmp(event -> name, FUNCTIONS_FILE) == 0 || strcmp(event -> name, WINDOW_FILE) == 0))
+                touched = true;
+            at += sizeof(struct inotify_event) + event -> len;
+        }
+    }
+    if(!touched)
+        return 0;
+
+    int changes = 0;
+    uint64_t functions_hash = hash_file(0xcbf29ce484222325ULL, FUNCTIONS_FILE);
+    uint64_t window_hash = hash_file(0xcbf29ce484222325ULL, WINDOW_FILE);
+    if(functions_hash != watch -> functions_hash)
+        changes |= WATCH_functions;
+    if(window_hash != watch -> window_hash)
+        changes |= WATCH_window;
+
+    watch -> functions_hash = functions_hash;
+    watch -> window_hash = window_hash;
+    return changes;
+}
+
+// reads the window bounds (xmin, xmax, ymin, ymax) from a csv file, returns false if there aren't four of them.
+WDEF bool read_window(char *file_name, long double *window) {
+    FILE *file = fopen(file_name, "r");
+    if(file == NULL)
+        return false;
+
+    char line[MAX_LENGTH];
+    long double values[4];
+    int count = 0;
+    if(fgets(line, sizeof(line), file) != NULL)
+        for(char *value = strtok(line, ",") ; value != NULL && count < 4 ; value = strtok(NULL, ","))
+            values[count++] = atof(value);
+    fclose(file);
+
+    if(count < 4)
+        return false;
+    for(int i = 0 ; i < 4 ; i++)
+        window[i] = values[i];
+    return true;
+}
+
+// returns how long ago (in seconds) a file was last written.
+WDEF double seconds_since_write(char *file_name) {
+    struct stat status;
+    struct timespec now;
+    if(stat(file_name, &status) != 0)
+        return 0;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (now.tv_sec - status.st_mtim.tv_sec) + (now.tv_nsec - status.st_mtim.tv_nsec) * 1e-9;
+}
+
+// reloads the save files that changed and reports what changed and how long it took, both to reload and since the
+// file was written.
+WDEF void reload_sources(int changes, f_table *functions, long double *window, FILE *report) {
+    if(changes & WATCH_functions) {
+        double start = now_seconds();
+        FILE *file = fopen(FUNCTIONS_FILE, "r");
+        if(file != NULL) {
+            f_reload result = ftable_reload(functions, file);
+            fclose(file);
+            fprintf(report, "reloaded %s: %i recompiled, %i kept, %i removed, %i failed in %.3f ms (%.3f ms after it was written)\n", FUNCTIONS_FILE,
+                result.compiled, result.kept, result.removed, result.failed, (now_seconds() - start) * 1e3, seconds_since_write(FUNCTIONS_FILE) * 1e3);
+            if(result.unsaved > 0)
+                fprintf(report, "\tkept %i function%s changed in the calculator since %s was saved, /quit saves them into it.\n", result.unsaved,
+                    result.unsaved == 1 ? "" : "s", FUNCTIONS_FILE);
+        }
+    }
+
+    if(changes & WATCH_window) {
+        if(read_window(WINDOW_FILE, window))
+            fprintf(report, "reloaded %s: [%Lf, %Lf] x [%Lf, %Lf] (%.3f ms after it was written)\n", WINDOW_FILE, window[0], window[1], window[2], window[3],
+                seconds_since_write(WINDOW_FILE) * 1e3);
+        else fprintf(report, "ERROR: %s doesn't have four window bounds, keeping the current window.\n", WINDOW_FILE);
+    }
+}
+
+// opens a temporary file next to a save file, so that the save file can be replaced all at once by finish_save().
+WDEF FILE *begin_save(char *file_name, char *temporary, int size) {
+    snprintf(temporary, size, "%s.tmp", file_name);
+    return fopen(temporary, "w");
+}
+
+// closes the temporary file and renames it over the save file, returns 0 on success.
+WDEF int finish_save(FILE *file, char *temporary, char *file_name) {
+    bool failed = ferror(file);
+    failed |= fclose(file) != 0;
+    if(failed || rename(temporary, file_name) != 0) {
+        remove(temporary);
+        return 1;
+    }
+    return 0;
+}